@@ -3,7 +3,14 @@
 
 #define MAXTOKENLEN 128
 #define MAXTOKENS 256
-#define MAXIDENTIFIERS 4
+/* Enough for most simple declarations and for every parameter or member. */
+#define INITIALTOKENS 8
+/*
+ * Each identifier takes a name character and a separator, so no input line
+ * holds more.
+ */
+#define MAXIDENTIFIERS (MAXTOKENLEN / 2)
+#define MAXCACHEDPARAMS 32
 #define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
 #define _cleanup_(x) __attribute__((__cleanup__(x)))
 
@@ -91,6 +98,43 @@ struct identifier_props {
   enum specifier_state last_dimension[MAXIDENTIFIERS];
 };
 
+/*
+ * Like identifier_props, the token stack is a struct of arrays.  The output
+ * passes mostly scan the kinds, which are thereby densely packed rather than
+ * interleaved with MAXTOKENLEN-byte strings.  The arrays start with
+ * INITIALTOKENS slots and double up to MAXTOKENS, so that each level of
+ * nested parameters or members costs memory in proportion to its tokens
+ * rather than a full MAXTOKENS stack.
+ */
+struct token_stack {
+  enum token_class *kind;
+  char (*string)[MAXTOKENLEN];
+  size_t capacity;
+};
+
+/*
+ * Explanations of function parameters and struct or union members, keyed by
+ * the source span which produced them and by the kind of enclosing
+ * declaration.  A caller which re-explains an edited declaration keeps the
+ * cache between calls so that only the changed parameters are re-tokenized
+ * and re-rendered.
+ */
+struct param_cache_entry {
+  char source[MAXTOKENLEN];
+  unsigned int context;
+  /* Number of characters of the span which load_stack() consumed. */
+  size_t consumed;
+  char *rendered;
+  size_t last_used;
+};
+
+struct param_cache {
+  struct param_cache_entry entries[MAXCACHEDPARAMS];
+  size_t clock;
+  size_t hits;
+  size_t misses;
+};
+
 /*
  * A well-formed declaration must have exactly one of each of the following:
  * a type;
@@ -126,11 +170,20 @@ struct parser_props {
   char start_delim;
   char end_delim;
   char separator;
-  struct token stack[MAXTOKENS];
+  struct token_stack stack;
   struct identifier_props ident;
   struct parser_props *prev;
   struct parser_props *next;
   struct parser_props *parent;
+  /*
+   * When cache is set, subsidiary parsers remember the source span they
+   * parsed, or else hold the explanation which a previous parse of the same
+   * span produced.
+   */
+  struct param_cache *cache;
+  char *span_source;
+  size_t span_consumed;
+  char *cached_output;
   /* The I/O streams are settable for the convenience of the tests. */
   FILE *out_stream;
   FILE *err_stream;
@@ -144,8 +197,20 @@ void limitations();
 void initialize_parser(struct parser_props *parser);
 void reset_parser(struct parser_props *parser);
 void release_parser_resources(struct parser_props *parser);
+void release_subsidiary_parsers(struct parser_props *parser);
+bool reserve_token_stack(struct parser_props *parser, const size_t capacity);
 struct parser_props *make_parser(struct parser_props *const parser);
 
+/* functions to manage the parameter cache */
+void initialize_param_cache(struct param_cache *cache);
+void release_param_cache(struct param_cache *cache);
+const struct param_cache_entry *find_cached_param(struct param_cache *cache,
+                                                  const char *source,
+                                                  const unsigned int context);
+bool store_cached_param(struct param_cache *cache, const char *source,
+                        const unsigned int context, const size_t consumed,
+                        const char *rendered);
+
 /*
  * Functions which characterize input.  A returned false value indicates an
  * error.  Functions with two parameters modify the non-const one. None of the
@@ -181,7 +246,7 @@ bool truncate_input(char **input, struct parser_props *parser);
 /* debugging functions */
 struct parser_props *get_head_parser(struct parser_props *parser);
 void show_parser_list(const struct parser_props *parser, const int lineno);
-void showstack(const struct token *stack, const size_t stacklen,
+void showstack(const struct token_stack *stack, const size_t stacklen,
                FILE *out_stream, const int lineno);
 
 /* parser helper functions */
@@ -67,7 +67,7 @@ static inline void subsidiary_parsers_cleanup(void *parserp) {
       !(**(struct parser_props ***)parserp))
     return;
   struct parser_props *parser = **((struct parser_props ***)parserp);
-  release_parser_resources(parser);
+  release_subsidiary_parsers(parser);
 }
 
 /********** documentation functions **********/
@@ -103,6 +103,12 @@ void initialize_identifier(struct identifier_props *ident) {
 }
 
 void initialize_parser(struct parser_props *parser) {
+  parser->stack.kind = NULL;
+  parser->stack.string = NULL;
+  parser->stack.capacity = 0;
+  if (!reserve_token_stack(parser, INITIALTOKENS)) {
+    exit(ENOMEM);
+  }
   reset_parser(parser);
   parser->out_stream = stdout;
   parser->err_stream = stderr;
@@ -134,13 +140,62 @@ void reset_parser(struct parser_props *parser) {
   parser->prev = NULL;
   parser->next = NULL;
   parser->parent = NULL;
-  for (int i = 0; i < MAXTOKENS; i++) {
-    parser->stack[i].kind = invalid;
-    memset(parser->stack[i].string, '\0', MAXTOKENLEN);
-  }
+  parser->cache = NULL;
+  parser->span_source = NULL;
+  parser->span_consumed = 0;
+  parser->cached_output = NULL;
+  for (size_t i = 0; i < parser->stack.capacity; i++) {
+    parser->stack.kind[i] = invalid;
+  }
+  memset(parser->stack.string, '\0', parser->stack.capacity * MAXTOKENLEN);
   initialize_identifier(&parser->ident);
 }
 
+/*
+ * Grow the token stack to hold at least capacity tokens.  The new slots are
+ * empty.  Return false if the request exceeds MAXTOKENS or memory is
+ * exhausted.
+ */
+bool reserve_token_stack(struct parser_props *parser, const size_t capacity) {
+  const size_t old_capacity = parser->stack.capacity;
+  enum token_class *kind = NULL;
+  char(*string)[MAXTOKENLEN] = NULL;
+  if (capacity <= old_capacity) {
+    return true;
+  }
+  if (capacity > MAXTOKENS) {
+    return false;
+  }
+  kind = (enum token_class *)realloc(parser->stack.kind,
+                                     capacity * sizeof(enum token_class));
+  if (!kind) {
+    return false;
+  }
+  parser->stack.kind = kind;
+  string = (char(*)[MAXTOKENLEN])realloc(parser->stack.string,
+                                         capacity * MAXTOKENLEN);
+  if (!string) {
+    return false;
+  }
+  parser->stack.string = string;
+  for (size_t i = old_capacity; i < capacity; i++) {
+    parser->stack.kind[i] = invalid;
+  }
+  memset(parser->stack.string + old_capacity, '\0',
+         (capacity - old_capacity) * MAXTOKENLEN);
+  parser->stack.capacity = capacity;
+  return true;
+}
+
+static void release_token_stack(struct parser_props *parser) {
+  free(parser->stack.kind);
+  free(parser->stack.string);
+  parser->stack.kind = NULL;
+  parser->stack.string = NULL;
+  parser->stack.capacity = 0;
+  parser->stacklen = 0;
+}
+
 void initialize_token(struct token *this_token) {
   this_token->kind = invalid;
   memset(this_token->string, '\0', MAXTOKENLEN);
@@ -168,6 +223,14 @@ struct parser_props *get_tail_parser(struct parser_props *parser) {
   return cursor;
 }
 
+/* Subsidiary parsers may own copies of their source span and output. */
+static void free_parser(struct parser_props *parser) {
+  free(parser->span_source);
+  free(parser->cached_output);
+  release_token_stack(parser);
+  free(parser);
+}
+
 /* The list head is a stack allocation. */
 static void _free_all_parsers(struct parser_props *parser) {
   if (!parser)
@@ -175,7 +238,7 @@ static void _free_all_parsers(struct parser_props *parser) {
   struct parser_props *tail = get_tail_parser(parser);
   while (tail->prev) {
     struct parser_props *save = tail->prev;
-    free(tail);
+    free_parser(tail);
     save->next = 0;
     tail = save;
   }
@@ -185,10 +248,22 @@ static void _free_all_parsers(struct parser_props *parser) {
  * Note that freeing the allocated parsers must come first since the reset makes
  * the next pointer NULL.
  */
-void release_parser_resources(struct parser_props *parser) {
+void release_subsidiary_parsers(struct parser_props *parser) {
   _free_all_parsers(parser);
 }
 
+/*
+ * Free the subsidiary parsers and the parser's own token stack.  Calling the
+ * function again on the same parser is harmless.
+ */
+void release_parser_resources(struct parser_props *parser) {
+  if (!parser) {
+    return;
+  }
+  release_subsidiary_parsers(parser);
+  release_token_stack(parser);
+}
+
 struct parser_props *make_parser(struct parser_props *const parser) {
   struct parser_props *new_parser =
       (struct parser_props *)malloc(sizeof(struct parser_props));
@@ -198,11 +273,107 @@ struct parser_props *make_parser(struct parser_props *const parser) {
   initialize_parser(new_parser);
   new_parser->out_stream = parser->out_stream;
   new_parser->err_stream = parser->err_stream;
+  new_parser->cache = parser->cache;
   parser->next = new_parser;
   new_parser->prev = parser;
   return new_parser;
 }
 
+/********** functions to manage the parameter cache **********/
+
+void initialize_param_cache(struct param_cache *cache) {
+  for (size_t i = 0; i < MAXCACHEDPARAMS; i++) {
+    memset(cache->entries[i].source, '\0', MAXTOKENLEN);
+    cache->entries[i].context = 0;
+    cache->entries[i].consumed = 0;
+    cache->entries[i].rendered = NULL;
+    cache->entries[i].last_used = 0;
+  }
+  cache->clock = 0;
+  cache->hits = 0;
+  cache->misses = 0;
+}
+
+void release_param_cache(struct param_cache *cache) {
+  if (!cache) {
+    return;
+  }
+  for (size_t i = 0; i < MAXCACHEDPARAMS; i++) {
+    free(cache->entries[i].rendered);
+  }
+  initialize_param_cache(cache);
+}
+
+/*
+ * How a parameter or member parses depends on the kind of declaration which
+ * encloses it as well as on its own text, so the parent's shape is part of the
+ * cache key.
+ */
+static unsigned int param_context(const struct parser_props *parent) {
+  unsigned int context = 0;
+  if (!parent) {
+    return context;
+  }
+  context |= parent->has_function_params ? 0x1 : 0;
+  context |= parent->has_struct_or_union_members ? 0x2 : 0;
+  context |= parent->is_function_ptr ? 0x4 : 0;
+  context |= parent->is_function ? 0x8 : 0;
+  context |= parent->is_struct_or_union ? 0x10 : 0;
+  return context;
+}
+
+/* Return NULL if no explanation of source is cached. */
+const struct param_cache_entry *find_cached_param(struct param_cache *cache,
+                                                  const char *source,
+                                                  const unsigned int context) {
+  if (!cache || !source) {
+    return NULL;
+  }
+  for (size_t i = 0; i < MAXCACHEDPARAMS; i++) {
+    struct param_cache_entry *entry = &cache->entries[i];
+    if (entry->rendered && (context == entry->context) &&
+        !strcmp(source, entry->source)) {
+      entry->last_used = ++cache->clock;
+      cache->hits++;
+      return entry;
+    }
+  }
+  cache->misses++;
+  return NULL;
+}
+
+/* Replace the least recently used entry.  Return false on failure. */
+bool store_cached_param(struct param_cache *cache, const char *source,
+                        const unsigned int context, const size_t consumed,
+                        const char *rendered) {
+  struct param_cache_entry *victim = NULL;
+  if (!cache || !source || !rendered || (strlen(source) > (MAXTOKENLEN - 1))) {
+    return false;
+  }
+  victim = &cache->entries[0];
+  for (size_t i = 0; i < MAXCACHEDPARAMS; i++) {
+    struct param_cache_entry *entry = &cache->entries[i];
+    if (!entry->rendered) {
+      victim = entry;
+      break;
+    }
+    if (entry->last_used < victim->last_used) {
+      victim = entry;
+    }
+  }
+  free(victim->rendered);
+  /* On failure, the entry is left empty, and the span is not cached. */
+  victim->rendered = strdup(rendered);
+  if (!victim->rendered) {
+    return false;
+  }
+  strlcpy(victim->source, source, MAXTOKENLEN);
+  victim->context = context;
+  victim->consumed = consumed;
+  victim->last_used = ++cache->clock;
+  return true;
+}
+
 /********** functions which characterize input **********/
 
 bool is_all_blanks(const char *input) {
@@ -650,7 +821,7 @@ void elide_assignments(char **input) {
     }
     /* Overwrite any whitespace before '='.   Otherwise it will appear before a
      * possible comma in the output. */
-    while (isblank(*(*input + (equals_offset - 1)))) {
+    while (equals_offset && isblank(*(*input + (equals_offset - 1)))) {
       equals_offset--;
     }
     *(*input + equals_offset) = '\0';
@@ -924,7 +1095,7 @@ void show_parser_reverse_list(const struct parser_props *parser) {
   fflush(parser->err_stream);
 }
 
-void showstack(const struct token *stack, const size_t stacklen,
+void showstack(const struct token_stack *stack, const size_t stacklen,
                FILE *out_stream, const int lineno) {
 
   size_t tokennum = 0, ctr;
@@ -934,7 +1105,7 @@ void showstack(const struct token *stack, const size_t stacklen,
   fprintf(out_stream, "Stack at %d is:\n", lineno);
   for (ctr = 0; ctr < stacklen; ctr++) {
     fprintf(out_stream, "Token number %lu has kind %s and string %s\n",
-            tokennum, kind_names[stack[ctr].kind], stack[ctr].string);
+            tokennum, kind_names[stack->kind[ctr]], stack->string[ctr]);
     tokennum++;
   }
   fflush(out_stream);
@@ -944,8 +1115,8 @@ void showstack(const struct token *stack, const size_t stacklen,
 /********** parser helper functions **********/
 
 bool have_stacked_compound_type(const struct parser_props *parser) {
-  const char *spacepos = strchr(parser->stack[0].string, ' ');
-  if ((!parser) || (type != parser->stack[0].kind) || (NULL == spacepos)) {
+  const char *spacepos = strchr(parser->stack.string[0], ' ');
+  if ((!parser) || (type != parser->stack.kind[0]) || (NULL == spacepos)) {
     return false;
   }
   return true;
@@ -1062,8 +1233,8 @@ bool all_identifiers_are_enum_constants(const struct parser_props *parser) {
     return false;
   }
   while (--stacknum) {
-    if (identifier == parser->stack[stacknum].kind) {
-      if (!strstr(parser->enumerator_list, parser->stack[stacknum].string)) {
+    if (identifier == parser->stack.kind[stacknum]) {
+      if (!strstr(parser->enumerator_list, parser->stack.string[stacknum])) {
         return false;
       }
     }
@@ -1102,10 +1273,10 @@ bool reclassified_unsigned_qualifier(struct parser_props *parser) {
   }
   cursor = parser->stacklen - 1;
   while (cursor >= 0) {
-    if ((qualifier == parser->stack[cursor].kind) &&
-        (!strcmp(parser->stack[cursor].string, "unsigned"))) {
-      parser->stack[cursor].kind = type;
-      strlcpy(parser->stack[cursor].string, "unsigned int",
+    if ((qualifier == parser->stack.kind[cursor]) &&
+        (!strcmp(parser->stack.string[cursor], "unsigned"))) {
+      parser->stack.kind[cursor] = type;
+      strlcpy(parser->stack.string[cursor], "unsigned int",
               strlen("unsigned int") + 1);
       parser->have_type = true;
       return true;
@@ -1133,8 +1304,8 @@ bool qualifier_is_compatible_with_type(const struct parser_props *parser,
   }
   cursor = parser->stacklen - 1;
   while (cursor >= 0) {
-    if (qualifier == parser->stack[cursor].kind) {
-      if (!strcmp(parser->stack[cursor].string, "unsigned")) {
+    if (qualifier == parser->stack.kind[cursor]) {
+      if (!strcmp(parser->stack.string[cursor], "unsigned")) {
         if ((!strcmp(type, "char") || !strcmp(type, "short")) ||
             !strcmp(type, "int")) {
           return true;
@@ -1145,7 +1316,7 @@ bool qualifier_is_compatible_with_type(const struct parser_props *parser,
         }
       }
       if ((strstr(type, "atomic") != NULL) &&
-          (!strcmp(parser->stack[cursor].string, "atomic"))) {
+          (!strcmp(parser->stack.string[cursor], "atomic"))) {
         fprintf(parser->err_stream,
                 "Type and qualifier cannot both be atomic.\n");
         return false;
@@ -1246,12 +1417,31 @@ bool load_next_secondary_param(struct parser_props *const current_parser,
   } else {
     return true;
   }
+  if (current_parser->cache) {
+    const struct param_cache_entry *cached =
+        find_cached_param(current_parser->cache, next_param,
+                          param_context(current_parser->parent));
+    /*
+     * The span is unchanged, so reuse its explanation without re-parsing.  If
+     * the copy fails, parse the span as if it were not cached.
+     */
+    if (cached) {
+      current_parser->cached_output = strdup(cached->rendered);
+      if (current_parser->cached_output) {
+        current_parser->parent->cursor += cached->consumed + 1;
+        return true;
+      }
+    }
+    /* Without a copy of the span, its explanation is not cached. */
+    current_parser->span_source = strdup(next_param);
+  }
   increm = load_stack(current_parser, next_param);
   if (!increm) {
     fprintf(head->err_stream, "Failed to load %s %s\n", err_string,
             next_param ? next_param : "");
     return false;
   }
+  current_parser->span_consumed = increm;
   /* +1 to go past demarcator, which is not included in the cursor count. */
   current_parser->parent->cursor += increm + 1;
   return true;
@@ -1393,6 +1583,13 @@ bool process_secondary_params(struct parser_props *parser, char *user_input) {
        * processes what's inside the delimiters.  Comma-separated declarator
        * lists may not have an end_delim.
        */
+      /* There is no parser if no member or parameter had a name. */
+      if (!params_parser) {
+        fprintf(parser->err_stream, "Failed to process %s\n",
+                final_err_string);
+        dummy_parserp = NULL;
+        return false;
+      }
       if (!load_next_secondary_param(params_parser, progress_ptr,
                                      parser->end_delim, final_err_string)) {
         dummy_parserp = NULL;
@@ -1479,8 +1676,8 @@ bool parser_has_atomic_qualifier(const struct parser_props *parser) {
     return false;
   }
   while (stacktop-- > 0) {
-    if ((qualifier == parser->stack[stacktop].kind) &&
-        strstr(parser->stack[stacktop].string, "atomic")) {
+    if ((qualifier == parser->stack.kind[stacktop]) &&
+        strstr(parser->stack.string[stacktop], "atomic")) {
       return true;
     }
   }
@@ -1648,9 +1845,9 @@ bool type_is_bitfield_compatible(const struct parser_props *parser) {
    * than >=0, which would allow negative indices inside the loop.
    */
   while (stacktop-- > 0) {
-    if (type == parser->stack[stacktop].kind) {
-      if ((!strcmp(parser->stack[stacktop].string, "int")) ||
-          (!strcmp(parser->stack[stacktop].string, "unsigned int"))) {
+    if (type == parser->stack.kind[stacktop]) {
+      if ((!strcmp(parser->stack.string[stacktop], "int")) ||
+          (!strcmp(parser->stack.string[stacktop], "unsigned int"))) {
         if (BITS_PER_INT >= parser->bitfield_width) {
           return true;
         } else {
@@ -1658,7 +1855,7 @@ bool type_is_bitfield_compatible(const struct parser_props *parser) {
                   "Bitfield width %ld too wide for integer type.\n",
                   parser->bitfield_width);
         }
-      } else if (!strcmp(parser->stack[stacktop].string, "bool")) {
+      } else if (!strcmp(parser->stack.string[stacktop], "bool")) {
         if (1 == parser->bitfield_width) {
           return true;
         }
@@ -1788,7 +1985,7 @@ bool handled_extended_parsing(struct parser_props *parser, char *user_input,
 int found_array_length_in_remaining_stack(const struct parser_props *parser,
                                           int current_top) {
   while (current_top >= 0) {
-    if (length == parser->stack[current_top].kind) {
+    if (length == parser->stack.kind[current_top]) {
       break;
     }
     current_top--;
@@ -1824,10 +2021,13 @@ void reverse_lengths(struct parser_props *parser, const size_t top_ident,
     bottom_len_idx = top_len_idx - num_pairs;
   }
   for (size_t ctr = 0; ctr < num_pairs; ctr++) {
-    struct token bottom_len = parser->stack[bottom_len_idx + ctr];
-    struct token top_len = parser->stack[top_len_idx - ctr];
-    strlcpy(parser->stack[top_len_idx].string, bottom_len.string, MAXTOKENLEN);
-    strlcpy(parser->stack[bottom_len_idx].string, top_len.string, MAXTOKENLEN);
+    char bottom_len[MAXTOKENLEN];
+    char top_len[MAXTOKENLEN];
+    strlcpy(bottom_len, parser->stack.string[bottom_len_idx + ctr],
+            MAXTOKENLEN);
+    strlcpy(top_len, parser->stack.string[top_len_idx - ctr], MAXTOKENLEN);
+    strlcpy(parser->stack.string[top_len_idx], bottom_len, MAXTOKENLEN);
+    strlcpy(parser->stack.string[bottom_len_idx], top_len, MAXTOKENLEN);
   }
 }
 
@@ -1845,24 +2045,24 @@ void reorder_qualifier_and_type(struct parser_props *parser) {
   }
   if (parser->have_type) {
     while (--stacktop > 0) {
-      if ((0 == strcmp("extern", parser->stack[stacktop - 1].string)) ||
-          (0 == strcmp("static", parser->stack[stacktop - 1].string))) {
+      if ((0 == strcmp("extern", parser->stack.string[stacktop - 1])) ||
+          (0 == strcmp("static", parser->stack.string[stacktop - 1]))) {
         continue;
       }
-      if ((type == parser->stack[stacktop].kind) &&
-          (qualifier == parser->stack[stacktop - 1].kind) &&
-          (0 != strcmp("*", parser->stack[stacktop - 1].string))) {
+      if ((type == parser->stack.kind[stacktop]) &&
+          (qualifier == parser->stack.kind[stacktop - 1]) &&
+          (0 != strcmp("*", parser->stack.string[stacktop - 1]))) {
         /* Save type element's string. */
         char type_name[MAXTOKENLEN];
-        strlcpy(type_name, parser->stack[stacktop].string, MAXTOKENLEN);
+        strlcpy(type_name, parser->stack.string[stacktop], MAXTOKENLEN);
         /* Overwrite type (top element) with the 2nd element from top
          * (qualifier). */
-        parser->stack[stacktop].kind = qualifier;
-        strlcpy(parser->stack[stacktop].string,
-                parser->stack[stacktop - 1].string, MAXTOKENLEN);
+        parser->stack.kind[stacktop] = qualifier;
+        strlcpy(parser->stack.string[stacktop],
+                parser->stack.string[stacktop - 1], MAXTOKENLEN);
         /* Complete the swap. */
-        parser->stack[stacktop - 1].kind = type;
-        strlcpy(parser->stack[stacktop - 1].string, type_name, MAXTOKENLEN);
+        parser->stack.kind[stacktop - 1] = type;
+        strlcpy(parser->stack.string[stacktop - 1], type_name, MAXTOKENLEN);
       }
     }
   }
@@ -1899,41 +2099,45 @@ void reorder_array_identifier_and_lengths(struct parser_props *parser) {
      */
     while (unprocessed_lengths) {
       if ((identifier !=
-           parser->stack[top_length - unprocessed_lengths].kind) ||
+           parser->stack.kind[top_length - unprocessed_lengths]) ||
           (length !=
-           parser->stack[(top_length - unprocessed_lengths) + 1].kind)) {
+           parser->stack.kind[(top_length - unprocessed_lengths) + 1])) {
         fprintf(parser->err_stream, "Logic error in %s\n", __func__);
         return;
       }
-      struct token name = parser->stack[top_length - unprocessed_lengths];
-      struct token arraylen =
-          parser->stack[(top_length - unprocessed_lengths) + 1];
+      char name[MAXTOKENLEN];
+      char arraylen[MAXTOKENLEN];
+      strlcpy(name, parser->stack.string[top_length - unprocessed_lengths],
+              MAXTOKENLEN);
+      strlcpy(arraylen,
+              parser->stack.string[(top_length - unprocessed_lengths) + 1],
+              MAXTOKENLEN);
       /*
        * Without memset(), overwriting a long string with a short one leaves
        * junk on the stack.
        */
-      memset(parser->stack[(top_length - unprocessed_lengths) + 1].string, '\0',
+      memset(parser->stack.string[(top_length - unprocessed_lengths) + 1], '\0',
              MAXTOKENLEN);
-      memset(parser->stack[(top_length - unprocessed_lengths)].string, '\0',
+      memset(parser->stack.string[(top_length - unprocessed_lengths)], '\0',
              MAXTOKENLEN);
-      strlcpy(parser->stack[(top_length - unprocessed_lengths) + 1].string,
-              name.string, MAXTOKENLEN);
-      strlcpy(parser->stack[top_length - unprocessed_lengths].string,
-              arraylen.string, MAXTOKENLEN);
-      parser->stack[(top_length - unprocessed_lengths) + 1].kind = identifier;
-      parser->stack[top_length - unprocessed_lengths].kind = length;
+      strlcpy(parser->stack.string[(top_length - unprocessed_lengths) + 1],
+              name, MAXTOKENLEN);
+      strlcpy(parser->stack.string[top_length - unprocessed_lengths],
+              arraylen, MAXTOKENLEN);
+      parser->stack.kind[(top_length - unprocessed_lengths) + 1] = identifier;
+      parser->stack.kind[top_length - unprocessed_lengths] = length;
       unprocessed_lengths--;
     }
     if (parser->ident.array_lengths[this_ident] > 1) {
 #ifdef DEBUG
       printf("Before reversing array lengths:\n");
-      showstack((const struct token *)&parser->stack[0], parser->stacklen,
+      showstack(&parser->stack, parser->stacklen,
                 stdout, __LINE__);
 #endif
       reverse_lengths(parser, this_ident, current_stack_top);
 #ifdef DEBUG
       printf("After reversing array lengths:\n");
-      showstack((const struct token *)&parser->stack[0], parser->stacklen,
+      showstack(&parser->stack, parser->stacklen,
                 stdout, __LINE__);
 #endif
     }
@@ -1959,25 +2163,80 @@ void reorder_stacks(struct parser_props *parser) {
 
 bool handled_qualifiers(const struct parser_props *parser,
                         const size_t stacktop) {
-  if (!strcmp("volatile", parser->stack[stacktop].string) &&
+  if (!strcmp("volatile", parser->stack.string[stacktop]) &&
       parser->is_function) {
     /* Purge any already printed messages from the output stream which are
      * now irrelevant. */
     __fpurge(parser->out_stream);
     fprintf(parser->err_stream, "Function return types cannot be volatile.\n");
     return false;
-  } else if ((0 == strcmp("extern", parser->stack[stacktop].string)) ||
-             (0 == strcmp("static", parser->stack[stacktop].string))) {
+  } else if ((0 == strcmp("extern", parser->stack.string[stacktop])) ||
+             (0 == strcmp("static", parser->stack.string[stacktop]))) {
     fprintf(parser->out_stream,
             "and which has static storage duration and %s linkage",
-            !strcmp(parser->stack[stacktop].string, "extern") ? "external"
+            !strcmp(parser->stack.string[stacktop], "extern") ? "external"
                                                               : "internal");
   } else {
-    fprintf(parser->out_stream, "%s ", parser->stack[stacktop].string);
+    fprintf(parser->out_stream, "%s ", parser->stack.string[stacktop]);
+  }
+  return true;
+}
+
+/*
+ * Print the explanation of a function parameter or struct member to the
+ * parent's stream.  A cached explanation is copied as-is.  Otherwise the
+ * subsidiary parser's stack is popped, and if a cache is in use, the
+ * explanation is captured so that the next parse of the same span can reuse
+ * it.  If the capture stream cannot be opened, the explanation is printed
+ * directly and not cached.
+ */
+static bool pop_subsidiary_parser(const struct parser_props *parser,
+                                  struct parser_props *cursor) {
+  char *rendered = NULL;
+  size_t rendered_len = 0;
+  FILE *capture = NULL;
+  if (cursor->cached_output) {
+    fprintf(parser->out_stream, "%s", cursor->cached_output);
+    return true;
+  }
+  if (cursor->cache && cursor->span_source) {
+    capture = open_memstream(&rendered, &rendered_len);
+  }
+  if (!capture) {
+    /* Nested parameters print wherever the enclosing declaration does. */
+    cursor->out_stream = parser->out_stream;
+    return pop_all(cursor);
+  }
+  cursor->out_stream = capture;
+  if (!pop_all(cursor)) {
+    fclose(capture);
+    free(rendered);
+    cursor->out_stream = parser->out_stream;
+    return false;
   }
+  fclose(capture);
+  cursor->out_stream = parser->out_stream;
+  fprintf(parser->out_stream, "%s", rendered);
+  store_cached_param(cursor->cache, cursor->span_source,
+                     param_context(cursor->parent), cursor->span_consumed,
+                     rendered);
+  free(rendered);
   return true;
 }
 
+/*
+ * The subsidiary parsers of all nesting levels are in one list.  A parameter
+ * which is itself a function pointer pops only its own parameters, which
+ * precede its siblings, so that its explanation does not include theirs.
+ */
+static bool is_own_subsidiary_parser(const struct parser_props *parser,
+                                     const struct parser_props *cursor) {
+  if (!cursor || (cursor->parent && (cursor->parent != parser))) {
+    return false;
+  }
+  return (cursor->stacklen || cursor->cached_output);
+}
+
 bool handled_function_params(const struct parser_props *parser) {
   /*
    * If the function is itself part of a union or struct, then
@@ -1986,19 +2245,19 @@ bool handled_function_params(const struct parser_props *parser) {
   if (parser->has_function_params) {
     struct parser_props *cursor = parser->next;
     size_t depth = 0;
-    while (cursor && cursor->stacklen) {
+    while (is_own_subsidiary_parser(parser, cursor)) {
       if (depth) {
         fprintf(parser->out_stream, "and ");
       } else {
         fprintf(parser->out_stream, "and takes param(s) ");
       }
-      if (!pop_all(cursor)) {
+      if (!pop_subsidiary_parser(parser, cursor)) {
         return false;
       }
       depth++;
       struct parser_props *save_next = cursor->next;
       struct parser_props *save_prev = cursor->prev;
-      free(cursor);
+      free_parser(cursor);
       save_prev->next = save_next;
       if (save_next) {
         save_next->prev = save_prev;
@@ -2046,19 +2305,19 @@ bool handled_struct_or_union_members(struct parser_props *parser) {
        */
       parser->num_identifiers--;
     }
-    while (cursor && cursor->stacklen) {
+    while (is_own_subsidiary_parser(parser, cursor)) {
       if (depth) {
         fprintf(parser->out_stream, "and ");
       } else {
         fprintf(parser->out_stream, "has member(s) ");
       }
-      if (!pop_all(cursor)) {
+      if (!pop_subsidiary_parser(parser, cursor)) {
         return false;
       }
       depth++;
       struct parser_props *save_next = cursor->next;
       struct parser_props *save_prev = cursor->prev;
-      free(cursor);
+      free_parser(cursor);
       save_prev->next = save_next;
       if (save_next) {
         save_next->prev = save_prev;
@@ -2076,7 +2335,7 @@ bool handled_array_lengths(struct parser_props *parser, const size_t stacktop) {
   }
   top_ident = parser->num_identifiers - 1;
   if (parser->ident.array_dimensions[top_ident]) {
-    fprintf(parser->out_stream, "%s", parser->stack[stacktop].string);
+    fprintf(parser->out_stream, "%s", parser->stack.string[stacktop]);
     if (parser->ident.array_lengths[top_ident] > 1) {
       fprintf(parser->out_stream, "x");
     } else if ((UNSPECIFIED == parser->ident.last_dimension[top_ident]) &&
@@ -2108,7 +2367,7 @@ bool identifier_is_last(const struct parser_props *parser) {
    * identifier.
    */
   for (int i = parser->stacklen - 2; i >= 0; i--) {
-    if (identifier == parser->stack[i].kind) {
+    if (identifier == parser->stack.kind[i]) {
       return false;
     }
   }
@@ -2129,25 +2388,25 @@ bool pop_stack(struct parser_props *parser, bool no_enum_instance,
    * Qualifiers following * apply to the pointer itself, rather than to the
    * object to which the pointer points.
    */
-  if (!strcmp(parser->stack[stacktop].string, "*")) {
+  if (!strcmp(parser->stack.string[stacktop], "*")) {
     if (parser->is_function_ptr && !is_second_pointer_qualifier) {
       fprintf(parser->out_stream, "pointer to a function which returns ");
     } else {
       fprintf(parser->out_stream, "pointer to ");
     }
     if (parser->is_declarator_list && stacktop &&
-        (identifier == parser->stack[stacktop - 1].kind)) {
+        (identifier == parser->stack.kind[stacktop - 1])) {
       fprintf(parser->out_stream, " and ");
     }
   } else {
-    switch (parser->stack[stacktop].kind) {
+    switch (parser->stack.kind[stacktop]) {
     case qualifier:
       if (!handled_qualifiers(parser, stacktop)) {
         return false;
       }
       break;
     case type:
-      fprintf(parser->out_stream, "%s ", parser->stack[stacktop].string);
+      fprintf(parser->out_stream, "%s ", parser->stack.string[stacktop]);
       /* Process the function parameters right after processing the return value
        * of a function.  */
       if (!handled_function_params(parser)) {
@@ -2164,14 +2423,14 @@ bool pop_stack(struct parser_props *parser, bool no_enum_instance,
     case identifier:
       /* Delay printing "and" until after "array of" when applicable. */
       if (parser->is_declarator_list && stacktop &&
-          (identifier == parser->stack[stacktop - 1].kind) &&
+          (identifier == parser->stack.kind[stacktop - 1]) &&
           (!(parser->num_identifiers &&
              parser->ident.array_dimensions[parser->num_identifiers - 1]))) {
         fprintf(parser->out_stream, "%s is a(n) and ",
-                parser->stack[stacktop].string);
+                parser->stack.string[stacktop]);
       } else {
         fprintf(parser->out_stream, "%s is a(n) ",
-                parser->stack[stacktop].string);
+                parser->stack.string[stacktop]);
       }
       if (parser->is_typedef) {
         fprintf(parser->out_stream, "alias for ");
@@ -2231,16 +2490,133 @@ bool pop_stack(struct parser_props *parser, bool no_enum_instance,
     default:
       fprintf(parser->err_stream,
               "\nError: element %s is of unknown type %d.\n",
-              parser->stack[stacktop].string, parser->stack[stacktop].kind);
+              parser->stack.string[stacktop], parser->stack.kind[stacktop]);
+      return false;
+    }
+  }
+  memset(parser->stack.string[stacktop], '\0', MAXTOKENLEN);
+  parser->stack.kind[stacktop] = invalid;
+  return true;
+}
+
+/*
+ * Return the number of tokens at the bottom of the stack of a plain declarator
+ * list like "const long *a, b[4], c;" which all of the declarators share, or
+ * zero if the declaration is not a plain list.  Above the shared specifiers,
+ * each declarator's pointers, pointer qualifiers and array lengths sit
+ * immediately below its identifier.
+ */
+static size_t shared_specifier_count(const struct parser_props *parser) {
+  size_t prefix_len = 0;
+  size_t num_identifiers = 0;
+  if (!parser->is_declarator_list || parser->has_function_params ||
+      parser->has_struct_or_union_members || parser->has_enum_constants ||
+      parser->is_function || parser->is_function_ptr || parser->is_bitfield ||
+      parser->is_inline) {
+    return 0;
+  }
+  while ((prefix_len < parser->stacklen) &&
+         (identifier != parser->stack.kind[prefix_len]) &&
+         (length != parser->stack.kind[prefix_len]) &&
+         strcmp("*", parser->stack.string[prefix_len])) {
+    prefix_len++;
+  }
+  for (size_t i = prefix_len; i < parser->stacklen; i++) {
+    if (identifier == parser->stack.kind[i]) {
+      num_identifiers++;
+    }
+  }
+  if (!prefix_len || (num_identifiers != parser->num_identifiers) ||
+      (identifier != parser->stack.kind[parser->stacklen - 1])) {
+    return 0;
+  }
+  return prefix_len;
+}
+
+static void clear_stack_top(struct parser_props *parser) {
+  parser->stacklen--;
+  memset(parser->stack.string[parser->stacklen], '\0', MAXTOKENLEN);
+  parser->stack.kind[parser->stacklen] = invalid;
+}
+
+/*
+ * Explain a plain declarator list by rendering the shared specifiers once and
+ * appending the rendering to each declarator's pointer and array parts, so
+ * that "int a, *b;" produces "b is a(n) pointer to int and a is a(n) int".
+ */
+static bool popped_declarator_list(struct parser_props *parser,
+                                   const size_t prefix_len) {
+  char *prefix = NULL;
+  size_t prefix_size = 0;
+  FILE *out_stream = parser->out_stream;
+  FILE *capture = open_memstream(&prefix, &prefix_size);
+  if (!capture) {
+    exit(ENOMEM);
+  }
+  parser->out_stream = capture;
+  for (size_t i = prefix_len; i > 0; i--) {
+    if ((qualifier == parser->stack.kind[i - 1]) &&
+        !handled_qualifiers(parser, i - 1)) {
+      parser->out_stream = out_stream;
+      fclose(capture);
+      free(prefix);
       return false;
     }
+    if (type == parser->stack.kind[i - 1]) {
+      fprintf(parser->out_stream, "%s ", parser->stack.string[i - 1]);
+    }
+  }
+  parser->out_stream = out_stream;
+  fclose(capture);
+  /* "static" and "extern" leave no trailing space. */
+  const char *separator =
+      (prefix_size && (' ' != prefix[prefix_size - 1])) ? " and " : "and ";
+
+  while (parser->stacklen > prefix_len) {
+    const size_t top_ident = parser->num_identifiers - 1;
+    fprintf(parser->out_stream, "%s is a(n) ",
+            parser->stack.string[parser->stacklen - 1]);
+    if (parser->is_typedef) {
+      fprintf(parser->out_stream, "alias for ");
+    }
+    if (parser->ident.array_dimensions[top_ident]) {
+      fprintf(parser->out_stream, "array of ");
+    }
+    clear_stack_top(parser);
+    while ((parser->stacklen > prefix_len) &&
+           (identifier != parser->stack.kind[parser->stacklen - 1])) {
+      const size_t stacktop = parser->stacklen - 1;
+      if (length == parser->stack.kind[stacktop]) {
+        if (!handled_array_lengths(parser, stacktop)) {
+          free(prefix);
+          return false;
+        }
+      } else if (!strcmp("*", parser->stack.string[stacktop])) {
+        fprintf(parser->out_stream, "pointer to ");
+      } else if (!handled_qualifiers(parser, stacktop)) {
+        free(prefix);
+        return false;
+      }
+      clear_stack_top(parser);
+    }
+    fputs(prefix, parser->out_stream);
+    parser->num_identifiers--;
+    if (parser->stacklen > prefix_len) {
+      fputs(separator, parser->out_stream);
+    }
+  }
+  while (parser->stacklen) {
+    clear_stack_top(parser);
   }
-  memset(parser->stack[stacktop].string, '\0', MAXTOKENLEN);
-  parser->stack[stacktop].kind = invalid;
+  free(prefix);
   return true;
 }
 
 bool pop_all(struct parser_props *parser) {
+  const size_t prefix_len = shared_specifier_count(parser);
+  if (prefix_len) {
+    return popped_declarator_list(parser, prefix_len);
+  }
   /* If there is a non-enumeration constant identifier, it will be at the top of
    * the stack.  Therefore, the comparison with the enumerator_list
    * must proceed the first call to pop_stack() and be passed to it.
@@ -2251,8 +2627,8 @@ bool pop_all(struct parser_props *parser) {
   while (parser && parser->stacklen) {
     /* pop_stack() erases the final token. Save its string. */
     if (parser->stacklen) {
-      strlcpy(save, parser->stack[parser->stacklen - 1].string,
-              strlen(parser->stack[parser->stacklen - 1].string) + 1);
+      strlcpy(save, parser->stack.string[parser->stacklen - 1],
+              strlen(parser->stack.string[parser->stacklen - 1]) + 1);
     } else {
       strlcpy(save, "", 1);
     }
@@ -2463,7 +2839,7 @@ size_t gettoken(struct parser_props *parser, const char *declstring,
     }
   }
 #ifdef DEBUG
-  showstack(parser->stack, parser->stacklen, parser->out_stream, __LINE__);
+  showstack(&parser->stack, parser->stacklen, parser->out_stream, __LINE__);
 #endif
   return tokenoffset;
 }
@@ -2503,15 +2879,15 @@ bool qualifiers_are_incompatible(const struct parser_props *parser,
     return false;
   }
   while (--stacktop > 0) {
-    if (qualifier == parser->stack[stacktop - 1].kind) {
+    if (qualifier == parser->stack.kind[stacktop - 1]) {
       if (!strcmp(qualifier_name, "inline")) {
-        if ((0 == strcmp("extern", parser->stack[stacktop - 1].string)) ||
-            (0 == strcmp("static", parser->stack[stacktop - 1].string))) {
+        if ((0 == strcmp("extern", parser->stack.string[stacktop - 1])) ||
+            (0 == strcmp("static", parser->stack.string[stacktop - 1]))) {
           return false;
         } else {
           fprintf(parser->err_stream,
                   "Qualifiers %s and %s are incompatible.\n", qualifier_name,
-                  parser->stack[stacktop - 1].string);
+                  parser->stack.string[stacktop - 1]);
           return true;
         }
       } /* if inline */
@@ -2598,6 +2974,21 @@ bool finish_token(struct parser_props *parser, const char *offset_decl,
       memset(this_token->string, '\0', strlen(this_token->string));
       return false;
     }
+    /*
+     * Enum constants are collected in enumerator_list rather than declared,
+     * so only the instance name after the closing brace is counted.
+     */
+    if (parser->has_enum_constants && strchr(offset_decl, '}')) {
+      break;
+    }
+    /* Unreachable, since the input is at most MAXTOKENLEN characters. */
+    if (MAXIDENTIFIERS == parser->num_identifiers) {
+      fprintf(parser->err_stream,
+              "Declarations may have at most %u identifiers.\n",
+              MAXIDENTIFIERS);
+      this_token->kind = invalid;
+      return false;
+    }
     parser->num_identifiers++;
     top_ident = parser->num_identifiers - 1;
     if (!parser->have_type) {
@@ -2702,13 +3093,16 @@ bool finish_token(struct parser_props *parser, const char *offset_decl,
  * stacklen.
  */
 void push_stack(struct parser_props *parser, struct token *this_token) {
-  if (parser->stacklen >= MAXTOKENS) {
+  if ((parser->stacklen >= parser->stack.capacity) &&
+      !reserve_token_stack(parser, parser->stack.capacity
+                                       ? 2 * parser->stack.capacity
+                                       : INITIALTOKENS)) {
     fprintf(parser->err_stream, "\nStack overflow.\n");
     exit(-ENOMEM);
   }
 
-  parser->stack[parser->stacklen].kind = this_token->kind;
-  strlcpy(parser->stack[parser->stacklen].string, this_token->string,
+  parser->stack.kind[parser->stacklen] = this_token->kind;
+  strlcpy(parser->stack.string[parser->stacklen], this_token->string,
           strlen(this_token->string) + 1);
   parser->stacklen++;
   return;
@@ -2788,7 +3182,7 @@ size_t load_stack(struct parser_props *parser, char *user_input) {
      * While a function pointer itself must be named, the function
      * parameters need only have types.
      */
-    if (!(parser->has_struct_or_union_members ||
+    if (!(parser->has_struct_or_union_members || parser->has_enum_constants ||
           (parser->parent && (parser->parent->is_function_ptr ||
                               parser->parent->has_function_params)))) {
       fprintf(parser->err_stream,
@@ -2816,7 +3210,7 @@ size_t load_stack(struct parser_props *parser, char *user_input) {
   }
   reorder_stacks(parser);
 #ifdef DEBUG
-  showstack(parser->stack, parser->stacklen, parser->out_stream, __LINE__);
+  showstack(&parser->stack, parser->stacklen, parser->out_stream, __LINE__);
 #endif
   return parser->cursor;
 }
@@ -2850,7 +3244,7 @@ bool input_parsing_successful(struct parser_props *parser, char inputstr[]) {
     return false;
   }
 #ifdef DEBUG
-  showstack(parser->stack, parser->stacklen, parser->out_stream, __LINE__);
+  showstack(&parser->stack, parser->stacklen, parser->out_stream, __LINE__);
 #endif
   if (!pop_all(parser)) {
     return false;
@@ -2950,8 +3344,10 @@ int main(int argc, char **argv) {
     exit(EINVAL);
   }
   if (!input_parsing_successful(&parser, inputstr)) {
+    release_parser_resources(&parser);
     exit(EXIT_FAILURE);
   }
+  release_parser_resources(&parser);
   printf("\n");
   exit(EXIT_SUCCESS);
 }
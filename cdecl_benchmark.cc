@@ -0,0 +1,66 @@
+/*
+ * Time re-explanation of a declaration after a one-character edit, with and
+ * without the parameter cache.  Input is limited to MAXTOKENLEN characters, so
+ * the prototype has as many parameters as fit.
+ */
+#include <stdio.h>
+#include <time.h>
+
+#define TESTING
+
+#include "cdecl.c"
+
+#define ITERATIONS 20000
+
+static double elapsed_ns(const struct timespec *start,
+                         const struct timespec *end) {
+  return ((end->tv_sec - start->tv_sec) * 1e9) +
+         (double)(end->tv_nsec - start->tv_nsec);
+}
+
+static double time_explanations(const char *declaration,
+                                struct param_cache *cache, FILE *sink) {
+  char inputstr[MAXTOKENLEN];
+  struct parser_props parser;
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (size_t i = 0; i < ITERATIONS; i++) {
+    initialize_parser(&parser);
+    parser.out_stream = sink;
+    parser.err_stream = sink;
+    parser.cache = cache;
+    strlcpy(inputstr, declaration, MAXTOKENLEN);
+    /* The edit: the last parameter's name alternates between two letters. */
+    *strrchr(inputstr, ')') = '\0';
+    inputstr[strlen(inputstr) - 1] = (i % 2) ? 'y' : 'z';
+    strlcat(inputstr, ");", MAXTOKENLEN);
+    if (!input_parsing_successful(&parser, inputstr)) {
+      fprintf(stderr, "Failed to parse %s\n", inputstr);
+      exit(EXIT_FAILURE);
+    }
+    release_parser_resources(&parser);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  return elapsed_ns(&start, &end) / ITERATIONS;
+}
+
+int main(void) {
+  const char *declaration = "int f(int a, char *b, long c, short d, double e, "
+                            "float g, unsigned h, int i, char *j, long x);";
+  struct param_cache cache;
+  FILE *sink = fopen("/dev/null", "w");
+  if (!sink) {
+    perror("/dev/null");
+    exit(EXIT_FAILURE);
+  }
+  initialize_param_cache(&cache);
+  printf("%s\n", declaration);
+  printf("full parse:   %10.0f ns per edit\n",
+         time_explanations(declaration, NULL, sink));
+  printf("cached parse: %10.0f ns per edit\n",
+         time_explanations(declaration, &cache, sink));
+  printf("cache hits %lu, misses %lu\n", cache.hits, cache.misses);
+  release_param_cache(&cache);
+  fclose(sink);
+  exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,172 @@
+/*
+ * libFuzzer target for input_parsing_successful().  Besides the crashes and
+ * sanitizer reports which libFuzzer catches itself, the target times each
+ * parse and saves inputs whose cost per character is far above the running
+ * average, since input length is bounded by MAXTOKENLEN and super-linear
+ * behavior therefore shows up as a high per-character cost.
+ *
+ * Build with "make cdecl_fuzzer", then run
+ *   ./cdecl_fuzzer -max_len=127 corpus_dir
+ * Environment variables:
+ *   CDECL_SLOW_INPUT_DIR  where slow inputs are saved (cdecl_slow_inputs)
+ *   CDECL_SLOW_FACTOR     multiple of the average per-character cost which
+ *                         counts as slow (20)
+ *   CDECL_FAIL_ON_SLOW    if set, abort() on a slow input, so that
+ *                         "./cdecl_fuzzer cdecl_slow_inputs/slow-*" acts as
+ *                         a regression gate over the saved cases
+ */
+#include <errno.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#define TESTING
+
+#include "cdecl.c"
+
+/* Parses faster than this are never reported, since they are mostly noise. */
+#define SLOW_FLOOR_NS 200000.0
+/* Times a candidate slow input is re-parsed to rule out scheduling noise. */
+#define RETIMES 5
+/* Parses of known-good declarations which set the initial average cost. */
+#define CALIBRATION_RUNS 1000
+
+static FILE *sink;
+static const char *slow_input_dir = "cdecl_slow_inputs";
+static double slow_factor = 20.0;
+static bool fail_on_slow;
+static double mean_ns_per_char;
+static size_t timed_inputs;
+
+static double elapsed_ns(const struct timespec *start,
+                         const struct timespec *end) {
+  return ((end->tv_sec - start->tv_sec) * 1e9) +
+         (double)(end->tv_nsec - start->tv_nsec);
+}
+
+/* FNV-1a, which is good enough to give saved inputs distinct names. */
+static uint64_t input_hash(const uint8_t *data, const size_t size) {
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (size_t i = 0; i < size; i++) {
+    hash = (hash ^ data[i]) * 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+static void save_slow_input(const uint8_t *data, const size_t size,
+                            const double ns) {
+  char path[PATH_MAX];
+  if (mkdir(slow_input_dir, 0755) && (EEXIST != errno)) {
+    perror(slow_input_dir);
+    return;
+  }
+  snprintf(path, sizeof(path), "%s/slow-%016lx", slow_input_dir,
+           (unsigned long)input_hash(data, size));
+  FILE *saved = fopen(path, "w");
+  if (!saved) {
+    perror(path);
+    return;
+  }
+  fwrite(data, 1, size, saved);
+  fclose(saved);
+  fprintf(stderr, "Slow input (%.0f ns for %lu chars, average %.0f ns/char) "
+          "saved to %s\n",
+          ns, size, mean_ns_per_char, path);
+}
+
+static double timed_parse(const char *declaration) {
+  char inputstr[MAXTOKENLEN];
+  struct parser_props parser;
+  struct timespec start, end;
+  strlcpy(inputstr, declaration, MAXTOKENLEN);
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  initialize_parser(&parser);
+  parser.out_stream = sink;
+  parser.err_stream = sink;
+  input_parsing_successful(&parser, inputstr);
+  release_parser_resources(&parser);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  return elapsed_ns(&start, &end);
+}
+
+/*
+ * Seed the average with ordinary declarations, so that replaying a handful of
+ * saved slow inputs is judged against the same baseline as a long fuzzing
+ * run.
+ */
+static void calibrate(void) {
+  const char *declarations[] = {
+      "int x;",
+      "const unsigned int *p;",
+      "uint64_t hash(char *key, uint64_t seed);",
+      "struct point {int x; int y;} origin;",
+      "enum color {RED, GREEN, BLUE} c;",
+      "void (*handler)(int sig, void *context);",
+      "int a, b[4], *c;",
+  };
+  for (size_t i = 0; i < CALIBRATION_RUNS; i++) {
+    const char *declaration = declarations[i % ARRAY_SIZE(declarations)];
+    const double ns_per_char = timed_parse(declaration) / strlen(declaration);
+    timed_inputs++;
+    mean_ns_per_char +=
+        (ns_per_char - mean_ns_per_char) / (double)timed_inputs;
+  }
+}
+
+extern "C" int LLVMFuzzerInitialize(int *argc, char ***argv) {
+  (void)argc;
+  (void)argv;
+  const char *setting = getenv("CDECL_SLOW_INPUT_DIR");
+  if (setting) {
+    slow_input_dir = setting;
+  }
+  setting = getenv("CDECL_SLOW_FACTOR");
+  if (setting && (strtod(setting, NULL) > 1.0)) {
+    slow_factor = strtod(setting, NULL);
+  }
+  fail_on_slow = (NULL != getenv("CDECL_FAIL_ON_SLOW"));
+  sink = fopen("/dev/null", "w");
+  if (!sink) {
+    perror("/dev/null");
+    exit(EXIT_FAILURE);
+  }
+  calibrate();
+  return 0;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+  char inputstr[MAXTOKENLEN];
+  /* main() rejects longer input, so don't bother parsing it. */
+  if (size > (MAXTOKENLEN - 1)) {
+    return -1;
+  }
+  memcpy(inputstr, data, size);
+  inputstr[size] = '\0';
+
+  const double chars = (double)(size ? size : 1);
+  double ns = timed_parse(inputstr);
+  for (size_t i = 0;
+       (i < RETIMES) && (ns > SLOW_FLOOR_NS) &&
+       ((ns / chars) > slow_factor * mean_ns_per_char);
+       i++) {
+    const double retimed = timed_parse(inputstr);
+    if (retimed < ns) {
+      ns = retimed;
+    }
+  }
+  const double ns_per_char = ns / chars;
+  if ((ns > SLOW_FLOOR_NS) &&
+      (ns_per_char > slow_factor * mean_ns_per_char)) {
+    save_slow_input(data, size, ns);
+    if (fail_on_slow) {
+      abort();
+    }
+    /* Keep outliers from inflating the average. */
+    return 0;
+  }
+  timed_inputs++;
+  mean_ns_per_char += (ns_per_char - mean_ns_per_char) / (double)timed_inputs;
+  return 0;
+}
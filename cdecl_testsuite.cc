@@ -187,6 +187,7 @@ TEST(StringManipulateSuite, GetKindIdentifiers) {
 
 struct TokenizerSuite : public Test {
   TokenizerSuite() { initialize_parser(&parser); }
+  ~TokenizerSuite() override { release_parser_resources(&parser); }
   struct token this_token;
   struct parser_props parser;
 };
@@ -395,8 +396,8 @@ TEST_F(TokenizerSuite, PushEmptyStack) {
   struct token token0{type, "int"};
   EXPECT_THAT(parser.stacklen, Eq(0));
   push_stack(&parser, &token0);
-  EXPECT_THAT(parser.stack[0].kind, Eq(type));
-  EXPECT_THAT(parser.stack[0].string, StrEq("int"));
+  EXPECT_THAT(parser.stack.kind[0], Eq(type));
+  EXPECT_THAT(parser.stack.string[0], StrEq("int"));
   EXPECT_THAT(parser.stacklen, Eq(1));
 }
 
@@ -406,10 +407,10 @@ TEST_F(TokenizerSuite, Push2ndElement) {
   push_stack(&parser, &token0);
   struct token token1{qualifier, "const"};
   push_stack(&parser, &token1);
-  EXPECT_THAT(parser.stack[0].kind, Eq(type));
-  EXPECT_THAT(parser.stack[0].string, StrEq("int"));
-  EXPECT_THAT(parser.stack[1].kind, Eq(qualifier));
-  EXPECT_THAT(parser.stack[1].string, StrEq("const"));
+  EXPECT_THAT(parser.stack.kind[0], Eq(type));
+  EXPECT_THAT(parser.stack.string[0], StrEq("int"));
+  EXPECT_THAT(parser.stack.kind[1], Eq(qualifier));
+  EXPECT_THAT(parser.stack.string[1], StrEq("const"));
   EXPECT_THAT(parser.stacklen, Eq(2));
 }
 
@@ -436,6 +437,7 @@ TEST(CheckForEnumerators, WellFormedSimple) {
   parser.is_enum = true;
   EXPECT_THAT(check_for_enum_constants(&parser, offset_decl), IsTrue());
   EXPECT_THAT(parser.has_enum_constants, IsFalse());
+  release_parser_resources(&parser);
 }
 
 TEST(CheckForEnumerators, WellFormedEnumerators) {
@@ -445,6 +447,7 @@ TEST(CheckForEnumerators, WellFormedEnumerators) {
   parser.is_enum = true;
   EXPECT_THAT(check_for_enum_constants(&parser, offset_decl), IsTrue());
   EXPECT_THAT(parser.has_enum_constants, IsTrue());
+  release_parser_resources(&parser);
 }
 
 TEST(CheckForEnumerators, MismatchedDelims) {
@@ -454,6 +457,7 @@ TEST(CheckForEnumerators, MismatchedDelims) {
   parser.is_enum = true;
   EXPECT_THAT(check_for_enum_constants(&parser, offset_decl), IsFalse());
   EXPECT_THAT(parser.has_enum_constants, IsFalse());
+  release_parser_resources(&parser);
 }
 
 TEST(ElideAssignments, NoEquals) {
@@ -635,6 +639,15 @@ TEST(ElideAssignments, DeclaratorListIntAssignmentAll) {
   EXPECT_THAT(input, StrEq("int a, b, c;"));
 }
 
+/* Found by cdecl_fuzzer: the blank-skipping loop read before the buffer. */
+TEST(ElideAssignments, LeadingEquals) {
+  const char *probe = "= 2;";
+  _cleanup_(freep) char *input = (char *)malloc(strlen(probe) + 1);
+  strlcpy(input, probe, strlen(probe) + 1);
+  elide_assignments(&input);
+  EXPECT_THAT(input, StrEq(";"));
+}
+
 TEST(ParensMatch, SimpleCase) {
   const char *probe = "int (*ap)[2] = &a;";
   size_t pair_count = 0;
@@ -765,21 +778,22 @@ TEST(ReorderArrayLengthsTest, SimpleCase) {
   parser.ident.array_lengths[0] = 1;
   parser.ident.last_dimension[0] = UNSPECIFIED;
   parser.stacklen = 4;
-  parser.stack[0].kind = type;
-  strlcpy(parser.stack[0].string, "uint64_t", strlen("uint64_t") + 1);
-  parser.stack[1].kind = qualifier;
-  strlcpy(parser.stack[1].string, "*", 2);
-  parser.stack[2].kind = identifier;
-  strlcpy(parser.stack[2].string, "entry", strlen("entry") + 1);
-  parser.stack[3].kind = length;
-  strlcpy(parser.stack[3].string, "7", 2);
+  parser.stack.kind[0] = type;
+  strlcpy(parser.stack.string[0], "uint64_t", strlen("uint64_t") + 1);
+  parser.stack.kind[1] = qualifier;
+  strlcpy(parser.stack.string[1], "*", 2);
+  parser.stack.kind[2] = identifier;
+  strlcpy(parser.stack.string[2], "entry", strlen("entry") + 1);
+  parser.stack.kind[3] = length;
+  strlcpy(parser.stack.string[3], "7", 2);
   reorder_array_identifier_and_lengths(&parser);
   ASSERT_THAT(parser.num_identifiers, Eq(1));
   EXPECT_THAT(parser.stacklen, Eq(4));
-  EXPECT_THAT(parser.stack[2].kind, Eq(length));
-  EXPECT_THAT(parser.stack[2].string, StrEq("7"));
-  EXPECT_THAT(parser.stack[3].kind, Eq(identifier));
-  EXPECT_THAT(parser.stack[3].string, StrEq("entry"));
+  EXPECT_THAT(parser.stack.kind[2], Eq(length));
+  EXPECT_THAT(parser.stack.string[2], StrEq("7"));
+  EXPECT_THAT(parser.stack.kind[3], Eq(identifier));
+  EXPECT_THAT(parser.stack.string[3], StrEq("entry"));
+  release_parser_resources(&parser);
 }
 
 /*
@@ -793,27 +807,28 @@ TEST(ReorderArrayLengthsTest, DeclaratorListWithArrayLast) {
   parser.ident.array_lengths[1] = 1;
   parser.ident.last_dimension[1] = UNSPECIFIED;
   parser.stacklen = 5;
-  parser.stack[0].kind = type;
-  strlcpy(parser.stack[0].string, "uint64_t", strlen("uint64_t") + 1);
-  parser.stack[1].kind = identifier;
-  strlcpy(parser.stack[1].string, "index", strlen("index") + 1);
-  parser.stack[2].kind = qualifier;
-  strlcpy(parser.stack[2].string, "*", 2);
-  parser.stack[3].kind = identifier;
-  strlcpy(parser.stack[3].string, "entry", strlen("entry") + 1);
-  parser.stack[4].kind = length;
-  strlcpy(parser.stack[4].string, "7", 2);
+  parser.stack.kind[0] = type;
+  strlcpy(parser.stack.string[0], "uint64_t", strlen("uint64_t") + 1);
+  parser.stack.kind[1] = identifier;
+  strlcpy(parser.stack.string[1], "index", strlen("index") + 1);
+  parser.stack.kind[2] = qualifier;
+  strlcpy(parser.stack.string[2], "*", 2);
+  parser.stack.kind[3] = identifier;
+  strlcpy(parser.stack.string[3], "entry", strlen("entry") + 1);
+  parser.stack.kind[4] = length;
+  strlcpy(parser.stack.string[4], "7", 2);
   std::cout << "Before reorder_array_identifier_and_lengths()" << std::endl;
-  showstack(&parser.stack[0], parser.stacklen, stdout, __LINE__);
+  showstack(&parser.stack, parser.stacklen, stdout, __LINE__);
   reorder_array_identifier_and_lengths(&parser);
   std::cout << "After reorder_array_identifier_and_lengths()" << std::endl;
-  showstack(&parser.stack[0], parser.stacklen, stdout, __LINE__);
+  showstack(&parser.stack, parser.stacklen, stdout, __LINE__);
   ASSERT_THAT(parser.num_identifiers, Eq(2));
   EXPECT_THAT(parser.stacklen, Eq(5));
-  EXPECT_THAT(parser.stack[3].kind, Eq(length));
-  EXPECT_THAT(parser.stack[3].string, StrEq("7"));
-  EXPECT_THAT(parser.stack[4].kind, Eq(identifier));
-  EXPECT_THAT(parser.stack[4].string, StrEq("entry"));
+  EXPECT_THAT(parser.stack.kind[3], Eq(length));
+  EXPECT_THAT(parser.stack.string[3], StrEq("7"));
+  EXPECT_THAT(parser.stack.kind[4], Eq(identifier));
+  EXPECT_THAT(parser.stack.string[4], StrEq("entry"));
+  release_parser_resources(&parser);
 }
 
 /*
@@ -827,27 +842,28 @@ TEST(ReorderArrayLengthsTest, DeclaratorListWithArrayFirst) {
   parser.ident.array_lengths[0] = 1;
   parser.ident.last_dimension[1] = UNSPECIFIED;
   parser.stacklen = 5;
-  parser.stack[0].kind = type;
-  strlcpy(parser.stack[0].string, "uint64_t", strlen("uint64_t") + 1);
-  parser.stack[1].kind = identifier;
-  strlcpy(parser.stack[1].string, "entry", strlen("entry") + 1);
-  parser.stack[2].kind = length;
-  strlcpy(parser.stack[2].string, "7", 2);
-  parser.stack[3].kind = qualifier;
-  strlcpy(parser.stack[3].string, "*", 2);
-  parser.stack[4].kind = identifier;
-  strlcpy(parser.stack[4].string, "index", strlen("index") + 1);
+  parser.stack.kind[0] = type;
+  strlcpy(parser.stack.string[0], "uint64_t", strlen("uint64_t") + 1);
+  parser.stack.kind[1] = identifier;
+  strlcpy(parser.stack.string[1], "entry", strlen("entry") + 1);
+  parser.stack.kind[2] = length;
+  strlcpy(parser.stack.string[2], "7", 2);
+  parser.stack.kind[3] = qualifier;
+  strlcpy(parser.stack.string[3], "*", 2);
+  parser.stack.kind[4] = identifier;
+  strlcpy(parser.stack.string[4], "index", strlen("index") + 1);
   std::cout << "Before reorder_array_identifier_and_lengths()" << std::endl;
-  showstack(&parser.stack[0], parser.stacklen, stdout, __LINE__);
+  showstack(&parser.stack, parser.stacklen, stdout, __LINE__);
   reorder_array_identifier_and_lengths(&parser);
   std::cout << "After reorder_array_identifier_and_lengths()" << std::endl;
-  showstack(&parser.stack[0], parser.stacklen, stdout, __LINE__);
+  showstack(&parser.stack, parser.stacklen, stdout, __LINE__);
   ASSERT_THAT(parser.num_identifiers, Eq(2));
   EXPECT_THAT(parser.stacklen, Eq(5));
-  EXPECT_THAT(parser.stack[1].kind, Eq(length));
-  EXPECT_THAT(parser.stack[1].string, StrEq("7"));
-  EXPECT_THAT(parser.stack[2].kind, Eq(identifier));
-  EXPECT_THAT(parser.stack[2].string, StrEq("entry"));
+  EXPECT_THAT(parser.stack.kind[1], Eq(length));
+  EXPECT_THAT(parser.stack.string[1], StrEq("7"));
+  EXPECT_THAT(parser.stack.kind[2], Eq(identifier));
+  EXPECT_THAT(parser.stack.string[2], StrEq("entry"));
+  release_parser_resources(&parser);
 }
 
 /*
@@ -861,29 +877,30 @@ TEST(ReorderArrayLengthsTest, DeclaratorListWithArrayMiddle) {
   parser.ident.array_lengths[1] = 1;
   parser.ident.last_dimension[1] = UNSPECIFIED;
   parser.stacklen = 6;
-  parser.stack[0].kind = type;
-  strlcpy(parser.stack[0].string, "uint64_t", strlen("uint64_t") + 1);
-  parser.stack[1].kind = identifier;
-  strlcpy(parser.stack[1].string, "target", strlen("target") + 1);
-  parser.stack[2].kind = identifier;
-  strlcpy(parser.stack[2].string, "entry", strlen("entry") + 1);
-  parser.stack[3].kind = length;
-  strlcpy(parser.stack[3].string, "7", 2);
-  parser.stack[4].kind = qualifier;
-  strlcpy(parser.stack[4].string, "*", 2);
-  parser.stack[5].kind = identifier;
-  strlcpy(parser.stack[5].string, "index", strlen("index") + 1);
+  parser.stack.kind[0] = type;
+  strlcpy(parser.stack.string[0], "uint64_t", strlen("uint64_t") + 1);
+  parser.stack.kind[1] = identifier;
+  strlcpy(parser.stack.string[1], "target", strlen("target") + 1);
+  parser.stack.kind[2] = identifier;
+  strlcpy(parser.stack.string[2], "entry", strlen("entry") + 1);
+  parser.stack.kind[3] = length;
+  strlcpy(parser.stack.string[3], "7", 2);
+  parser.stack.kind[4] = qualifier;
+  strlcpy(parser.stack.string[4], "*", 2);
+  parser.stack.kind[5] = identifier;
+  strlcpy(parser.stack.string[5], "index", strlen("index") + 1);
   std::cout << "Before reorder_array_identifier_and_lengths()" << std::endl;
-  showstack(&parser.stack[0], parser.stacklen, stdout, __LINE__);
+  showstack(&parser.stack, parser.stacklen, stdout, __LINE__);
   reorder_array_identifier_and_lengths(&parser);
   std::cout << "After reorder_array_identifier_and_lengths()" << std::endl;
-  showstack(&parser.stack[0], parser.stacklen, stdout, __LINE__);
+  showstack(&parser.stack, parser.stacklen, stdout, __LINE__);
   ASSERT_THAT(parser.num_identifiers, Eq(3));
   EXPECT_THAT(parser.stacklen, Eq(6));
-  EXPECT_THAT(parser.stack[2].kind, Eq(length));
-  EXPECT_THAT(parser.stack[2].string, StrEq("7"));
-  EXPECT_THAT(parser.stack[3].kind, Eq(identifier));
-  EXPECT_THAT(parser.stack[3].string, StrEq("entry"));
+  EXPECT_THAT(parser.stack.kind[2], Eq(length));
+  EXPECT_THAT(parser.stack.string[2], StrEq("7"));
+  EXPECT_THAT(parser.stack.kind[3], Eq(identifier));
+  EXPECT_THAT(parser.stack.string[3], StrEq("entry"));
+  release_parser_resources(&parser);
 }
 
 /*
@@ -897,33 +914,34 @@ TEST(ReorderArrayLengthsTest, DeclaratorListWithArrayMiddleMultipleLengths) {
   parser.ident.array_lengths[1] = 2;
   parser.ident.last_dimension[1] = SPECIFIED;
   parser.stacklen = 7;
-  parser.stack[0].kind = type;
-  strlcpy(parser.stack[0].string, "uint64_t", strlen("uint64_t") + 1);
-  parser.stack[1].kind = identifier;
-  strlcpy(parser.stack[1].string, "target", strlen("target") + 1);
-  parser.stack[2].kind = identifier;
-  strlcpy(parser.stack[2].string, "entry", strlen("entry") + 1);
-  parser.stack[3].kind = length;
-  strlcpy(parser.stack[3].string, "7", 2);
-  parser.stack[4].kind = length;
-  strlcpy(parser.stack[4].string, "4", 2);
-  parser.stack[5].kind = qualifier;
-  strlcpy(parser.stack[5].string, "*", 2);
-  parser.stack[6].kind = identifier;
-  strlcpy(parser.stack[6].string, "index", strlen("index") + 1);
+  parser.stack.kind[0] = type;
+  strlcpy(parser.stack.string[0], "uint64_t", strlen("uint64_t") + 1);
+  parser.stack.kind[1] = identifier;
+  strlcpy(parser.stack.string[1], "target", strlen("target") + 1);
+  parser.stack.kind[2] = identifier;
+  strlcpy(parser.stack.string[2], "entry", strlen("entry") + 1);
+  parser.stack.kind[3] = length;
+  strlcpy(parser.stack.string[3], "7", 2);
+  parser.stack.kind[4] = length;
+  strlcpy(parser.stack.string[4], "4", 2);
+  parser.stack.kind[5] = qualifier;
+  strlcpy(parser.stack.string[5], "*", 2);
+  parser.stack.kind[6] = identifier;
+  strlcpy(parser.stack.string[6], "index", strlen("index") + 1);
   std::cout << "Before reorder_array_identifier_and_lengths()" << std::endl;
-  showstack(&parser.stack[0], parser.stacklen, stdout, __LINE__);
+  showstack(&parser.stack, parser.stacklen, stdout, __LINE__);
   reorder_array_identifier_and_lengths(&parser);
   std::cout << "After reorder_array_identifier_and_lengths()" << std::endl;
-  showstack(&parser.stack[0], parser.stacklen, stdout, __LINE__);
+  showstack(&parser.stack, parser.stacklen, stdout, __LINE__);
   ASSERT_THAT(parser.num_identifiers, Eq(3));
   EXPECT_THAT(parser.stacklen, Eq(7));
-  EXPECT_THAT(parser.stack[2].kind, Eq(length));
-  EXPECT_THAT(parser.stack[2].string, StrEq("4"));
-  EXPECT_THAT(parser.stack[3].kind, Eq(length));
-  EXPECT_THAT(parser.stack[3].string, StrEq("7"));
-  EXPECT_THAT(parser.stack[4].kind, Eq(identifier));
-  EXPECT_THAT(parser.stack[4].string, StrEq("entry"));
+  EXPECT_THAT(parser.stack.kind[2], Eq(length));
+  EXPECT_THAT(parser.stack.string[2], StrEq("4"));
+  EXPECT_THAT(parser.stack.kind[3], Eq(length));
+  EXPECT_THAT(parser.stack.string[3], StrEq("7"));
+  EXPECT_THAT(parser.stack.kind[4], Eq(identifier));
+  EXPECT_THAT(parser.stack.string[4], StrEq("entry"));
+  release_parser_resources(&parser);
 }
 
 /*
@@ -940,35 +958,36 @@ TEST(ReorderArrayLengthsTest, DeclaratorListWithArrayFirstAndLast) {
   parser.ident.array_lengths[2] = 1;
   parser.ident.last_dimension[2] = SPECIFIED;
   parser.stacklen = 7;
-  parser.stack[0].kind = type;
-  strlcpy(parser.stack[0].string, "uint64_t", strlen("uint64_t") + 1);
-  parser.stack[1].kind = identifier;
-  strlcpy(parser.stack[1].string, "target", strlen("target") + 1);
-  parser.stack[2].kind = length;
-  strlcpy(parser.stack[2].string, "1", 2);
-  parser.stack[3].kind = identifier;
-  strlcpy(parser.stack[3].string, "entry", strlen("entry") + 1);
-  parser.stack[4].kind = qualifier;
-  strlcpy(parser.stack[4].string, "*", 2);
-  parser.stack[5].kind = identifier;
-  strlcpy(parser.stack[5].string, "index", strlen("index") + 1);
-  parser.stack[6].kind = length;
-  strlcpy(parser.stack[6].string, "2", 2);
+  parser.stack.kind[0] = type;
+  strlcpy(parser.stack.string[0], "uint64_t", strlen("uint64_t") + 1);
+  parser.stack.kind[1] = identifier;
+  strlcpy(parser.stack.string[1], "target", strlen("target") + 1);
+  parser.stack.kind[2] = length;
+  strlcpy(parser.stack.string[2], "1", 2);
+  parser.stack.kind[3] = identifier;
+  strlcpy(parser.stack.string[3], "entry", strlen("entry") + 1);
+  parser.stack.kind[4] = qualifier;
+  strlcpy(parser.stack.string[4], "*", 2);
+  parser.stack.kind[5] = identifier;
+  strlcpy(parser.stack.string[5], "index", strlen("index") + 1);
+  parser.stack.kind[6] = length;
+  strlcpy(parser.stack.string[6], "2", 2);
   std::cout << "Before reorder_array_identifier_and_lengths()" << std::endl;
-  showstack(&parser.stack[0], parser.stacklen, stdout, __LINE__);
+  showstack(&parser.stack, parser.stacklen, stdout, __LINE__);
   reorder_array_identifier_and_lengths(&parser);
   std::cout << "After reorder_array_identifier_and_lengths()" << std::endl;
-  showstack(&parser.stack[0], parser.stacklen, stdout, __LINE__);
+  showstack(&parser.stack, parser.stacklen, stdout, __LINE__);
   ASSERT_THAT(parser.num_identifiers, Eq(3));
   EXPECT_THAT(parser.stacklen, Eq(7));
-  EXPECT_THAT(parser.stack[1].kind, Eq(length));
-  EXPECT_THAT(parser.stack[1].string, StrEq("1"));
-  EXPECT_THAT(parser.stack[2].kind, Eq(identifier));
-  EXPECT_THAT(parser.stack[2].string, StrEq("target"));
-  EXPECT_THAT(parser.stack[5].kind, Eq(length));
-  EXPECT_THAT(parser.stack[5].string, StrEq("2"));
-  EXPECT_THAT(parser.stack[6].kind, Eq(identifier));
-  EXPECT_THAT(parser.stack[6].string, StrEq("index"));
+  EXPECT_THAT(parser.stack.kind[1], Eq(length));
+  EXPECT_THAT(parser.stack.string[1], StrEq("1"));
+  EXPECT_THAT(parser.stack.kind[2], Eq(identifier));
+  EXPECT_THAT(parser.stack.string[2], StrEq("target"));
+  EXPECT_THAT(parser.stack.kind[5], Eq(length));
+  EXPECT_THAT(parser.stack.string[5], StrEq("2"));
+  EXPECT_THAT(parser.stack.kind[6], Eq(identifier));
+  EXPECT_THAT(parser.stack.string[6], StrEq("index"));
+  release_parser_resources(&parser);
 }
 
 /*
@@ -986,39 +1005,40 @@ TEST(ReorderArrayLengthsTest,
   parser.ident.array_lengths[2] = 2;
   parser.ident.last_dimension[2] = SPECIFIED;
   parser.stacklen = 8;
-  parser.stack[0].kind = type;
-  strlcpy(parser.stack[0].string, "uint64_t", strlen("uint64_t") + 1);
-  parser.stack[1].kind = identifier;
-  strlcpy(parser.stack[1].string, "target", strlen("target") + 1);
-  parser.stack[2].kind = length;
-  strlcpy(parser.stack[2].string, "1", 2);
-  parser.stack[3].kind = identifier;
-  strlcpy(parser.stack[3].string, "entry", strlen("entry") + 1);
-  parser.stack[4].kind = qualifier;
-  strlcpy(parser.stack[4].string, "*", 2);
-  parser.stack[5].kind = identifier;
-  strlcpy(parser.stack[5].string, "index", strlen("index") + 1);
-  parser.stack[6].kind = length;
-  strlcpy(parser.stack[6].string, "2", 2);
-  parser.stack[7].kind = length;
-  strlcpy(parser.stack[7].string, "3", 2);
+  parser.stack.kind[0] = type;
+  strlcpy(parser.stack.string[0], "uint64_t", strlen("uint64_t") + 1);
+  parser.stack.kind[1] = identifier;
+  strlcpy(parser.stack.string[1], "target", strlen("target") + 1);
+  parser.stack.kind[2] = length;
+  strlcpy(parser.stack.string[2], "1", 2);
+  parser.stack.kind[3] = identifier;
+  strlcpy(parser.stack.string[3], "entry", strlen("entry") + 1);
+  parser.stack.kind[4] = qualifier;
+  strlcpy(parser.stack.string[4], "*", 2);
+  parser.stack.kind[5] = identifier;
+  strlcpy(parser.stack.string[5], "index", strlen("index") + 1);
+  parser.stack.kind[6] = length;
+  strlcpy(parser.stack.string[6], "2", 2);
+  parser.stack.kind[7] = length;
+  strlcpy(parser.stack.string[7], "3", 2);
   std::cout << "Before reorder_array_identifier_and_lengths()" << std::endl;
-  showstack(&parser.stack[0], parser.stacklen, stdout, __LINE__);
+  showstack(&parser.stack, parser.stacklen, stdout, __LINE__);
   reorder_array_identifier_and_lengths(&parser);
   std::cout << "After reorder_array_identifier_and_lengths()" << std::endl;
-  showstack(&parser.stack[0], parser.stacklen, stdout, __LINE__);
+  showstack(&parser.stack, parser.stacklen, stdout, __LINE__);
   ASSERT_THAT(parser.num_identifiers, Eq(3));
   EXPECT_THAT(parser.stacklen, Eq(8));
-  EXPECT_THAT(parser.stack[1].kind, Eq(length));
-  EXPECT_THAT(parser.stack[1].string, StrEq("1"));
-  EXPECT_THAT(parser.stack[2].kind, Eq(identifier));
-  EXPECT_THAT(parser.stack[2].string, StrEq("target"));
-  EXPECT_THAT(parser.stack[5].kind, Eq(length));
-  EXPECT_THAT(parser.stack[5].string, StrEq("3"));
-  EXPECT_THAT(parser.stack[6].kind, Eq(length));
-  EXPECT_THAT(parser.stack[6].string, StrEq("2"));
-  EXPECT_THAT(parser.stack[7].kind, Eq(identifier));
-  EXPECT_THAT(parser.stack[7].string, StrEq("index"));
+  EXPECT_THAT(parser.stack.kind[1], Eq(length));
+  EXPECT_THAT(parser.stack.string[1], StrEq("1"));
+  EXPECT_THAT(parser.stack.kind[2], Eq(identifier));
+  EXPECT_THAT(parser.stack.string[2], StrEq("target"));
+  EXPECT_THAT(parser.stack.kind[5], Eq(length));
+  EXPECT_THAT(parser.stack.string[5], StrEq("3"));
+  EXPECT_THAT(parser.stack.kind[6], Eq(length));
+  EXPECT_THAT(parser.stack.string[6], StrEq("2"));
+  EXPECT_THAT(parser.stack.kind[7], Eq(identifier));
+  EXPECT_THAT(parser.stack.string[7], StrEq("index"));
+  release_parser_resources(&parser);
 }
 
 struct ParserSuite : public Test {
@@ -1030,6 +1050,7 @@ struct ParserSuite : public Test {
   }
 
   ~ParserSuite() override {
+    release_parser_resources(&parser);
     fclose(fake_stdout);
     fclose(fake_stderr);
   }
@@ -1208,12 +1229,12 @@ TEST_F(ParserSuite, ProcessFunctionParamsOneParam) {
   EXPECT_THAT(user_input + parser.cursor, StrEq(""));
   ASSERT_THAT(parser.next, Not(IsNull()));
   EXPECT_THAT(parser.next->stacklen, Eq(2));
-  EXPECT_THAT(parser.next->stack[0].kind, Eq(type));
-  EXPECT_THAT(parser.next->stack[0].string, StrEq("double"));
-  EXPECT_THAT(parser.next->stack[1].kind, Eq(identifier));
-  EXPECT_THAT(parser.next->stack[1].string, StrEq("val"));
+  EXPECT_THAT(parser.next->stack.kind[0], Eq(type));
+  EXPECT_THAT(parser.next->stack.string[0], StrEq("double"));
+  EXPECT_THAT(parser.next->stack.kind[1], Eq(identifier));
+  EXPECT_THAT(parser.next->stack.string[1], StrEq("val"));
   // Normally freed by pop_stack().
-  free(parser.next);
+  release_subsidiary_parsers(&parser);
 }
 
 TEST_F(ParserSuite, ProcessFunctionParamsOneParamBadDelim) {
@@ -1249,7 +1270,7 @@ TEST_F(ParserSuite, LoadStackFunctionExcessType) {
   strlcpy(user_input, probe, strlen(probe) + 1);
   std::size_t consumed = load_stack(&parser, user_input);
   parser.err_stream = stderr;
-  showstack(&parser.stack[0], parser.stacklen, stdout, __LINE__);
+  showstack(&parser.stack, parser.stacklen, stdout, __LINE__);
   EXPECT_THAT(consumed, Eq(0));
   release_parser_resources(&parser);
 }
@@ -1285,13 +1306,39 @@ TEST_F(ParserSuite, ProcessFunctionParamsTwoParams) {
   EXPECT_THAT(
       StdoutMatches("Token number 1 has kind identifier and string seed"),
       IsTrue());
-  struct parser_props *pnext = parser.next;
-  while (pnext) {
-    struct parser_props *save = pnext->next;
-    std::cout << "Test: freeing pnext: " << std::hex << pnext << std::endl;
-    free(pnext);
-    pnext = save;
+  release_subsidiary_parsers(&parser);
+}
+
+TEST_F(ParserSuite, SubsidiaryParserStacksStaySmall) {
+  char user_input[MAXTOKENLEN];
+  const char *query = "uint64_t hash(char *key, uint64_t seed)";
+  parser.cursor = strlen("uint64_t hash");
+  parser.have_type = true;
+  parser.has_function_params = true;
+  parser.start_delim = '(';
+  parser.end_delim = ')';
+  parser.separator = ',';
+  strlcpy(user_input, query, strlen(query) + 1);
+
+  process_secondary_params(&parser, user_input);
+  ASSERT_THAT(parser.next, Not(IsNull()));
+  for (struct parser_props *pnext = parser.next; pnext; pnext = pnext->next) {
+    EXPECT_THAT(pnext->stack.capacity, Le(static_cast<size_t>(INITIALTOKENS)));
+    EXPECT_THAT(pnext->stacklen, Le(pnext->stack.capacity));
+  }
+}
+
+TEST_F(ParserSuite, TokenStackGrowsOnDemand) {
+  struct token this_token;
+  this_token.kind = qualifier;
+  strlcpy(this_token.string, "*", MAXTOKENLEN);
+  for (size_t i = 0; i < 2 * INITIALTOKENS + 1; i++) {
+    push_stack(&parser, &this_token);
   }
+  EXPECT_THAT(parser.stacklen, Eq(static_cast<size_t>(2 * INITIALTOKENS + 1)));
+  EXPECT_THAT(parser.stack.capacity, Ge(parser.stacklen));
+  EXPECT_THAT(parser.stack.kind[2 * INITIALTOKENS], Eq(qualifier));
+  EXPECT_STREQ("*", parser.stack.string[2 * INITIALTOKENS]);
 }
 
 TEST_F(ParserSuite, LoadStackFunctionParamNoSpace) {
@@ -1386,13 +1433,7 @@ TEST_F(ParserSuite, ProcessFunctionParamsLeadingWhitespace) {
   EXPECT_THAT(
       StdoutMatches("Token number 1 has kind identifier and string seed"),
       IsTrue());
-  struct parser_props *pnext = parser.next;
-  while (pnext) {
-    struct parser_props *save = pnext->next;
-    std::cout << "Test: freeing pnext: " << std::hex << pnext << std::endl;
-    free(pnext);
-    pnext = save;
-  }
+  release_subsidiary_parsers(&parser);
 }
 
 TEST_F(ParserSuite, ProcessStructMembersOneMemberWithInstanceName) {
@@ -1423,10 +1464,10 @@ TEST_F(ParserSuite, ProcessStructMembersOneMemberWithInstanceName) {
   EXPECT_THAT(parser.next->is_function, IsFalse());
   EXPECT_THAT(parser.next->is_enum, IsFalse());
   EXPECT_THAT(parser.next->stacklen, Eq(2));
-  EXPECT_THAT(parser.next->stack[0].kind, Eq(type));
-  EXPECT_THAT(parser.next->stack[0].string, StrEq("int"));
-  EXPECT_THAT(parser.next->stack[1].kind, Eq(identifier));
-  EXPECT_THAT(parser.next->stack[1].string, StrEq("payload"));
+  EXPECT_THAT(parser.next->stack.kind[0], Eq(type));
+  EXPECT_THAT(parser.next->stack.string[0], StrEq("int"));
+  EXPECT_THAT(parser.next->stack.kind[1], Eq(identifier));
+  EXPECT_THAT(parser.next->stack.string[1], StrEq("payload"));
   EXPECT_THAT(parser.next->next, IsNull());
   // Normally freed by pop_stack().
   release_parser_resources(&parser);
@@ -1679,21 +1720,21 @@ TEST_F(ParserSuite, Showstack) {
   push_stack(&parser, &token0);
   struct token token1{qualifier, "const"};
   push_stack(&parser, &token1);
-  showstack(&parser.stack[0], parser.stacklen, parser.out_stream, __LINE__);
+  showstack(&parser.stack, parser.stacklen, parser.out_stream, __LINE__);
   EXPECT_THAT(StdoutMatches("Stack at"), IsTrue());
   EXPECT_THAT(StdoutMatches("Token number 0 has kind type and string int"),
               IsTrue());
   EXPECT_THAT(
       StdoutMatches("Token number 1 has kind qualifier and string const"),
       IsTrue());
-  showstack(&parser.stack[0], parser.stacklen, stdout, __LINE__);
+  showstack(&parser.stack, parser.stacklen, stdout, __LINE__);
 }
 
 TEST_F(ParserSuite, ShowParsersFromHead) {
   // Create and check the parser list.
-  _cleanup_(freep) struct parser_props *parser1 = make_parser(&parser);
+  struct parser_props *parser1 = make_parser(&parser);
   ASSERT_THAT(parser1, Not(IsNull()));
-  _cleanup_(freep) struct parser_props *parser2 = make_parser(parser1);
+  struct parser_props *parser2 = make_parser(parser1);
   ASSERT_THAT(parser2, Not(IsNull()));
   EXPECT_THAT(parser1->prev, Eq(&parser));
   EXPECT_THAT(parser.next->next, Eq(parser2));
@@ -1719,9 +1760,9 @@ TEST_F(ParserSuite, ShowParsersFromHead) {
 
 TEST_F(ParserSuite, ShowParsersFromTail) {
   // Create and check the parser list.
-  _cleanup_(freep) struct parser_props *parser1 = make_parser(&parser);
+  struct parser_props *parser1 = make_parser(&parser);
   ASSERT_THAT(parser1, Not(IsNull()));
-  _cleanup_(freep) struct parser_props *parser2 = make_parser(parser1);
+  struct parser_props *parser2 = make_parser(parser1);
   ASSERT_THAT(parser2, Not(IsNull()));
   EXPECT_THAT(parser1->prev, Eq(&parser));
   EXPECT_THAT(parser.next->next, Eq(parser2));
@@ -1746,8 +1787,8 @@ TEST_F(ParserSuite, ShowParsersFromTail) {
 
 TEST_F(ParserSuite, ShowParsersReverse) {
   // Create and check the parser list.
-  _cleanup_(freep) struct parser_props *parser1 = make_parser(&parser);
-  _cleanup_(freep) struct parser_props *parser2 = make_parser(parser1);
+  struct parser_props *parser1 = make_parser(&parser);
+  struct parser_props *parser2 = make_parser(parser1);
 
   show_parser_reverse_list(parser2);
 
@@ -1806,7 +1847,7 @@ TEST_F(ParserSuite, LoadStackWorks) {
               IsTrue());
   EXPECT_THAT(StdoutMatches("Token number 3 has kind identifier and string x"),
               IsTrue());
-  showstack(&parser.stack[0], parser.stacklen, stdout, __LINE__);
+  showstack(&parser.stack, parser.stacklen, stdout, __LINE__);
 }
 
 TEST_F(ParserSuite, SimpleFunction) {
@@ -1817,8 +1858,8 @@ TEST_F(ParserSuite, SimpleFunction) {
   EXPECT_THAT(consumed, Eq(strlen("double sqrt")));
   // When there are no function parameters, there is no second parser.
   EXPECT_THAT(parser.next, IsNull());
-  EXPECT_THAT(parser.stack[1].kind, Eq(identifier));
-  EXPECT_THAT(parser.stack[1].string, StrEq("sqrt"));
+  EXPECT_THAT(parser.stack.kind[1], Eq(identifier));
+  EXPECT_THAT(parser.stack.string[1], StrEq("sqrt"));
 }
 
 TEST_F(ParserSuite, SimpleFunctionBadDelims) {
@@ -1852,7 +1893,7 @@ TEST_F(ParserSuite, LoadStackParensTerminatorOneFunctionParam) {
       StdoutMatches("Token number 1 has kind identifier and string hash"),
       IsTrue());
   // Otherwise freed by pop_all().
-  free(parser.next);
+  release_subsidiary_parsers(&parser);
 }
 
 TEST_F(ParserSuite, LoadStackCommaTerminatorFunction) {
@@ -1881,8 +1922,7 @@ TEST_F(ParserSuite, LoadStackCommaTerminatorFunction) {
       StdoutMatches("Token number 1 has kind identifier and string hash"),
       IsTrue());
   // Otherwise freed by pop_all().
-  free(parser.next->next);
-  free(parser.next);
+  release_subsidiary_parsers(&parser);
 }
 
 TEST_F(ParserSuite, LoadStackCommaTerminatorFunctionSpaces) {
@@ -1934,7 +1974,7 @@ TEST_F(ParserSuite, LoadStackArrayNoLength) {
   EXPECT_THAT(
       StdoutMatches("Token number 1 has kind identifier and string val"),
       IsTrue());
-  showstack(&parser.stack[0], parser.stacklen, stdout, __LINE__);
+  showstack(&parser.stack, parser.stacklen, stdout, __LINE__);
 }
 
 TEST_F(ParserSuite, LoadStackArrayLength) {
@@ -1955,7 +1995,7 @@ TEST_F(ParserSuite, LoadStackArrayLength) {
   EXPECT_THAT(
       StdoutMatches("Token number 2 has kind identifier and string val"),
       IsTrue());
-  showstack(&parser.stack[0], parser.stacklen, stdout, __LINE__);
+  showstack(&parser.stack, parser.stacklen, stdout, __LINE__);
 }
 
 TEST_F(ParserSuite, LoadStackTwoDimArrayOneLength) {
@@ -1967,7 +2007,7 @@ TEST_F(ParserSuite, LoadStackTwoDimArrayOneLength) {
   EXPECT_THAT(parser.ident.array_dimensions[0], Eq(2));
   EXPECT_THAT(parser.ident.array_lengths[0], Eq(1));
   EXPECT_THAT(parser.ident.last_dimension[0], Eq(UNSPECIFIED));
-  showstack(&parser.stack[0], parser.stacklen, stdout, __LINE__);
+  showstack(&parser.stack, parser.stacklen, stdout, __LINE__);
 }
 
 TEST_F(ParserSuite, LoadStackTwoDimArrayTwoLengths) {
@@ -1988,7 +2028,7 @@ TEST_F(ParserSuite, LoadStackTwoDimArrayTwoLengths) {
   EXPECT_THAT(
       StdoutMatches("Token number 3 has kind identifier and string val"),
       IsTrue());
-  showstack(&parser.stack[0], parser.stacklen, stdout, __LINE__);
+  showstack(&parser.stack, parser.stacklen, stdout, __LINE__);
 }
 
 TEST_F(ParserSuite, LoadStackThreeDimArrayTwoLengths) {
@@ -2009,7 +2049,7 @@ TEST_F(ParserSuite, LoadStackThreeDimArrayTwoLengths) {
   EXPECT_THAT(
       StdoutMatches("Token number 3 has kind identifier and string val"),
       IsTrue());
-  showstack(&parser.stack[0], parser.stacklen, stdout, __LINE__);
+  showstack(&parser.stack, parser.stacklen, stdout, __LINE__);
 }
 
 TEST_F(ParserSuite, LoadStackThreeDimArrayThreeLengths) {
@@ -2265,7 +2305,7 @@ TEST_F(ParserSuite, LoadStackStructExcessType) {
   strlcpy(user_input, probe, strlen(probe) + 1);
   std::size_t consumed = load_stack(&parser, user_input);
   parser.err_stream = stderr;
-  showstack(&parser.stack[0], parser.stacklen, stdout, __LINE__);
+  showstack(&parser.stack, parser.stacklen, stdout, __LINE__);
   EXPECT_THAT(consumed, Eq(0));
   release_parser_resources(&parser);
 }
@@ -2275,7 +2315,7 @@ TEST_F(ParserSuite, LoadStackEnumInstanceNameMissingLeadingSpace) {
   const char *probe = "enum State state{GAS}";
   strlcpy(user_input, probe, strlen(probe) + 1);
   std::size_t consumed = load_stack(&parser, user_input);
-  showstack(&parser.stack[0], parser.stacklen, stdout, __LINE__);
+  showstack(&parser.stack, parser.stacklen, stdout, __LINE__);
   EXPECT_THAT(consumed, Eq(0));
 }
 
@@ -2641,7 +2681,7 @@ TEST_F(ParserSuite, LoadStackReorderArrayLengths) {
   EXPECT_THAT(StdoutMatches("Token number 3 has kind identifier and string x"),
               IsTrue());
   EXPECT_THAT(parser.stacklen, Eq(4));
-  showstack(&parser.stack[0], parser.stacklen, stdout, __LINE__);
+  showstack(&parser.stack, parser.stacklen, stdout, __LINE__);
 }
 
 TEST_F(ParserSuite, LoadStackDeclaratorListTrailingArray) {
@@ -2665,7 +2705,7 @@ TEST_F(ParserSuite, LoadStackDeclaratorListTrailingArray) {
   EXPECT_THAT(parser.ident.last_dimension[1], Eq(SPECIFIED));
   EXPECT_THAT(parser.ident.array_dimensions[1], Eq(1));
   EXPECT_THAT(parser.ident.array_lengths[1], Eq(1));
-  showstack(&parser.stack[0], parser.stacklen, stdout, __LINE__);
+  showstack(&parser.stack, parser.stacklen, stdout, __LINE__);
 }
 
 TEST_F(ParserSuite, LoadStackDeclaratorListLeadingArray) {
@@ -2689,7 +2729,7 @@ TEST_F(ParserSuite, LoadStackDeclaratorListLeadingArray) {
   EXPECT_THAT(parser.ident.last_dimension[1], Eq(UNKNOWN));
   EXPECT_THAT(parser.ident.array_dimensions[1], Eq(0));
   EXPECT_THAT(parser.ident.array_lengths[1], Eq(0));
-  showstack(&parser.stack[0], parser.stacklen, stdout, __LINE__);
+  showstack(&parser.stack, parser.stacklen, stdout, __LINE__);
 }
 
 TEST_F(ParserSuite, LoadStackDeclaratorListTrailingUnspecifiedDimension) {
@@ -2712,7 +2752,7 @@ TEST_F(ParserSuite, LoadStackDeclaratorListTrailingUnspecifiedDimension) {
   EXPECT_THAT(parser.ident.array_dimensions[1], Eq(2));
   EXPECT_THAT(parser.ident.array_lengths[1], Eq(1));
   EXPECT_THAT(parser.ident.last_dimension[1], Eq(UNSPECIFIED));
-  showstack(&parser.stack[0], parser.stacklen, stdout, __LINE__);
+  showstack(&parser.stack, parser.stacklen, stdout, __LINE__);
 }
 
 TEST_F(ParserSuite, LoadStackDeclaratorListLeadingUnspecifiedLength) {
@@ -2735,7 +2775,7 @@ TEST_F(ParserSuite, LoadStackDeclaratorListLeadingUnspecifiedLength) {
   EXPECT_THAT(parser.ident.last_dimension[0], Eq(UNSPECIFIED));
   EXPECT_THAT(parser.ident.array_dimensions[1], Eq(0));
   EXPECT_THAT(parser.ident.array_lengths[1], Eq(0));
-  showstack(&parser.stack[0], parser.stacklen, stdout, __LINE__);
+  showstack(&parser.stack, parser.stacklen, stdout, __LINE__);
 }
 
 TEST_F(ParserSuite, LoadStackDeclaratorListTrailingOnlyUnspecifiedDimension) {
@@ -2754,7 +2794,7 @@ TEST_F(ParserSuite, LoadStackDeclaratorListTrailingOnlyUnspecifiedDimension) {
   EXPECT_THAT(parser.ident.last_dimension[1], Eq(UNSPECIFIED));
   EXPECT_THAT(parser.ident.array_dimensions[1], Eq(1));
   EXPECT_THAT(parser.ident.array_lengths[1], Eq(0));
-  showstack(&parser.stack[0], parser.stacklen, stdout, __LINE__);
+  showstack(&parser.stack, parser.stacklen, stdout, __LINE__);
 }
 
 TEST_F(ParserSuite, LoadStackDeclaratorListLeadingOnlyUnspecifiedDimension) {
@@ -2773,7 +2813,7 @@ TEST_F(ParserSuite, LoadStackDeclaratorListLeadingOnlyUnspecifiedDimension) {
   EXPECT_THAT(parser.ident.last_dimension[0], Eq(UNSPECIFIED));
   EXPECT_THAT(parser.ident.array_dimensions[0], Eq(1));
   EXPECT_THAT(parser.ident.array_lengths[0], Eq(0));
-  showstack(&parser.stack[0], parser.stacklen, stdout, __LINE__);
+  showstack(&parser.stack, parser.stacklen, stdout, __LINE__);
 }
 
 TEST_F(ParserSuite, ParseSimpleExpression) {
@@ -3992,3 +4032,165 @@ TEST_F(ParserSuite, ParseDeclaratorListBothUnspecified) {
   EXPECT_THAT(StdoutMatches("b is a(n) array of"), IsTrue());
   EXPECT_THAT(StdoutMatches("and a is a(n) array of int"), IsTrue());
 }
+
+/* Found by cdecl_fuzzer: identifier_props overflowed. */
+TEST_F(ParserSuite, ParseDeclaratorListFiveIdentifiers) {
+  char inputstr[] = "int a, b, c, d, e;";
+  ASSERT_THAT(input_parsing_successful(&parser, inputstr), IsTrue());
+  EXPECT_THAT(StdoutMatches("e is a(n) int and d is a(n) int and c is a(n) "
+                            "int and b is a(n) int and a is a(n) int"),
+              IsTrue());
+}
+
+/* Enum constants are not declarators, so they do not fill identifier_props. */
+TEST_F(ParserSuite, ParseEnumWithThreeConstantsAndInstance) {
+  char inputstr[] = "enum color {red, green, blue} c;";
+  ASSERT_THAT(input_parsing_successful(&parser, inputstr), IsTrue());
+  EXPECT_THAT(
+      StdoutMatches("c is a(n) enum color with enum constant red,green,blue"),
+      IsTrue());
+}
+
+TEST_F(ParserSuite, ParseEnumWithFourConstants) {
+  char inputstr[] = "enum color {red, green, blue, yellow};";
+  ASSERT_THAT(input_parsing_successful(&parser, inputstr), IsTrue());
+  EXPECT_THAT(StdoutMatches(
+                  "enum color has enum constant red,green,blue,yellow"),
+              IsTrue());
+}
+
+/* Found by cdecl_fuzzer: the last member had no parser. */
+TEST_F(ParserSuite, ParseStructWithNoNamedMember) {
+  char inputstr[] = "struct {{;void [4]";
+  EXPECT_THAT(input_parsing_successful(&parser, inputstr), IsFalse());
+  EXPECT_THAT(StderrMatches("Failed to process last struct or union member"),
+              IsTrue());
+}
+
+TEST_F(ParserSuite, ParseDeclaratorListSharedSpecifiers) {
+  char inputstr[] = "const long *a, b[4], c;";
+  ASSERT_THAT(input_parsing_successful(&parser, inputstr), IsTrue());
+  EXPECT_THAT(StdoutMatches("c is a(n) const long and b is a(n) array of 4 "
+                            "const long and a is a(n) pointer to const long"),
+              IsTrue());
+}
+
+TEST_F(ParserSuite, ParseDeclaratorListPointersAreNotShared) {
+  char inputstr[] = "int **a, b;";
+  ASSERT_THAT(input_parsing_successful(&parser, inputstr), IsTrue());
+  EXPECT_THAT(
+      StdoutMatches("b is a(n) int and a is a(n) pointer to pointer to int"),
+      IsTrue());
+}
+
+/* Generated headers may declare many variables in one statement. */
+TEST_F(ParserSuite, ParseDeclaratorListManyDeclarators) {
+  char inputstr[] = "const long *a, b[4], c, **d, e[2], f, *const g, h;";
+  ASSERT_THAT(input_parsing_successful(&parser, inputstr), IsTrue());
+  EXPECT_THAT(
+      StdoutMatches("h is a(n) const long and g is a(n) const pointer to "
+                    "const long and f is a(n) const long and e is a(n) array "
+                    "of 2 const long and d is a(n) pointer to pointer to "
+                    "const long and c is a(n) const long and b is a(n) array "
+                    "of 4 const long and a is a(n) pointer to const long"),
+      IsTrue());
+}
+
+TEST_F(ParserSuite, ParseDeclaratorListTwentyDeclarators) {
+  std::string declaration = "unsigned char v0";
+  std::string expected = "v0 is a(n) unsigned char";
+  for (int i = 1; i < 20; i++) {
+    const std::string name = "v" + std::to_string(i);
+    declaration += ", " + name;
+    expected = name + " is a(n) unsigned char and " + expected;
+  }
+  declaration += ";";
+  char inputstr[MAXTOKENLEN];
+  strlcpy(inputstr, declaration.c_str(), MAXTOKENLEN);
+  ASSERT_THAT(input_parsing_successful(&parser, inputstr), IsTrue());
+  EXPECT_THAT(StdoutMatches(expected), IsTrue());
+}
+
+std::string ExplainWithCache(const char *declaration,
+                             struct param_cache *cache) {
+  struct parser_props parser;
+  char inputstr[MAXTOKENLEN];
+  char *output = NULL;
+  size_t output_len = 0;
+  FILE *out = open_memstream(&output, &output_len);
+  FILE *err = tmpfile();
+  initialize_parser(&parser);
+  set_test_streams(&parser, out, err);
+  parser.cache = cache;
+  strlcpy(inputstr, declaration, MAXTOKENLEN);
+  const bool parsed = input_parsing_successful(&parser, inputstr);
+  release_parser_resources(&parser);
+  fclose(out);
+  fclose(err);
+  std::string explanation{parsed ? output : ""};
+  free(output);
+  // With DEBUG defined, stack dumps precede the explanation.
+  const size_t last_line = explanation.rfind('\n', explanation.size() - 2);
+  if (std::string::npos != last_line) {
+    explanation.erase(0, last_line + 1);
+  }
+  return explanation;
+}
+
+TEST(ParamCacheSuite, UnchangedParamsAreReused) {
+  struct param_cache cache;
+  initialize_param_cache(&cache);
+  const std::string first =
+      ExplainWithCache("int f(int a, char *b);", &cache);
+  EXPECT_THAT(first, HasSubstr("a is a(n) int and b is a(n) pointer to char"));
+  EXPECT_THAT(cache.hits, Eq(0));
+  EXPECT_THAT(cache.misses, Eq(2));
+  // Only the edited parameter misses.
+  const std::string edited =
+      ExplainWithCache("int f(int a, char *c);", &cache);
+  EXPECT_THAT(cache.hits, Eq(1));
+  EXPECT_THAT(cache.misses, Eq(3));
+  EXPECT_THAT(edited, StrEq(ExplainWithCache("int f(int a, char *c);", NULL)));
+  release_param_cache(&cache);
+}
+
+TEST(ParamCacheSuite, StructMembersAreReused) {
+  struct param_cache cache;
+  initialize_param_cache(&cache);
+  const char *declaration =
+      "struct node {int payload; struct node *next;} nodelist;";
+  const std::string uncached = ExplainWithCache(declaration, NULL);
+  EXPECT_THAT(ExplainWithCache(declaration, &cache), StrEq(uncached));
+  EXPECT_THAT(cache.hits, Eq(0));
+  EXPECT_THAT(ExplainWithCache(declaration, &cache), StrEq(uncached));
+  EXPECT_THAT(cache.hits, Eq(2));
+  release_param_cache(&cache);
+}
+
+TEST(ParamCacheSuite, NestedParamsAreCaptured) {
+  struct param_cache cache;
+  initialize_param_cache(&cache);
+  // The members and parameters which follow the nested ones are not part of
+  // the explanation cached for the function pointer.
+  for (const char *declaration :
+       {"struct file { int (*open)(struct inode *blk); };",
+        "struct t {int (*cb)(int a); int a;} y;",
+        "int f(int (*cb)(int a), int b);"}) {
+    const std::string uncached = ExplainWithCache(declaration, NULL);
+    ASSERT_THAT(uncached, Not(IsEmpty()));
+    EXPECT_THAT(ExplainWithCache(declaration, &cache), StrEq(uncached));
+    EXPECT_THAT(ExplainWithCache(declaration, &cache), StrEq(uncached));
+  }
+  EXPECT_THAT(cache.hits, Gt(0));
+  release_param_cache(&cache);
+}
+
+TEST(ParamCacheSuite, ContextIsPartOfKey) {
+  struct param_cache cache;
+  initialize_param_cache(&cache);
+  ExplainWithCache("int f(int a);", &cache);
+  // The same text as a struct member must not reuse the parameter entry.
+  ExplainWithCache("struct s {int a;} x;", &cache);
+  EXPECT_THAT(cache.hits, Eq(0));
+  release_param_cache(&cache);
+}
@@ -0,0 +1,251 @@
+#ifndef MATRIX_DETERMINANT_INTERNAL
+#define MATRIX_DETERMINANT_INTERNAL
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define SIZE 3
+/*
+ * Columns per panel of the blocked LU factorization.  A 64-column tile of U
+ * is 32 KiB, about the size of L1, while the panel rows it updates stream from
+ * L2.
+ */
+#ifndef LU_BLOCK_SIZE
+#define LU_BLOCK_SIZE 64
+#endif
+
+/* fixed-size cofactor expansion */
+int find_row_index(const double *elementp, const double (*source)[SIZE]);
+int find_column_index(const double *elementp, const double (*source)[SIZE]);
+bool bounds_ok(const int i);
+int get_submatrix(double *submatrix, const int excluded_row,
+                  const int excluded_column, const double (*source)[SIZE]);
+double submatrix_determinant(const double *submatrix);
+double determinant(const double (*source)[SIZE]);
+
+/*
+ * Runtime-sized matrices are row-major with dim rows and columns, with row i
+ * starting at matrix + (i * stride).  stride must be at least dim, which
+ * allows the functions to operate on a submatrix of a larger one.
+ */
+int lu_factor(double *matrix, const size_t dim, const size_t stride,
+              size_t *pivots, int *sign);
+int lu_factor_blocked(double *matrix, const size_t dim, const size_t stride,
+                      const size_t block, size_t *pivots, int *sign);
+int lu_factor_parallel(double *matrix, const size_t dim, const size_t stride,
+                       const size_t block, size_t threads, size_t *pivots,
+                       int *sign);
+/* Join the worker threads which lu_factor_parallel() keeps between calls. */
+void release_lu_threads(void);
+double determinant_lu(double *matrix, const size_t dim, const size_t stride);
+double determinant_n(const double *matrix, const size_t dim,
+                     const size_t stride);
+double determinant_n_parallel(const double *matrix, const size_t dim,
+                              const size_t stride, const size_t threads);
+/*
+ * The determinant as sign * exp(logabsdet), which neither overflows nor
+ * underflows for large matrices.
+ */
+int slogdet_n(const double *matrix, const size_t dim, const size_t stride,
+              const size_t threads, int *sign, double *logabsdet);
+/*
+ * Single precision, for inputs which need only about six significant digits.
+ * slogdet_float() and slogdet_mixed(), which rounds a double matrix to float,
+ * factor in float and accumulate the log of the determinant in double.
+ */
+int lu_factor_float(float *matrix, const size_t dim, const size_t stride,
+                    size_t *pivots, int *sign);
+float determinant_float(const float *matrix, const size_t dim,
+                        const size_t stride);
+int slogdet_float(const float *matrix, const size_t dim, const size_t stride,
+                  int *sign, double *logabsdet);
+int slogdet_mixed(const double *matrix, const size_t dim, const size_t stride,
+                  int *sign, double *logabsdet);
+int determinant_batch(const double *soa, const size_t dim, const size_t count,
+                      double *dets);
+
+/*
+ * The LU factors of a dim x dim matrix, packed, with the row swaps and their
+ * sign, from which determinants, solutions and inverses cost O(n^2) each
+ * rather than the O(n^3) of the factorization.
+ */
+struct lu_factorization {
+  size_t dim;
+  double *factors;
+  size_t *pivots;
+  int sign;
+};
+int initialize_lu(struct lu_factorization *lu, const size_t dim);
+void release_lu_resources(struct lu_factorization *lu);
+int lu_factorize(struct lu_factorization *lu, const double *matrix,
+                 const size_t stride);
+double lu_determinant(const struct lu_factorization *lu);
+/* B is dim x nrhs, with rows ldb apart, and is overwritten with X. */
+int lu_solve(const struct lu_factorization *lu, double *rhs,
+             const size_t nrhs, const size_t ldb);
+int lu_inverse(const struct lu_factorization *lu, double *inverse);
+int lu_factorize_diagonal(struct lu_factorization *lu,
+                          const double *diagonal);
+/*
+ * Determinants of M = [A B; C D] from a factorization of its leading block A,
+ * which lasts while B, C and D change.  D is (dim - a->dim) square.
+ */
+int schur_slogdet(const struct lu_factorization *a, const double *matrix,
+                  const size_t dim, const size_t stride, int *sign,
+                  double *logabsdet);
+double schur_determinant(const struct lu_factorization *a,
+                         const double *matrix, const size_t dim,
+                         const size_t stride);
+
+/*
+ * A matrix, kept packed, whose determinant is updated rather than recomputed
+ * after each rank-1 change.  See initialize_tracker().
+ */
+struct determinant_tracker {
+  size_t dim;
+  size_t refactor_interval;
+  /* since the last factorization */
+  size_t updates;
+  double det;
+  /* If so, inverse is invalid and every update refactors. */
+  bool singular;
+  double *matrix;
+  double *inverse;
+  struct lu_factorization lu;
+  double *scratch;
+};
+int initialize_tracker(struct determinant_tracker *tracker,
+                       const double *matrix, const size_t dim,
+                       const size_t stride, const size_t refactor_interval);
+void release_tracker_resources(struct determinant_tracker *tracker);
+/* A += u v^T */
+int rank1_update(struct determinant_tracker *tracker, const double *u,
+                 const double *v);
+int replace_row(struct determinant_tracker *tracker, const size_t row,
+                const double *values);
+int replace_column(struct determinant_tracker *tracker, const size_t column,
+                   const double *values);
+
+/*
+ * A sparse matrix in compressed sparse column form: the entries of column j
+ * are values[p] in rows indices[p], for p from starts[j] to starts[j + 1].
+ * Since a matrix and its transpose have the same determinant, compressed
+ * sparse row input may be passed as is.  Duplicate entries are summed.
+ */
+struct sparse_matrix {
+  size_t dim;
+  const size_t *starts;
+  const size_t *indices;
+  const double *values;
+};
+/* Column ordering for the sparse LU factorization. */
+enum sparse_ordering { SPARSE_NATURAL, SPARSE_MINIMUM_DEGREE };
+int sparse_slogdet(const struct sparse_matrix *matrix,
+                   const enum sparse_ordering ordering, int *sign,
+                   double *logabsdet, size_t *factor_nnz);
+double sparse_determinant(const struct sparse_matrix *matrix);
+
+/*
+ * Exact determinant of an integer matrix.  Returns -ERANGE if the determinant
+ * or an intermediate minor does not fit in 64 bits.
+ */
+int determinant_int64(const int64_t *matrix, const size_t dim,
+                      const size_t stride, int64_t *det);
+#ifdef __SIZEOF_INT128__
+/*
+ * The same with a 128-bit result, for matrices whose determinants overflow
+ * 64 bits.  Returns -ERANGE only if a product of two minors does not fit in
+ * 128 bits.
+ */
+int determinant_int128(const int64_t *matrix, const size_t dim,
+                       const size_t stride, __int128 *det);
+#endif
+
+/*
+ * The minor of a dim x dim matrix without one row and column, read in place.
+ * The view itself has dim - 1 rows and columns.
+ */
+struct minor_view {
+  const double *source;
+  size_t dim;
+  size_t stride;
+  size_t excluded_row;
+  size_t excluded_column;
+};
+int make_minor_view(struct minor_view *view, const double *source,
+                    const size_t dim, const size_t stride,
+                    const size_t excluded_row, const size_t excluded_column);
+double minor_element(const struct minor_view *view, const size_t i,
+                     const size_t j);
+double minor_determinant(const struct minor_view *view);
+/* Both results are dim x dim and row-major with stride dim. */
+int cofactor_matrix(const double *matrix, const size_t dim, const size_t stride,
+                    double *cofactors);
+int adjugate(const double *matrix, const size_t dim, const size_t stride,
+             double *adj);
+
+/*
+ * Matrix files are a 64-byte header followed, at data_offset, by the
+ * elements, in the byte order of the machine which wrote them.  Each row, or
+ * column if column-major, starts stride elements after the previous one.
+ */
+#define MATRIX_FILE_MAGIC "MATDET01"
+#define MATRIX_FILE_BYTE_ORDER 0x01020304U
+/* of data_offset, so that mapped rows are cache-line aligned */
+#define MATRIX_FILE_ALIGNMENT 64
+enum matrix_dtype { MATRIX_FLOAT64 = 1, MATRIX_INT64 = 2 };
+enum matrix_layout { MATRIX_ROW_MAJOR = 0, MATRIX_COLUMN_MAJOR = 1 };
+struct matrix_file_header {
+  char magic[8];
+  uint32_t byte_order;
+  uint32_t dtype;
+  uint32_t layout;
+  uint32_t reserved;
+  uint64_t rows;
+  uint64_t cols;
+  uint64_t stride;
+  uint64_t data_offset;
+  uint8_t padding[8];
+};
+struct mapped_matrix {
+  const struct matrix_file_header *header;
+  const void *data;
+  void *map;
+  size_t map_size;
+};
+int write_matrix_file(const char *path, const void *data,
+                      const enum matrix_dtype dtype, const size_t rows,
+                      const size_t cols, const size_t stride);
+int map_matrix_file(const char *path, struct mapped_matrix *matrix);
+void unmap_matrix_file(struct mapped_matrix *matrix);
+double mapped_determinant(struct mapped_matrix *matrix);
+
+/* comparisons */
+bool vector_are_equal(const double *mat1, const double *mat2, size_t len);
+bool const_vector_are_equal(const double *const mat1, const double *const mat2,
+                            size_t len);
+bool square_are_equal(const double (*mat1)[SIZE], const double (*mat2)[SIZE]);
+/*
+ * True if each pair of elements is within abs_tol of each other, or at most
+ * max_ulps representable doubles apart.  NaN is close to nothing.
+ */
+bool vector_are_close(const double *mat1, const double *mat2, size_t len,
+                      const double abs_tol, const uint64_t max_ulps);
+/* Vectors which vector_are_equal() finds equal have the same hash. */
+uint64_t vector_hash(const double *vec, size_t len);
+/*
+ * A matrix with its hash, computed once, so that the comparison of unequal
+ * ones usually stops at the hash.
+ */
+struct matrix_key {
+  const double *data;
+  size_t len;
+  uint64_t hash;
+};
+void make_matrix_key(struct matrix_key *key, const double *data,
+                     const size_t len);
+bool matrix_keys_are_equal(const struct matrix_key *key1,
+                           const struct matrix_key *key2);
+
+#endif
@@ -0,0 +1,65 @@
+/*
+ * Determinants of matrices whose size is known at compile time.  Sizes up to 4
+ * have constexpr closed forms with no loops or bounds checks, so that
+ * constant matrices are evaluated by the compiler and small runtime ones are
+ * a straight line of multiplications.  Larger sizes are passed to the LU
+ * engine of matrix-determinant.c, which the including translation unit must
+ * also compile or link.
+ */
+#ifndef MATRIX_DETERMINANT_TEMPLATE
+#define MATRIX_DETERMINANT_TEMPLATE
+
+#include <cstddef>
+#include <type_traits>
+
+#include "matrix-determinant-internal.h"
+
+namespace matrix {
+
+/* a * d - b * c */
+constexpr double minor2(const double a, const double b, const double c,
+                        const double d) {
+  return (a * d) - (b * c);
+}
+
+template <std::size_t N>
+constexpr std::enable_if_t<(N <= 4), double>
+determinant(const double (&m)[N][N]) {
+  static_assert(N > 0, "A matrix needs at least one element.");
+  if constexpr (1 == N) {
+    return m[0][0];
+  } else if constexpr (2 == N) {
+    return minor2(m[0][0], m[0][1], m[1][0], m[1][1]);
+  } else if constexpr (3 == N) {
+    return (m[0][0] * minor2(m[1][1], m[1][2], m[2][1], m[2][2])) -
+           (m[0][1] * minor2(m[1][0], m[1][2], m[2][0], m[2][2])) +
+           (m[0][2] * minor2(m[1][0], m[1][1], m[2][0], m[2][1]));
+  } else {
+    /*
+     * Laplace expansion along the first two rows, as in batch_det4_scalar().
+     */
+    const double s01 = minor2(m[0][0], m[0][1], m[1][0], m[1][1]);
+    const double s02 = minor2(m[0][0], m[0][2], m[1][0], m[1][2]);
+    const double s03 = minor2(m[0][0], m[0][3], m[1][0], m[1][3]);
+    const double s12 = minor2(m[0][1], m[0][2], m[1][1], m[1][2]);
+    const double s13 = minor2(m[0][1], m[0][3], m[1][1], m[1][3]);
+    const double s23 = minor2(m[0][2], m[0][3], m[1][2], m[1][3]);
+    const double c01 = minor2(m[2][0], m[2][1], m[3][0], m[3][1]);
+    const double c02 = minor2(m[2][0], m[2][2], m[3][0], m[3][2]);
+    const double c03 = minor2(m[2][0], m[2][3], m[3][0], m[3][3]);
+    const double c12 = minor2(m[2][1], m[2][2], m[3][1], m[3][2]);
+    const double c13 = minor2(m[2][1], m[2][3], m[3][1], m[3][3]);
+    const double c23 = minor2(m[2][2], m[2][3], m[3][2], m[3][3]);
+    return (s01 * c23) - (s02 * c13) + (s03 * c12) + (s12 * c03) -
+           (s13 * c02) + (s23 * c01);
+  }
+}
+
+template <std::size_t N>
+std::enable_if_t<(N > 4), double> determinant(const double (&m)[N][N]) {
+  return determinant_n(&m[0][0], N, N);
+}
+
+} // namespace matrix
+
+#endif
@@ -1,14 +1,26 @@
-/* Calculate the determinant of a random 3x3 matrix. */
+/*
+ * Calculate the determinant of a 3x3 matrix by cofactor expansion, or of an
+ * NxN one by LU decomposition.
+ */
 
 #include <assert.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <math.h>
+#include <pthread.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_X86_SIMD 1
+#endif
 
-#define SIZE 3
+#include "matrix-determinant-internal.h"
 
 /* Ended up not needing these two functions for the simple 3x3 determinant. */
 int find_row_index(const double *elementp, const double (*source)[SIZE]) {
@@ -56,23 +68,98 @@ double submatrix_determinant(const double *submatrix) {
 
 /*  For each element of an nxn (square) matrix, multiply the element by the
  * value of the determinant of the submatrix which includes neither the column
- * nor the row of the element. */
+ * nor the row of the element.  The submatrix is read in place through a minor
+ * view rather than copied out with get_submatrix(). */
 double determinant(const double (*source)[SIZE]) {
   double sum = 0.0;
   for (int j = 0; j < SIZE; j++) {
-    //  Flatten the 2x2 submatrix for convenience.
-    double submatrix[4] = {0, 0, 0, 0};
-    if (get_submatrix(submatrix, 0, j, source)) {
-      return NAN;
-    }
-    sum += pow(-1.0, j) * source[0][j] * submatrix_determinant(submatrix);
+    const struct minor_view view = {&source[0][0], SIZE, SIZE, 0, (size_t)j};
+    /* (-1)^j without a call to pow(). */
+    const double sign = (j % 2) ? -1.0 : 1.0;
+    sum += sign * source[0][j] * minor_determinant(&view);
   }
   return sum;
 }
 
-// Compare two row or column vectors for equality, returning TRUE if they are
-// empty.
-bool vector_are_equal(const double *mat1, const double *mat2, size_t len) {
+/*
+ * The elimination and comparison kernels have a scalar version and, on x86,
+ * an AVX2/FMA one.  select_kernels() picks according to the running CPU.
+ * Tests and benchmarks may set force_scalar_kernels to compare the two.
+ */
+static bool force_scalar_kernels = false;
+
+struct simd_kernels {
+  /* row[j] -= multiplier * pivot_row[j] */
+  void (*row_update)(double *row, const double *pivot_row,
+                     const double multiplier, const size_t len);
+  /* Four successive row_update() calls, fused into one pass over row. */
+  void (*row_update4)(double *row, const double *const *pivot_rows,
+                      const double *multipliers, const size_t len);
+  /* The same two for single precision. */
+  void (*row_update_float)(float *row, const float *pivot_row,
+                           const float multiplier, const size_t len);
+  void (*row_update4_float)(float *row, const float *const *pivot_rows,
+                            const float *multipliers, const size_t len);
+  /* Same result as comparing each pair of elements with !=. */
+  bool (*are_equal)(const double *mat1, const double *mat2, size_t len);
+  /* See vector_are_close(). */
+  bool (*are_close)(const double *mat1, const double *mat2, size_t len,
+                    const double abs_tol, const uint64_t max_ulps);
+  /*
+   * Closed-form determinants of matrices [first, count) of a batch of 2x2,
+   * 3x3 and 4x4 matrices.  See determinant_batch().
+   */
+  void (*batch_det2)(const double *soa, const size_t count, size_t first,
+                     double *dets);
+  void (*batch_det3)(const double *soa, const size_t count, size_t first,
+                     double *dets);
+  void (*batch_det4)(const double *soa, const size_t count, size_t first,
+                     double *dets);
+};
+
+static void row_update_scalar(double *row, const double *pivot_row,
+                              const double multiplier, const size_t len) {
+  for (size_t j = 0; j < len; j++) {
+    row[j] -= multiplier * pivot_row[j];
+  }
+}
+
+static void row_update4_scalar(double *row, const double *const *pivot_rows,
+                               const double *multipliers, const size_t len) {
+  const double *u0 = pivot_rows[0], *u1 = pivot_rows[1];
+  const double *u2 = pivot_rows[2], *u3 = pivot_rows[3];
+  const double m0 = multipliers[0], m1 = multipliers[1];
+  const double m2 = multipliers[2], m3 = multipliers[3];
+  for (size_t j = 0; j < len; j++) {
+    row[j] =
+        (((row[j] - m0 * u0[j]) - m1 * u1[j]) - m2 * u2[j]) - m3 * u3[j];
+  }
+}
+
+static void row_update_float_scalar(float *row, const float *pivot_row,
+                                    const float multiplier,
+                                    const size_t len) {
+  for (size_t j = 0; j < len; j++) {
+    row[j] -= multiplier * pivot_row[j];
+  }
+}
+
+static void row_update4_float_scalar(float *row,
+                                     const float *const *pivot_rows,
+                                     const float *multipliers,
+                                     const size_t len) {
+  const float *u0 = pivot_rows[0], *u1 = pivot_rows[1];
+  const float *u2 = pivot_rows[2], *u3 = pivot_rows[3];
+  const float m0 = multipliers[0], m1 = multipliers[1];
+  const float m2 = multipliers[2], m3 = multipliers[3];
+  for (size_t j = 0; j < len; j++) {
+    row[j] =
+        (((row[j] - m0 * u0[j]) - m1 * u1[j]) - m2 * u2[j]) - m3 * u3[j];
+  }
+}
+
+static bool are_equal_scalar(const double *mat1, const double *mat2,
+                             size_t len) {
   while (len--) {
     if (*mat1 != *mat2) {
       return false;
@@ -83,51 +170,2884 @@ bool vector_are_equal(const double *mat1, const double *mat2, size_t len) {
   return true;
 }
 
-// Constant pointers can be iterated via copies.
-bool const_vector_are_equal(const double *const mat1, const double *const mat2,
-                            size_t len) {
-  const double *cursor1 = mat1;
-  const double *cursor2 = mat2;
-  while (len--) {
-    if (*cursor1 != *cursor2) {
+/*
+ * The bits of a double without its sign are ordered as its magnitude is, and
+ * adjacent values differ by one ULP.
+ */
+#define MAGNITUDE_BITS 0x7fffffffffffffffULL
+
+static bool are_close_scalar(const double *mat1, const double *mat2,
+                             size_t len, const double abs_tol,
+                             const uint64_t max_ulps) {
+  for (size_t j = 0; j < len; j++) {
+    uint64_t a, b;
+    if (fabs(mat1[j] - mat2[j]) <= abs_tol) {
+      continue;
+    }
+    if (isnan(mat1[j]) || isnan(mat2[j]) ||
+        (signbit(mat1[j]) != signbit(mat2[j]))) {
+      return false;
+    }
+    memcpy(&a, mat1 + j, sizeof(a));
+    memcpy(&b, mat2 + j, sizeof(b));
+    a &= MAGNITUDE_BITS;
+    b &= MAGNITUDE_BITS;
+    if (((a > b) ? a - b : b - a) > max_ulps) {
       return false;
     }
-    cursor1++;
-    cursor2++;
   }
   return true;
 }
 
-bool square_are_equal(const double (*mat1)[SIZE], const double (*mat2)[SIZE]) {
-  /*
-Fails to have intended effect since the function receives a SIZExSIZE object no
-matter what is is passed.
-clang-format off
-  if ((SIZE*SIZE != (sizeof(mat1)/sizeof(double))) || (SIZE*SIZE !=
-(sizeof(mat2)/sizeof(double)))) { return false;
+/* Element k, in row-major order, of matrix m of a batch. */
+#define BATCH_ELEMENT(k) soa[((k) * count) + m]
+
+static void batch_det2_scalar(const double *soa, const size_t count,
+                              size_t first, double *dets) {
+  for (size_t m = first; m < count; m++) {
+    dets[m] = (BATCH_ELEMENT(0) * BATCH_ELEMENT(3)) -
+              (BATCH_ELEMENT(1) * BATCH_ELEMENT(2));
   }
-clang-format on
-  */
-  for (int i = 0; i < SIZE; i++) {
-    for (int j = 0; j < SIZE; j++) {
-      if (mat1[i][j] != mat2[i][j]) {
-        return false;
+}
+
+static void batch_det3_scalar(const double *soa, const size_t count,
+                              size_t first, double *dets) {
+  for (size_t m = first; m < count; m++) {
+    const double a = BATCH_ELEMENT(0), b = BATCH_ELEMENT(1);
+    const double c = BATCH_ELEMENT(2), d = BATCH_ELEMENT(3);
+    const double e = BATCH_ELEMENT(4), f = BATCH_ELEMENT(5);
+    const double g = BATCH_ELEMENT(6), h = BATCH_ELEMENT(7);
+    const double i = BATCH_ELEMENT(8);
+    dets[m] = (a * ((e * i) - (f * h))) - (b * ((d * i) - (f * g))) +
+              (c * ((d * h) - (e * g)));
+  }
+}
+
+/*
+ * Laplace expansion along the first two rows: the sum of the products of
+ * complementary 2x2 minors of rows 0-1 and rows 2-3, with alternating signs.
+ */
+static void batch_det4_scalar(const double *soa, const size_t count,
+                              size_t first, double *dets) {
+  for (size_t m = first; m < count; m++) {
+    double r0[4], r1[4], r2[4], r3[4];
+    for (size_t j = 0; j < 4; j++) {
+      r0[j] = BATCH_ELEMENT(j);
+      r1[j] = BATCH_ELEMENT(4 + j);
+      r2[j] = BATCH_ELEMENT(8 + j);
+      r3[j] = BATCH_ELEMENT(12 + j);
+    }
+    const double s01 = (r0[0] * r1[1]) - (r0[1] * r1[0]);
+    const double s02 = (r0[0] * r1[2]) - (r0[2] * r1[0]);
+    const double s03 = (r0[0] * r1[3]) - (r0[3] * r1[0]);
+    const double s12 = (r0[1] * r1[2]) - (r0[2] * r1[1]);
+    const double s13 = (r0[1] * r1[3]) - (r0[3] * r1[1]);
+    const double s23 = (r0[2] * r1[3]) - (r0[3] * r1[2]);
+    const double c01 = (r2[0] * r3[1]) - (r2[1] * r3[0]);
+    const double c02 = (r2[0] * r3[2]) - (r2[2] * r3[0]);
+    const double c03 = (r2[0] * r3[3]) - (r2[3] * r3[0]);
+    const double c12 = (r2[1] * r3[2]) - (r2[2] * r3[1]);
+    const double c13 = (r2[1] * r3[3]) - (r2[3] * r3[1]);
+    const double c23 = (r2[2] * r3[3]) - (r2[3] * r3[2]);
+    dets[m] = (s01 * c23) - (s02 * c13) + (s03 * c12) + (s12 * c03) -
+              (s13 * c02) + (s23 * c01);
+  }
+}
+
+#ifdef HAVE_X86_SIMD
+__attribute__((target("avx2,fma"))) static void
+row_update_avx2(double *row, const double *pivot_row, const double multiplier,
+                const size_t len) {
+  const __m256d m = _mm256_set1_pd(multiplier);
+  size_t j = 0;
+  for (; j + 4 <= len; j += 4) {
+    const __m256d updated = _mm256_fnmadd_pd(
+        m, _mm256_loadu_pd(pivot_row + j), _mm256_loadu_pd(row + j));
+    _mm256_storeu_pd(row + j, updated);
+  }
+  for (; j < len; j++) {
+    row[j] = fma(-multiplier, pivot_row[j], row[j]);
+  }
+}
+
+__attribute__((target("avx2,fma"))) static void
+row_update4_avx2(double *row, const double *const *pivot_rows,
+                 const double *multipliers, const size_t len) {
+  const double *u0 = pivot_rows[0], *u1 = pivot_rows[1];
+  const double *u2 = pivot_rows[2], *u3 = pivot_rows[3];
+  const __m256d m0 = _mm256_set1_pd(multipliers[0]);
+  const __m256d m1 = _mm256_set1_pd(multipliers[1]);
+  const __m256d m2 = _mm256_set1_pd(multipliers[2]);
+  const __m256d m3 = _mm256_set1_pd(multipliers[3]);
+  size_t j = 0;
+  for (; j + 4 <= len; j += 4) {
+    __m256d updated = _mm256_loadu_pd(row + j);
+    updated = _mm256_fnmadd_pd(m0, _mm256_loadu_pd(u0 + j), updated);
+    updated = _mm256_fnmadd_pd(m1, _mm256_loadu_pd(u1 + j), updated);
+    updated = _mm256_fnmadd_pd(m2, _mm256_loadu_pd(u2 + j), updated);
+    updated = _mm256_fnmadd_pd(m3, _mm256_loadu_pd(u3 + j), updated);
+    _mm256_storeu_pd(row + j, updated);
+  }
+  for (; j < len; j++) {
+    double updated = fma(-multipliers[0], u0[j], row[j]);
+    updated = fma(-multipliers[1], u1[j], updated);
+    updated = fma(-multipliers[2], u2[j], updated);
+    row[j] = fma(-multipliers[3], u3[j], updated);
+  }
+}
+
+/* Eight lanes rather than four, for the same instruction count. */
+__attribute__((target("avx2,fma"))) static void
+row_update_float_avx2(float *row, const float *pivot_row,
+                      const float multiplier, const size_t len) {
+  const __m256 m = _mm256_set1_ps(multiplier);
+  size_t j = 0;
+  for (; j + 8 <= len; j += 8) {
+    const __m256 updated = _mm256_fnmadd_ps(m, _mm256_loadu_ps(pivot_row + j),
+                                            _mm256_loadu_ps(row + j));
+    _mm256_storeu_ps(row + j, updated);
+  }
+  for (; j < len; j++) {
+    row[j] = fmaf(-multiplier, pivot_row[j], row[j]);
+  }
+}
+
+__attribute__((target("avx2,fma"))) static void
+row_update4_float_avx2(float *row, const float *const *pivot_rows,
+                       const float *multipliers, const size_t len) {
+  const float *u0 = pivot_rows[0], *u1 = pivot_rows[1];
+  const float *u2 = pivot_rows[2], *u3 = pivot_rows[3];
+  const __m256 m0 = _mm256_set1_ps(multipliers[0]);
+  const __m256 m1 = _mm256_set1_ps(multipliers[1]);
+  const __m256 m2 = _mm256_set1_ps(multipliers[2]);
+  const __m256 m3 = _mm256_set1_ps(multipliers[3]);
+  size_t j = 0;
+  for (; j + 8 <= len; j += 8) {
+    __m256 updated = _mm256_loadu_ps(row + j);
+    updated = _mm256_fnmadd_ps(m0, _mm256_loadu_ps(u0 + j), updated);
+    updated = _mm256_fnmadd_ps(m1, _mm256_loadu_ps(u1 + j), updated);
+    updated = _mm256_fnmadd_ps(m2, _mm256_loadu_ps(u2 + j), updated);
+    updated = _mm256_fnmadd_ps(m3, _mm256_loadu_ps(u3 + j), updated);
+    _mm256_storeu_ps(row + j, updated);
+  }
+  for (; j < len; j++) {
+    float updated = fmaf(-multipliers[0], u0[j], row[j]);
+    updated = fmaf(-multipliers[1], u1[j], updated);
+    updated = fmaf(-multipliers[2], u2[j], updated);
+    row[j] = fmaf(-multipliers[3], u3[j], updated);
+  }
+}
+
+/* _CMP_NEQ_UQ is true for unordered operands, so NaN != NaN as with !=. */
+__attribute__((target("avx2"))) static bool
+are_equal_avx2(const double *mat1, const double *mat2, size_t len) {
+  size_t j = 0;
+  for (; j + 4 <= len; j += 4) {
+    const __m256d differs = _mm256_cmp_pd(_mm256_loadu_pd(mat1 + j),
+                                          _mm256_loadu_pd(mat2 + j),
+                                          _CMP_NEQ_UQ);
+    if (_mm256_movemask_pd(differs)) {
+      return false;
+    }
+  }
+  return are_equal_scalar(mat1 + j, mat2 + j, len - j);
+}
+
+/*
+ * The scalar tests, four lanes at a time.  Magnitudes are below 2^63, so
+ * their difference fits in a signed lane, and so does max_ulps once clamped.
+ */
+__attribute__((target("avx2"))) static bool
+are_close_avx2(const double *mat1, const double *mat2, size_t len,
+               const double abs_tol, const uint64_t max_ulps) {
+  const __m256d tolerance = _mm256_set1_pd(abs_tol);
+  const __m256d sign_bit = _mm256_set1_pd(-0.0);
+  const __m256i magnitude = _mm256_set1_epi64x((long long)MAGNITUDE_BITS);
+  const __m256i ulps = _mm256_set1_epi64x(
+      (long long)((max_ulps < MAGNITUDE_BITS) ? max_ulps : MAGNITUDE_BITS));
+  const __m256i zero = _mm256_setzero_si256();
+  size_t j = 0;
+  for (; j + 4 <= len; j += 4) {
+    const __m256d a = _mm256_loadu_pd(mat1 + j);
+    const __m256d b = _mm256_loadu_pd(mat2 + j);
+    const __m256d near = _mm256_cmp_pd(
+        _mm256_andnot_pd(sign_bit, _mm256_sub_pd(a, b)), tolerance,
+        _CMP_LE_OQ);
+    const __m256i bits_a = _mm256_castpd_si256(a);
+    const __m256i bits_b = _mm256_castpd_si256(b);
+    /* Lanes whose sign bits differ are negative after the xor. */
+    const __m256i signs_differ =
+        _mm256_cmpgt_epi64(zero, _mm256_xor_si256(bits_a, bits_b));
+    const __m256i difference =
+        _mm256_sub_epi64(_mm256_and_si256(bits_a, magnitude),
+                         _mm256_and_si256(bits_b, magnitude));
+    const __m256i negative = _mm256_cmpgt_epi64(zero, difference);
+    const __m256i distance = _mm256_sub_epi64(
+        _mm256_xor_si256(difference, negative), negative);
+    const __m256i too_far = _mm256_or_si256(
+        signs_differ, _mm256_cmpgt_epi64(distance, ulps));
+    const __m256d within_ulps = _mm256_andnot_pd(
+        _mm256_castsi256_pd(too_far), _mm256_cmp_pd(a, b, _CMP_ORD_Q));
+    if (0xf != _mm256_movemask_pd(_mm256_or_pd(near, within_ulps))) {
+      return false;
+    }
+  }
+  return are_close_scalar(mat1 + j, mat2 + j, len - j, abs_tol, max_ulps);
+}
+
+/* Four matrices of a batch at a time, one per lane. */
+#define BATCH_LANES(k) _mm256_loadu_pd(soa + ((k) * count) + m)
+
+/* a * d - b * c, with one rounding for a * d. */
+__attribute__((target("avx2,fma"))) static inline __m256d
+minor2_avx2(const __m256d a, const __m256d d, const __m256d b,
+            const __m256d c) {
+  return _mm256_fmsub_pd(a, d, _mm256_mul_pd(b, c));
+}
+
+__attribute__((target("avx2,fma"))) static void
+batch_det2_avx2(const double *soa, const size_t count, size_t first,
+                double *dets) {
+  size_t m = first;
+  for (; m + 4 <= count; m += 4) {
+    _mm256_storeu_pd(dets + m, minor2_avx2(BATCH_LANES(0), BATCH_LANES(3),
+                                           BATCH_LANES(1), BATCH_LANES(2)));
+  }
+  batch_det2_scalar(soa, count, m, dets);
+}
+
+__attribute__((target("avx2,fma"))) static void
+batch_det3_avx2(const double *soa, const size_t count, size_t first,
+                double *dets) {
+  size_t m = first;
+  for (; m + 4 <= count; m += 4) {
+    const __m256d a = BATCH_LANES(0), b = BATCH_LANES(1), c = BATCH_LANES(2);
+    const __m256d d = BATCH_LANES(3), e = BATCH_LANES(4), f = BATCH_LANES(5);
+    const __m256d g = BATCH_LANES(6), h = BATCH_LANES(7), i = BATCH_LANES(8);
+    __m256d det = _mm256_mul_pd(a, minor2_avx2(e, i, f, h));
+    det = _mm256_fnmadd_pd(b, minor2_avx2(d, i, f, g), det);
+    det = _mm256_fmadd_pd(c, minor2_avx2(d, h, e, g), det);
+    _mm256_storeu_pd(dets + m, det);
+  }
+  batch_det3_scalar(soa, count, m, dets);
+}
+
+__attribute__((target("avx2,fma"))) static void
+batch_det4_avx2(const double *soa, const size_t count, size_t first,
+                double *dets) {
+  size_t m = first;
+  for (; m + 4 <= count; m += 4) {
+    __m256d r0[4], r1[4], r2[4], r3[4];
+    for (size_t j = 0; j < 4; j++) {
+      r0[j] = BATCH_LANES(j);
+      r1[j] = BATCH_LANES(4 + j);
+      r2[j] = BATCH_LANES(8 + j);
+      r3[j] = BATCH_LANES(12 + j);
+    }
+    const __m256d s01 = minor2_avx2(r0[0], r1[1], r0[1], r1[0]);
+    const __m256d s02 = minor2_avx2(r0[0], r1[2], r0[2], r1[0]);
+    const __m256d s03 = minor2_avx2(r0[0], r1[3], r0[3], r1[0]);
+    const __m256d s12 = minor2_avx2(r0[1], r1[2], r0[2], r1[1]);
+    const __m256d s13 = minor2_avx2(r0[1], r1[3], r0[3], r1[1]);
+    const __m256d s23 = minor2_avx2(r0[2], r1[3], r0[3], r1[2]);
+    const __m256d c01 = minor2_avx2(r2[0], r3[1], r2[1], r3[0]);
+    const __m256d c02 = minor2_avx2(r2[0], r3[2], r2[2], r3[0]);
+    const __m256d c03 = minor2_avx2(r2[0], r3[3], r2[3], r3[0]);
+    const __m256d c12 = minor2_avx2(r2[1], r3[2], r2[2], r3[1]);
+    const __m256d c13 = minor2_avx2(r2[1], r3[3], r2[3], r3[1]);
+    const __m256d c23 = minor2_avx2(r2[2], r3[3], r2[3], r3[2]);
+    __m256d det = _mm256_mul_pd(s01, c23);
+    det = _mm256_fnmadd_pd(s02, c13, det);
+    det = _mm256_fmadd_pd(s03, c12, det);
+    det = _mm256_fmadd_pd(s12, c03, det);
+    det = _mm256_fnmadd_pd(s13, c02, det);
+    det = _mm256_fmadd_pd(s23, c01, det);
+    _mm256_storeu_pd(dets + m, det);
+  }
+  batch_det4_scalar(soa, count, m, dets);
+}
+#endif
+
+static const struct simd_kernels scalar_kernels = {
+    row_update_scalar, row_update4_scalar, row_update_float_scalar,
+    row_update4_float_scalar, are_equal_scalar, are_close_scalar,
+    batch_det2_scalar, batch_det3_scalar, batch_det4_scalar};
+
+static const struct simd_kernels *select_kernels(void) {
+#ifdef HAVE_X86_SIMD
+  static const struct simd_kernels avx2_kernels = {
+      row_update_avx2, row_update4_avx2, row_update_float_avx2,
+      row_update4_float_avx2, are_equal_avx2, are_close_avx2,
+      batch_det2_avx2, batch_det3_avx2, batch_det4_avx2};
+  if (!force_scalar_kernels && __builtin_cpu_supports("avx2") &&
+      __builtin_cpu_supports("fma")) {
+    return &avx2_kernels;
+  }
+#endif
+  return &scalar_kernels;
+}
+
+/*
+ * Find the largest element in column k on or below the diagonal and swap its
+ * row with row k.
+ */
+static void swap_in_pivot_row(double *matrix, const size_t dim,
+                              const size_t stride, const size_t k,
+                              size_t *pivots, int *sign) {
+  double *pivot_row = matrix + (k * stride);
+  size_t pivot = k;
+  double largest = fabs(pivot_row[k]);
+  for (size_t i = k + 1; i < dim; i++) {
+    if (fabs(matrix[(i * stride) + k]) > largest) {
+      largest = fabs(matrix[(i * stride) + k]);
+      pivot = i;
+    }
+  }
+  if (pivots) {
+    pivots[k] = pivot;
+  }
+  if (pivot != k) {
+    double *other_row = matrix + (pivot * stride);
+    for (size_t j = 0; j < dim; j++) {
+      const double saved = pivot_row[j];
+      pivot_row[j] = other_row[j];
+      other_row[j] = saved;
+    }
+    *sign = -*sign;
+  }
+}
+
+/*
+ * Factor the matrix in place into a unit lower-triangular L, stored below the
+ * diagonal, and an upper-triangular U, stored on and above it, with
+ * partial pivoting.  If pivots is not NULL, pivots[k] records the row which
+ * was swapped with row k.  sign is +1 or -1 according to the parity of the
+ * row swaps.  A singular matrix is factored anyway and leaves a zero on the
+ * diagonal of U.
+ */
+int lu_factor(double *matrix, const size_t dim, const size_t stride,
+              size_t *pivots, int *sign) {
+  const struct simd_kernels *kernels = select_kernels();
+  if (!matrix || !sign || (stride < dim)) {
+    fprintf(stderr, "%s: matrix or stride.\n", strerror(EINVAL));
+    return -EINVAL;
+  }
+  *sign = 1;
+  for (size_t k = 0; k < dim; k++) {
+    const double *pivot_row = matrix + (k * stride);
+    swap_in_pivot_row(matrix, dim, stride, k, pivots, sign);
+    /* The column is already zero below the diagonal. */
+    if (0.0 == pivot_row[k]) {
+      continue;
+    }
+    for (size_t i = k + 1; i < dim; i++) {
+      double *row = matrix + (i * stride);
+      const double multiplier = row[k] / pivot_row[k];
+      row[k] = multiplier;
+      kernels->row_update(row + k + 1, pivot_row + k + 1, multiplier,
+                          dim - (k + 1));
+    }
+  }
+  return 0;
+}
+
+/* Factor the panel A[k0:dim, k0:k_end] with the unblocked algorithm. */
+static void factor_panel(double *matrix, const size_t dim, const size_t stride,
+                         const size_t k0, const size_t k_end, size_t *pivots,
+                         int *sign, const struct simd_kernels *kernels) {
+  for (size_t k = k0; k < k_end; k++) {
+    const double *pivot_row = matrix + (k * stride);
+    swap_in_pivot_row(matrix, dim, stride, k, pivots, sign);
+    if (0.0 == pivot_row[k]) {
+      continue;
+    }
+    for (size_t i = k + 1; i < dim; i++) {
+      double *row = matrix + (i * stride);
+      const double multiplier = row[k] / pivot_row[k];
+      row[k] = multiplier;
+      kernels->row_update(row + k + 1, pivot_row + k + 1, multiplier,
+                          k_end - (k + 1));
+    }
+  }
+}
+
+/*
+ * U12 = inverse(L11) * A12 by forward substitution, for columns
+ * [j_start, j_stop) of the block row.
+ */
+static void solve_block_row(double *matrix, const size_t stride,
+                            const size_t k0, const size_t k_end,
+                            const size_t j_start, const size_t j_stop,
+                            const struct simd_kernels *kernels) {
+  if (j_start >= j_stop) {
+    return;
+  }
+  for (size_t k = k0; k < k_end; k++) {
+    const double *pivot_row = matrix + (k * stride);
+    for (size_t i = k + 1; i < k_end; i++) {
+      double *row = matrix + (i * stride);
+      kernels->row_update(row + j_start, pivot_row + j_start, row[k],
+                          j_stop - j_start);
+    }
+  }
+}
+
+/*
+ * A22 -= L21 * U12 for rows [i_start, i_stop), one tile of block columns at a
+ * time.  Four rows of U12 are applied per pass over the tile row, in the same
+ * order as separate passes would apply them, to save loads and stores of A22.
+ */
+static void update_trailing_rows(double *matrix, const size_t dim,
+                                 const size_t stride, const size_t block,
+                                 const size_t k0, const size_t k_end,
+                                 const size_t i_start, const size_t i_stop,
+                                 const struct simd_kernels *kernels) {
+  for (size_t j0 = k_end; j0 < dim; j0 += block) {
+    const size_t j_end = (j0 + block < dim) ? j0 + block : dim;
+    for (size_t i = i_start; i < i_stop; i++) {
+      double *row = matrix + (i * stride);
+      size_t k = k0;
+      for (; k + 4 <= k_end; k += 4) {
+        const double *pivot_rows[4] = {
+            matrix + (k * stride) + j0, matrix + ((k + 1) * stride) + j0,
+            matrix + ((k + 2) * stride) + j0,
+            matrix + ((k + 3) * stride) + j0};
+        kernels->row_update4(row + j0, pivot_rows, row + k, j_end - j0);
+      }
+      for (; k < k_end; k++) {
+        kernels->row_update(row + j0, matrix + (k * stride) + j0, row[k],
+                            j_end - j0);
       }
     }
   }
-  return true;
 }
 
-#ifndef TESTING
+/*
+ * The right-looking blocked form of lu_factor().  Each step factors a panel of
+ * block columns with the unblocked algorithm, solves for the block row of U
+ * to its right, and then subtracts L21*U12 from the trailing matrix in tiles
+ * of block columns, so that the block of U12 which every trailing row reads
+ * stays in cache.  Each element receives the same sequence of updates as in
+ * lu_factor(), so the factors are the same apart from floating-point
+ * contraction.
+ */
+int lu_factor_blocked(double *matrix, const size_t dim, const size_t stride,
+                      const size_t block, size_t *pivots, int *sign) {
+  const struct simd_kernels *kernels = select_kernels();
+  if (!matrix || !sign || (stride < dim) || !block) {
+    fprintf(stderr, "%s: matrix, stride or block size.\n", strerror(EINVAL));
+    return -EINVAL;
+  }
+  *sign = 1;
+  for (size_t k0 = 0; k0 < dim; k0 += block) {
+    const size_t k_end = (k0 + block < dim) ? k0 + block : dim;
+    factor_panel(matrix, dim, stride, k0, k_end, pivots, sign, kernels);
+    solve_block_row(matrix, stride, k0, k_end, k_end, dim, kernels);
+    update_trailing_rows(matrix, dim, stride, block, k0, k_end, k_end, dim,
+                         kernels);
+  }
+  return 0;
+}
 
-/* det = 0*(4*8 - 4*14)  - 2*(6*8 - 6*10) + 2*(6*14 - 4*6) = 24 + 120 = 144
+/* State shared by the threads of one lu_factor_parallel() call */
+struct lu_parallel_job {
+  double *matrix;
+  size_t dim;
+  size_t stride;
+  size_t block;
+  size_t threads;
+  size_t *pivots;
+  int *sign;
+  const struct simd_kernels *kernels;
+};
+
+/*
+ * Worker threads are created by the first factorization which needs them and
+ * then kept, waiting on work_cond, so that later factorizations pay only to
+ * wake them rather than to create and join them.  One factorization uses the
+ * pool at a time, since each already has the threads it asked for.  The
+ * barrier separates the steps of each panel, and is initialized again only
+ * when the number of threads taking part changes.
  */
-int main(void) {
-  const double test_matrix[SIZE][SIZE] = {
-      {0.0, 2.0, 2.0}, {6.0, 4.0, 10.0}, {6.0, 14.0, 8.0}};
+struct lu_thread_pool {
+  /* held by the caller whose factorization is using the pool */
+  pthread_mutex_t owner;
+  pthread_mutex_t lock;
+  pthread_cond_t work_cond;
+  pthread_cond_t done_cond;
+  pthread_t *workers;
+  /* not counting the calling thread, which is always worker 0 */
+  size_t created;
+  /* workers which have read the generation they start from */
+  size_t started;
+  size_t capacity;
+  /* incremented for each job, which the workers wait to see change */
+  size_t generation;
+  size_t finished;
+  bool stopping;
+  struct lu_parallel_job *job;
+  pthread_barrier_t barrier;
+  /* threads which the barrier waits for, or 0 if it is not initialized */
+  size_t barrier_threads;
+};
 
-  assert(144.0 == determinant(test_matrix));
-  exit(EXIT_SUCCESS);
+static struct lu_thread_pool lu_pool = {
+    PTHREAD_MUTEX_INITIALIZER, PTHREAD_MUTEX_INITIALIZER,
+    PTHREAD_COND_INITIALIZER,  PTHREAD_COND_INITIALIZER,
+    NULL, 0, 0, 0, 0, 0, false, NULL, {{0}}, 0};
+
+/*
+ * Split [start, stop) into the given number of nearly equal contiguous parts
+ * and return the bounds of part index.
+ */
+static void partition(const size_t start, const size_t stop,
+                      const size_t index, const size_t parts,
+                      size_t *part_start, size_t *part_stop) {
+  const size_t len = stop - start;
+  *part_start = start + ((len * index) / parts);
+  *part_stop = start + ((len * (index + 1)) / parts);
+}
+
+/*
+ * Thread 0 factors each panel, since the pivot search is sequential.  Then
+ * all threads solve for their share of the columns of U12 and update their
+ * share of the trailing rows.  Every element is updated by exactly one thread
+ * with the same sequence of operations as in lu_factor_blocked(), so the
+ * factors and pivots are identical regardless of the number of threads.
+ */
+static void parallel_lu_steps(struct lu_parallel_job *job, const size_t index,
+                              pthread_barrier_t *barrier) {
+  const size_t dim = job->dim;
+  const size_t stride = job->stride;
+  for (size_t k0 = 0; k0 < dim; k0 += job->block) {
+    const size_t k_end = (k0 + job->block < dim) ? k0 + job->block : dim;
+    size_t start, stop;
+    if (!index) {
+      factor_panel(job->matrix, dim, stride, k0, k_end, job->pivots, job->sign,
+                   job->kernels);
+    }
+    pthread_barrier_wait(barrier);
+    partition(k_end, dim, index, job->threads, &start, &stop);
+    solve_block_row(job->matrix, stride, k0, k_end, start, stop, job->kernels);
+    pthread_barrier_wait(barrier);
+    update_trailing_rows(job->matrix, dim, stride, job->block, k0, k_end,
+                         start, stop, job->kernels);
+    pthread_barrier_wait(barrier);
+  }
+}
+
+/* Worker index takes part in each job with more threads than its index. */
+static void *lu_worker_main(void *arg) {
+  const size_t index = (size_t)(uintptr_t)arg;
+  pthread_mutex_lock(&lu_pool.lock);
+  size_t seen = lu_pool.generation;
+  lu_pool.started++;
+  pthread_cond_signal(&lu_pool.done_cond);
+  for (;;) {
+    while ((seen == lu_pool.generation) && !lu_pool.stopping) {
+      pthread_cond_wait(&lu_pool.work_cond, &lu_pool.lock);
+    }
+    if (lu_pool.stopping) {
+      break;
+    }
+    seen = lu_pool.generation;
+    struct lu_parallel_job *job = lu_pool.job;
+    pthread_mutex_unlock(&lu_pool.lock);
+    if (index < job->threads) {
+      parallel_lu_steps(job, index, &lu_pool.barrier);
+    }
+    pthread_mutex_lock(&lu_pool.lock);
+    if (++lu_pool.finished == lu_pool.created) {
+      pthread_cond_signal(&lu_pool.done_cond);
+    }
+  }
+  pthread_mutex_unlock(&lu_pool.lock);
+  return NULL;
+}
+
+/*
+ * Create workers until there are threads - 1 of them, or creation fails.  The
+ * caller owns the pool, and no job is running.  New workers must read the
+ * generation before the next job changes it, or they would miss the job.
+ */
+static void grow_lu_pool(const size_t threads) {
+  if (threads - 1 > lu_pool.capacity) {
+    pthread_t *workers = (pthread_t *)realloc(
+        lu_pool.workers, (threads - 1) * sizeof(pthread_t));
+    if (!workers) {
+      return;
+    }
+    lu_pool.workers = workers;
+    lu_pool.capacity = threads - 1;
+  }
+  while (lu_pool.created < threads - 1) {
+    /* Worker 0 is the calling thread. */
+    const size_t index = lu_pool.created + 1;
+    pthread_mutex_lock(&lu_pool.lock);
+    const int err = pthread_create(&lu_pool.workers[lu_pool.created], NULL,
+                                   lu_worker_main, (void *)(uintptr_t)index);
+    if (!err) {
+      lu_pool.created++;
+    }
+    pthread_mutex_unlock(&lu_pool.lock);
+    if (err) {
+      break;
+    }
+  }
+  pthread_mutex_lock(&lu_pool.lock);
+  while (lu_pool.started < lu_pool.created) {
+    pthread_cond_wait(&lu_pool.done_cond, &lu_pool.lock);
+  }
+  pthread_mutex_unlock(&lu_pool.lock);
+}
+
+/*
+ * Stop and join the workers of lu_factor_parallel(), for instance before
+ * exit() so that leak checkers see no threads.  A later parallel
+ * factorization creates them again.
+ */
+void release_lu_threads(void) {
+  pthread_mutex_lock(&lu_pool.owner);
+  pthread_mutex_lock(&lu_pool.lock);
+  lu_pool.stopping = true;
+  pthread_cond_broadcast(&lu_pool.work_cond);
+  pthread_mutex_unlock(&lu_pool.lock);
+  for (size_t i = 0; i < lu_pool.created; i++) {
+    pthread_join(lu_pool.workers[i], NULL);
+  }
+  free(lu_pool.workers);
+  lu_pool.workers = NULL;
+  lu_pool.created = 0;
+  lu_pool.started = 0;
+  lu_pool.capacity = 0;
+  lu_pool.stopping = false;
+  if (lu_pool.barrier_threads) {
+    pthread_barrier_destroy(&lu_pool.barrier);
+    lu_pool.barrier_threads = 0;
+  }
+  pthread_mutex_unlock(&lu_pool.owner);
+}
+
+/*
+ * lu_factor_blocked() with the work of each panel spread across threads,
+ * including the caller's.  threads == 0 means one per online CPU.  If fewer
+ * threads can be created than requested, the factorization proceeds with
+ * those which were.
+ */
+int lu_factor_parallel(double *matrix, const size_t dim, const size_t stride,
+                       const size_t block, size_t threads, size_t *pivots,
+                       int *sign) {
+  struct lu_parallel_job job;
+  if (!matrix || !sign || (stride < dim) || !block) {
+    fprintf(stderr, "%s: matrix, stride or block size.\n", strerror(EINVAL));
+    return -EINVAL;
+  }
+  if (!threads) {
+    const long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    threads = (cpus > 0) ? (size_t)cpus : 1;
+  }
+  /* There is nothing to share with fewer rows than threads. */
+  if ((threads < 2) || (dim <= block) || (dim < threads)) {
+    return lu_factor_blocked(matrix, dim, stride, block, pivots, sign);
+  }
+  pthread_mutex_lock(&lu_pool.owner);
+  grow_lu_pool(threads);
+  job.matrix = matrix;
+  job.dim = dim;
+  job.stride = stride;
+  job.block = block;
+  job.threads = (lu_pool.created + 1 < threads) ? lu_pool.created + 1
+                                                : threads;
+  job.pivots = pivots;
+  job.sign = sign;
+  job.kernels = select_kernels();
+  if (job.threads != lu_pool.barrier_threads) {
+    if (lu_pool.barrier_threads) {
+      pthread_barrier_destroy(&lu_pool.barrier);
+    }
+    pthread_barrier_init(&lu_pool.barrier, NULL, job.threads);
+    lu_pool.barrier_threads = job.threads;
+  }
+  *sign = 1;
+  pthread_mutex_lock(&lu_pool.lock);
+  lu_pool.job = &job;
+  lu_pool.finished = 0;
+  lu_pool.generation++;
+  pthread_cond_broadcast(&lu_pool.work_cond);
+  pthread_mutex_unlock(&lu_pool.lock);
+
+  parallel_lu_steps(&job, 0, &lu_pool.barrier);
+  /* Workers beyond job.threads finish at once, but still read the job. */
+  pthread_mutex_lock(&lu_pool.lock);
+  while (lu_pool.finished < lu_pool.created) {
+    pthread_cond_wait(&lu_pool.done_cond, &lu_pool.lock);
+  }
+  lu_pool.job = NULL;
+  pthread_mutex_unlock(&lu_pool.lock);
+  pthread_mutex_unlock(&lu_pool.owner);
+  return 0;
+}
+
+/* The determinant is the product of the diagonal of U, with the swaps' sign. */
+static double factored_determinant(const double *factors, const size_t dim,
+                                   const size_t stride, const int sign) {
+  double det = sign;
+  for (size_t k = 0; k < dim; k++) {
+    det *= factors[(k * stride) + k];
+  }
+  return det;
+}
+
+/*
+ * Factor in place, with the blocked algorithm above one block and with
+ * threads if there are several.
+ */
+static int factor_in_place(double *matrix, const size_t dim,
+                           const size_t stride, const size_t threads,
+                           size_t *pivots, int *sign) {
+  if (dim <= LU_BLOCK_SIZE) {
+    return lu_factor(matrix, dim, stride, pivots, sign);
+  }
+  if (1 == threads) {
+    return lu_factor_blocked(matrix, dim, stride, LU_BLOCK_SIZE, pivots, sign);
+  }
+  return lu_factor_parallel(matrix, dim, stride, LU_BLOCK_SIZE, threads,
+                            pivots, sign);
+}
+
+/* Overwrites the matrix with its LU factors. */
+double determinant_lu(double *matrix, const size_t dim, const size_t stride) {
+  int sign = 1;
+  if (factor_in_place(matrix, dim, stride, 1, NULL, &sign)) {
+    return NAN;
+  }
+  return factored_determinant(matrix, dim, stride, sign);
+}
+
+/* A packed copy, so that the caller's matrix is unchanged by factoring. */
+static double *copy_matrix(const double *matrix, const size_t dim,
+                           const size_t stride) {
+  double *copy = (double *)malloc(dim * dim * sizeof(double));
+  if (!copy) {
+    return NULL;
+  }
+  for (size_t i = 0; i < dim; i++) {
+    memcpy(copy + (i * dim), matrix + (i * stride), dim * sizeof(double));
+  }
+  return copy;
+}
+
+/* Factor a copy of the matrix with the given number of threads. */
+static double copy_and_factor(const double *matrix, const size_t dim,
+                              const size_t stride, const size_t threads) {
+  double *copy = copy_matrix(matrix, dim, stride);
+  double det = NAN;
+  int sign = 1;
+  if (!copy) {
+    return NAN;
+  }
+  if (!factor_in_place(copy, dim, dim, threads, NULL, &sign)) {
+    det = factored_determinant(copy, dim, dim, sign);
+  }
+  free(copy);
+  return det;
+}
+
+/*
+ * Small matrices have closed forms.  Larger ones are copied, so that the
+ * caller's matrix is unchanged, and then factored.
+ */
+double determinant_n(const double *matrix, const size_t dim,
+                     const size_t stride) {
+  if (!matrix || (stride < dim)) {
+    fprintf(stderr, "%s: matrix or stride.\n", strerror(EINVAL));
+    return NAN;
+  }
+  switch (dim) {
+  case 0:
+    return 1.0;
+  case 1:
+    return matrix[0];
+  case 2:
+    return (matrix[0] * matrix[stride + 1]) - (matrix[1] * matrix[stride]);
+  case SIZE: {
+    double square[SIZE][SIZE];
+    for (size_t i = 0; i < SIZE; i++) {
+      memcpy(square[i], matrix + (i * stride), SIZE * sizeof(double));
+    }
+    return determinant((const double(*)[SIZE])square);
+  }
+  default:
+    break;
+  }
+  return copy_and_factor(matrix, dim, stride, 1);
+}
+
+/*
+ * determinant_n() with the factorization of matrices larger than one block
+ * spread across threads.  The result is bitwise identical to the
+ * single-threaded one.
+ */
+double determinant_n_parallel(const double *matrix, const size_t dim,
+                              const size_t stride, const size_t threads) {
+  if (!matrix || (stride < dim) || (dim <= LU_BLOCK_SIZE)) {
+    return determinant_n(matrix, dim, stride);
+  }
+  return copy_and_factor(matrix, dim, stride, threads);
+}
+
+/*
+ * One Bareiss step, (a * d - b * c) / divisor, which is exact since the
+ * result is a minor of the original matrix.  The products are first tried in
+ * 64 bits and, if they overflow, redone in 128.  Returns false if the result
+ * itself does not fit in 64 bits.
+ */
+static bool bareiss_step(const int64_t a, const int64_t d, const int64_t b,
+                         const int64_t c, const int64_t divisor,
+                         int64_t *result) {
+  int64_t ad, bc, difference;
+  if (!__builtin_mul_overflow(a, d, &ad) &&
+      !__builtin_mul_overflow(b, c, &bc) &&
+      !__builtin_sub_overflow(ad, bc, &difference) &&
+      !((INT64_MIN == difference) && (-1 == divisor))) {
+    *result = difference / divisor;
+    return true;
+  }
+#ifdef __SIZEOF_INT128__
+  /* Each product fits in 127 bits, but their difference may not. */
+  __int128 wide;
+  if (__builtin_sub_overflow((__int128)a * d, (__int128)b * c, &wide)) {
+    return false;
+  }
+  wide /= divisor;
+  if ((wide > INT64_MAX) || (wide < INT64_MIN)) {
+    return false;
+  }
+  *result = (int64_t)wide;
+  return true;
+#else
+  return false;
+#endif
+}
+
+/*
+ * Bareiss's fraction-free elimination: after step k, each entry (i, j) below
+ * and right of the pivot is the determinant of the leading (k + 1) x (k + 1)
+ * block bordered by row i and column j, so every division is exact and the
+ * last pivot is the determinant.  Rows are swapped only to avoid a zero
+ * pivot, since magnitude does not matter for exact arithmetic.
+ */
+int determinant_int64(const int64_t *matrix, const size_t dim,
+                      const size_t stride, int64_t *det) {
+  int64_t *work;
+  int64_t previous = 1;
+  int sign = 1;
+  int ret = 0;
+  if (!matrix || !det || (stride < dim)) {
+    fprintf(stderr, "%s: matrix, stride or output.\n", strerror(EINVAL));
+    return -EINVAL;
+  }
+  if (!dim) {
+    *det = 1;
+    return 0;
+  }
+  work = (int64_t *)malloc(dim * dim * sizeof(int64_t));
+  if (!work) {
+    return -ENOMEM;
+  }
+  for (size_t i = 0; i < dim; i++) {
+    memcpy(work + (i * dim), matrix + (i * stride), dim * sizeof(int64_t));
+  }
+  for (size_t k = 0; k < dim - 1; k++) {
+    int64_t *pivot_row = work + (k * dim);
+    if (!pivot_row[k]) {
+      size_t p = k + 1;
+      while ((p < dim) && !work[(p * dim) + k]) {
+        p++;
+      }
+      if (p == dim) {
+        *det = 0;
+        goto out;
+      }
+      for (size_t j = k; j < dim; j++) {
+        const int64_t tmp = pivot_row[j];
+        pivot_row[j] = work[(p * dim) + j];
+        work[(p * dim) + j] = tmp;
+      }
+      sign = -sign;
+    }
+    for (size_t i = k + 1; i < dim; i++) {
+      int64_t *row = work + (i * dim);
+      for (size_t j = k + 1; j < dim; j++) {
+        if (!bareiss_step(row[j], pivot_row[k], row[k], pivot_row[j],
+                          previous, &row[j])) {
+          ret = -ERANGE;
+          goto out;
+        }
+      }
+    }
+    previous = pivot_row[k];
+  }
+  /* -INT64_MIN is not representable. */
+  if ((sign < 0) && (INT64_MIN == work[(dim * dim) - 1])) {
+    ret = -ERANGE;
+  } else {
+    *det = sign * work[(dim * dim) - 1];
+  }
+out:
+  free(work);
+  return ret;
+}
+
+#ifdef __SIZEOF_INT128__
+#define INT128_MAX ((__int128)(((unsigned __int128)1 << 127) - 1))
+#define INT128_MIN (-INT128_MAX - 1)
+
+/* bareiss_step() with minors of up to 128 bits, whose products may not fit. */
+static bool bareiss_step_int128(const __int128 a, const __int128 d,
+                                const __int128 b, const __int128 c,
+                                const __int128 divisor, __int128 *result) {
+  __int128 ad, bc, difference;
+  if (__builtin_mul_overflow(a, d, &ad) || __builtin_mul_overflow(b, c, &bc) ||
+      __builtin_sub_overflow(ad, bc, &difference) ||
+      ((INT128_MIN == difference) && (-1 == divisor))) {
+    return false;
+  }
+  *result = difference / divisor;
+  return true;
+}
+
+/*
+ * determinant_int64() is tried first, since 64-bit steps are several times
+ * faster, and only a matrix whose minors overflow it is eliminated again in
+ * 128 bits.
+ */
+int determinant_int128(const int64_t *matrix, const size_t dim,
+                       const size_t stride, __int128 *det) {
+  __int128 *work;
+  __int128 previous = 1;
+  int64_t narrow;
+  int sign = 1;
+  int ret;
+  if (!det) {
+    fprintf(stderr, "%s: output.\n", strerror(EINVAL));
+    return -EINVAL;
+  }
+  ret = determinant_int64(matrix, dim, stride, &narrow);
+  if (-ERANGE != ret) {
+    if (!ret) {
+      *det = narrow;
+    }
+    return ret;
+  }
+  work = (__int128 *)malloc(dim * dim * sizeof(__int128));
+  if (!work) {
+    return -ENOMEM;
+  }
+  for (size_t k = 0; k < dim * dim; k++) {
+    work[k] = matrix[((k / dim) * stride) + (k % dim)];
+  }
+  ret = 0;
+  for (size_t k = 0; k < dim - 1; k++) {
+    __int128 *pivot_row = work + (k * dim);
+    if (!pivot_row[k]) {
+      size_t p = k + 1;
+      while ((p < dim) && !work[(p * dim) + k]) {
+        p++;
+      }
+      if (p == dim) {
+        *det = 0;
+        goto out;
+      }
+      for (size_t j = k; j < dim; j++) {
+        const __int128 tmp = pivot_row[j];
+        pivot_row[j] = work[(p * dim) + j];
+        work[(p * dim) + j] = tmp;
+      }
+      sign = -sign;
+    }
+    for (size_t i = k + 1; i < dim; i++) {
+      __int128 *row = work + (i * dim);
+      for (size_t j = k + 1; j < dim; j++) {
+        if (!bareiss_step_int128(row[j], pivot_row[k], row[k], pivot_row[j],
+                                 previous, &row[j])) {
+          ret = -ERANGE;
+          goto out;
+        }
+      }
+    }
+    previous = pivot_row[k];
+  }
+  if ((sign < 0) && (INT128_MIN == work[(dim * dim) - 1])) {
+    ret = -ERANGE;
+  } else {
+    *det = sign * work[(dim * dim) - 1];
+  }
+out:
+  free(work);
+  return ret;
+}
+#endif
+
+int make_minor_view(struct minor_view *view, const double *source,
+                    const size_t dim, const size_t stride,
+                    const size_t excluded_row, const size_t excluded_column) {
+  if (!view || !source || (stride < dim) || (excluded_row >= dim) ||
+      (excluded_column >= dim)) {
+    fprintf(stderr, "%s: matrix, stride, or excluded row or column.\n",
+            strerror(EINVAL));
+    return -EINVAL;
+  }
+  view->source = source;
+  view->dim = dim;
+  view->stride = stride;
+  view->excluded_row = excluded_row;
+  view->excluded_column = excluded_column;
+  return 0;
+}
+
+/* Element (i, j) of the minor skips over the excluded row and column. */
+double minor_element(const struct minor_view *view, const size_t i,
+                     const size_t j) {
+  const size_t row = i + (i >= view->excluded_row);
+  const size_t column = j + (j >= view->excluded_column);
+  return view->source[(row * view->stride) + column];
+}
+
+/*
+ * Minors with up to 3 rows have closed forms which read the source directly.
+ * Larger ones are gathered into scratch, which must hold (dim - 1)^2 doubles,
+ * since the LU factorization works in place.
+ */
+static double minor_determinant_scratch(const struct minor_view *view,
+                                        double *scratch) {
+  const size_t n = view->dim - 1;
+  switch (n) {
+  case 0:
+    return 1.0;
+  case 1:
+    return minor_element(view, 0, 0);
+  case 2:
+    return (minor_element(view, 0, 0) * minor_element(view, 1, 1)) -
+           (minor_element(view, 0, 1) * minor_element(view, 1, 0));
+  case 3: {
+    double sum = 0.0;
+    for (size_t j = 0; j < 3; j++) {
+      const size_t left = j ? 0 : 1;
+      const size_t right = (2 == j) ? 1 : 2;
+      const double sign = (j % 2) ? -1.0 : 1.0;
+      sum += sign * minor_element(view, 0, j) *
+             ((minor_element(view, 1, left) * minor_element(view, 2, right)) -
+              (minor_element(view, 1, right) * minor_element(view, 2, left)));
+    }
+    return sum;
+  }
+  default:
+    break;
+  }
+  const size_t c = view->excluded_column;
+  for (size_t i = 0; i < n; i++) {
+    const double *row =
+        view->source + ((i + (i >= view->excluded_row)) * view->stride);
+    memcpy(scratch + (i * n), row, c * sizeof(double));
+    memcpy(scratch + (i * n) + c, row + c + 1, (n - c) * sizeof(double));
+  }
+  return determinant_lu(scratch, n, n);
+}
+
+double minor_determinant(const struct minor_view *view) {
+  double *scratch = NULL;
+  double det;
+  if (!view || !view->source || !view->dim) {
+    fprintf(stderr, "%s: minor view.\n", strerror(EINVAL));
+    return NAN;
+  }
+  if (view->dim > 4) {
+    scratch = (double *)malloc((view->dim - 1) * (view->dim - 1) *
+                               sizeof(double));
+    if (!scratch) {
+      return NAN;
+    }
+  }
+  det = minor_determinant_scratch(view, scratch);
+  free(scratch);
+  return det;
+}
+
+/*
+ * adj(A) = det(A) A^-1, from one O(n^3) factorization rather than n^2
+ * factorizations of minors, written to out with stride dim, transposed for the
+ * cofactor matrix.  Returns -EDOM if A is singular, or if det(A) is zero or
+ * infinite in double while the adjugate may not be, so that the caller can
+ * fall back to the minors.
+ */
+static int cofactors_from_inverse(const double *matrix, const size_t dim,
+                                  const size_t stride, double *out,
+                                  const bool transposed) {
+  struct lu_factorization lu;
+  int ret = initialize_lu(&lu, dim);
+  if (ret) {
+    return ret;
+  }
+  ret = lu_factorize(&lu, matrix, stride);
+  const double det = lu_determinant(&lu);
+  if (!ret && ((0.0 == det) || isinf(det))) {
+    ret = -EDOM;
+  }
+  if (!ret) {
+    ret = lu_inverse(&lu, out);
+  }
+  release_lu_resources(&lu);
+  if (ret) {
+    return ret;
+  }
+  for (size_t i = 0; i < dim; i++) {
+    out[(i * dim) + i] *= det;
+    for (size_t j = i + 1; j < dim; j++) {
+      double *upper = out + (i * dim) + j;
+      double *lower = out + (j * dim) + i;
+      const double saved = *upper;
+      *upper = det * (transposed ? *lower : saved);
+      *lower = det * (transposed ? saved : *lower);
+    }
+  }
+  return 0;
+}
+
+/*
+ * Cofactor (i, j) is (-1)^(i+j) times the minor without row i and column j,
+ * stored at out[(i * i_step) + (j * j_step)], so that the adjugate is the
+ * same loop with the steps swapped.  Minors of up to 3 rows are read in place
+ * through the view.  Above that, the cofactors come from the inverse, and
+ * only a singular matrix gathers each minor into one shared scratch buffer.
+ */
+static int cofactors_to(const double *matrix, const size_t dim,
+                        const size_t stride, double *out, const size_t i_step,
+                        const size_t j_step) {
+  struct minor_view view;
+  double *scratch = NULL;
+  if (!out || !dim || make_minor_view(&view, matrix, dim, stride, 0, 0)) {
+    fprintf(stderr, "%s: matrix or output.\n", strerror(EINVAL));
+    return -EINVAL;
+  }
+  if (dim > 4) {
+    const int ret =
+        cofactors_from_inverse(matrix, dim, stride, out, (1 == j_step));
+    if (-EDOM != ret) {
+      return ret;
+    }
+    scratch = (double *)malloc((dim - 1) * (dim - 1) * sizeof(double));
+    if (!scratch) {
+      return -ENOMEM;
+    }
+  }
+  for (size_t i = 0; i < dim; i++) {
+    view.excluded_row = i;
+    for (size_t j = 0; j < dim; j++) {
+      view.excluded_column = j;
+      const double sign = ((i + j) % 2) ? -1.0 : 1.0;
+      out[(i * i_step) + (j * j_step)] =
+          sign * minor_determinant_scratch(&view, scratch);
+    }
+  }
+  free(scratch);
+  return 0;
+}
+
+int cofactor_matrix(const double *matrix, const size_t dim, const size_t stride,
+                    double *cofactors) {
+  return cofactors_to(matrix, dim, stride, cofactors, dim, 1);
+}
+
+/* The adjugate is the transpose of the cofactor matrix. */
+int adjugate(const double *matrix, const size_t dim, const size_t stride,
+             double *adj) {
+  return cofactors_to(matrix, dim, stride, adj, 1, dim);
+}
+
+/*
+ * The product of the diagonal of U overflows or underflows long before the
+ * factorization does, so keep it as a mantissa in [0.5, 1) and a binary
+ * exponent, renormalized by frexp() after each multiplication, and take one
+ * logarithm at the end.
+ */
+struct magnitude {
+  double mantissa;
+  long exponent;
+};
+
+static void scale_magnitude(struct magnitude *product, const double factor) {
+  int e;
+  product->mantissa = frexp(product->mantissa * fabs(factor), &e);
+  product->exponent += e;
+}
+
+static double log_magnitude(const struct magnitude *product) {
+  return log(product->mantissa) + ((double)product->exponent * M_LN2);
+}
+
+static void factored_slogdet(const double *factors, const size_t dim,
+                             const size_t stride, double *logabsdet) {
+  struct magnitude product = {1.0, 0};
+  for (size_t k = 0; k < dim; k++) {
+    const double pivot = factors[(k * stride) + k];
+    if (0.0 == pivot) {
+      *logabsdet = -INFINITY;
+      return;
+    }
+    scale_magnitude(&product, pivot);
+  }
+  *logabsdet = log_magnitude(&product);
+}
+
+/*
+ * The determinant is sign * exp(logabsdet), where sign is -1, 0 or +1.  A
+ * singular matrix has sign 0 and logabsdet -INFINITY.
+ */
+int slogdet_n(const double *matrix, const size_t dim, const size_t stride,
+              const size_t threads, int *sign, double *logabsdet) {
+  double *copy;
+  int ret;
+  if (!matrix || !sign || !logabsdet || (stride < dim) || !threads) {
+    fprintf(stderr, "%s: matrix, stride, threads or output.\n",
+            strerror(EINVAL));
+    return -EINVAL;
+  }
+  copy = copy_matrix(matrix, dim, stride);
+  if (!copy) {
+    return -ENOMEM;
+  }
+  ret = factor_in_place(copy, dim, dim, threads, NULL, sign);
+  if (!ret) {
+    factored_slogdet(copy, dim, dim, logabsdet);
+    if (isinf(*logabsdet)) {
+      *sign = 0;
+    } else {
+      /* The signs of the pivots as well as of the row swaps. */
+      for (size_t k = 0; k < dim; k++) {
+        if (copy[(k * dim) + k] < 0.0) {
+          *sign = -*sign;
+        }
+      }
+    }
+  }
+  free(copy);
+  return ret;
+}
+
+/*
+ * Single precision: the same blocked factorization as lu_factor_blocked(),
+ * with twice the elements per vector and half the bytes per row.  The
+ * relative error of the result is about 1e-7 times the growth of the factors,
+ * rather than 1e-16.
+ */
+static void swap_in_pivot_row_float(float *matrix, const size_t dim,
+                                    const size_t stride, const size_t k,
+                                    size_t *pivots, int *sign) {
+  float *pivot_row = matrix + (k * stride);
+  size_t pivot = k;
+  float largest = fabsf(pivot_row[k]);
+  for (size_t i = k + 1; i < dim; i++) {
+    if (fabsf(matrix[(i * stride) + k]) > largest) {
+      largest = fabsf(matrix[(i * stride) + k]);
+      pivot = i;
+    }
+  }
+  if (pivots) {
+    pivots[k] = pivot;
+  }
+  if (pivot != k) {
+    float *other_row = matrix + (pivot * stride);
+    for (size_t j = 0; j < dim; j++) {
+      const float saved = pivot_row[j];
+      pivot_row[j] = other_row[j];
+      other_row[j] = saved;
+    }
+    *sign = -*sign;
+  }
+}
+
+static void factor_panel_float(float *matrix, const size_t dim,
+                               const size_t stride, const size_t k0,
+                               const size_t k_end, size_t *pivots, int *sign,
+                               const struct simd_kernels *kernels) {
+  for (size_t k = k0; k < k_end; k++) {
+    const float *pivot_row = matrix + (k * stride);
+    swap_in_pivot_row_float(matrix, dim, stride, k, pivots, sign);
+    if (0.0f == pivot_row[k]) {
+      continue;
+    }
+    for (size_t i = k + 1; i < dim; i++) {
+      float *row = matrix + (i * stride);
+      const float multiplier = row[k] / pivot_row[k];
+      row[k] = multiplier;
+      kernels->row_update_float(row + k + 1, pivot_row + k + 1, multiplier,
+                                k_end - (k + 1));
+    }
+  }
+}
+
+static void solve_block_row_float(float *matrix, const size_t dim,
+                                  const size_t stride, const size_t k0,
+                                  const size_t k_end,
+                                  const struct simd_kernels *kernels) {
+  for (size_t k = k0; k < k_end; k++) {
+    const float *pivot_row = matrix + (k * stride);
+    for (size_t i = k + 1; i < k_end; i++) {
+      float *row = matrix + (i * stride);
+      kernels->row_update_float(row + k_end, pivot_row + k_end, row[k],
+                                dim - k_end);
+    }
+  }
+}
+
+static void update_trailing_rows_float(float *matrix, const size_t dim,
+                                       const size_t stride,
+                                       const size_t block, const size_t k0,
+                                       const size_t k_end,
+                                       const struct simd_kernels *kernels) {
+  for (size_t j0 = k_end; j0 < dim; j0 += block) {
+    const size_t j_end = (j0 + block < dim) ? j0 + block : dim;
+    for (size_t i = k_end; i < dim; i++) {
+      float *row = matrix + (i * stride);
+      size_t k = k0;
+      for (; k + 4 <= k_end; k += 4) {
+        const float *pivot_rows[4] = {
+            matrix + (k * stride) + j0, matrix + ((k + 1) * stride) + j0,
+            matrix + ((k + 2) * stride) + j0,
+            matrix + ((k + 3) * stride) + j0};
+        kernels->row_update4_float(row + j0, pivot_rows, row + k,
+                                   j_end - j0);
+      }
+      for (; k < k_end; k++) {
+        kernels->row_update_float(row + j0, matrix + (k * stride) + j0,
+                                  row[k], j_end - j0);
+      }
+    }
+  }
+}
+
+int lu_factor_float(float *matrix, const size_t dim, const size_t stride,
+                    size_t *pivots, int *sign) {
+  const struct simd_kernels *kernels = select_kernels();
+  if (!matrix || !sign || (stride < dim)) {
+    fprintf(stderr, "%s: matrix or stride.\n", strerror(EINVAL));
+    return -EINVAL;
+  }
+  *sign = 1;
+  for (size_t k0 = 0; k0 < dim; k0 += LU_BLOCK_SIZE) {
+    const size_t k_end = (k0 + LU_BLOCK_SIZE < dim) ? k0 + LU_BLOCK_SIZE : dim;
+    factor_panel_float(matrix, dim, stride, k0, k_end, pivots, sign, kernels);
+    solve_block_row_float(matrix, dim, stride, k0, k_end, kernels);
+    update_trailing_rows_float(matrix, dim, stride, LU_BLOCK_SIZE, k0, k_end,
+                               kernels);
+  }
+  return 0;
+}
+
+/* A packed single-precision copy of a matrix of either precision. */
+static float *copy_matrix_float(const float *fmatrix, const double *dmatrix,
+                                const size_t dim, const size_t stride) {
+  float *copy = (float *)malloc((dim ? dim * dim : 1) * sizeof(float));
+  if (!copy) {
+    return NULL;
+  }
+  for (size_t i = 0; i < dim; i++) {
+    if (fmatrix) {
+      memcpy(copy + (i * dim), fmatrix + (i * stride), dim * sizeof(float));
+    } else {
+      for (size_t j = 0; j < dim; j++) {
+        copy[(i * dim) + j] = (float)dmatrix[(i * stride) + j];
+      }
+    }
+  }
+  return copy;
+}
+
+float determinant_float(const float *matrix, const size_t dim,
+                        const size_t stride) {
+  float *copy;
+  float det = NAN;
+  int sign = 1;
+  if (!matrix || (stride < dim)) {
+    fprintf(stderr, "%s: matrix or stride.\n", strerror(EINVAL));
+    return NAN;
+  }
+  copy = copy_matrix_float(matrix, NULL, dim, stride);
+  if (!copy) {
+    return NAN;
+  }
+  if (!lu_factor_float(copy, dim, dim, NULL, &sign)) {
+    det = (float)sign;
+    for (size_t k = 0; k < dim; k++) {
+      det *= copy[(k * dim) + k];
+    }
+  }
+  free(copy);
+  return det;
+}
+
+/*
+ * Factor the float copy and accumulate the pivots in double, where their
+ * product neither overflows nor loses more precision than the factors have.
+ */
+static int mixed_slogdet(float *copy, const size_t dim, int *sign,
+                         double *logabsdet) {
+  struct magnitude product = {1.0, 0};
+  int ret = lu_factor_float(copy, dim, dim, NULL, sign);
+  if (ret) {
+    return ret;
+  }
+  for (size_t k = 0; k < dim; k++) {
+    const double pivot = copy[(k * dim) + k];
+    if (0.0 == pivot) {
+      *sign = 0;
+      *logabsdet = -INFINITY;
+      return 0;
+    }
+    if (pivot < 0.0) {
+      *sign = -*sign;
+    }
+    scale_magnitude(&product, pivot);
+  }
+  *logabsdet = log_magnitude(&product);
+  return 0;
+}
+
+/* slogdet_n() of a float matrix, factored in float. */
+int slogdet_float(const float *matrix, const size_t dim, const size_t stride,
+                  int *sign, double *logabsdet) {
+  float *copy;
+  int ret;
+  if (!matrix || !sign || !logabsdet || (stride < dim)) {
+    fprintf(stderr, "%s: matrix, stride or output.\n", strerror(EINVAL));
+    return -EINVAL;
+  }
+  copy = copy_matrix_float(matrix, NULL, dim, stride);
+  if (!copy) {
+    return -ENOMEM;
+  }
+  ret = mixed_slogdet(copy, dim, sign, logabsdet);
+  free(copy);
+  return ret;
+}
+
+/*
+ * slogdet_n() of a double matrix, rounded to float for the factorization,
+ * which is most of the work and of the memory traffic.
+ */
+int slogdet_mixed(const double *matrix, const size_t dim, const size_t stride,
+                  int *sign, double *logabsdet) {
+  float *copy;
+  int ret;
+  if (!matrix || !sign || !logabsdet || (stride < dim)) {
+    fprintf(stderr, "%s: matrix, stride or output.\n", strerror(EINVAL));
+    return -EINVAL;
+  }
+  copy = copy_matrix_float(NULL, matrix, dim, stride);
+  if (!copy) {
+    return -ENOMEM;
+  }
+  ret = mixed_slogdet(copy, dim, sign, logabsdet);
+  free(copy);
+  return ret;
+}
+
+/*
+ * A factorization handle is allocated once for its dimension, and may then be
+ * refactored with lu_factorize() any number of times.
+ */
+int initialize_lu(struct lu_factorization *lu, const size_t dim) {
+  if (!lu || !dim) {
+    fprintf(stderr, "%s: factorization or dimension.\n", strerror(EINVAL));
+    return -EINVAL;
+  }
+  memset(lu, 0, sizeof(*lu));
+  lu->dim = dim;
+  lu->factors = (double *)malloc(dim * dim * sizeof(double));
+  lu->pivots = (size_t *)malloc(dim * sizeof(size_t));
+  if (!lu->factors || !lu->pivots) {
+    release_lu_resources(lu);
+    return -ENOMEM;
+  }
+  return 0;
+}
+
+void release_lu_resources(struct lu_factorization *lu) {
+  if (!lu) {
+    return;
+  }
+  free(lu->factors);
+  free(lu->pivots);
+  memset(lu, 0, sizeof(*lu));
+}
+
+/* Factor a copy of the matrix, leaving the matrix itself unchanged. */
+int lu_factorize(struct lu_factorization *lu, const double *matrix,
+                 const size_t stride) {
+  if (!lu || !lu->factors || !matrix || (stride < lu->dim)) {
+    fprintf(stderr, "%s: factorization, matrix or stride.\n",
+            strerror(EINVAL));
+    return -EINVAL;
+  }
+  const size_t dim = lu->dim;
+  for (size_t i = 0; i < dim; i++) {
+    memcpy(lu->factors + (i * dim), matrix + (i * stride),
+           dim * sizeof(double));
+  }
+  return factor_in_place(lu->factors, dim, dim, 1, lu->pivots, &lu->sign);
+}
+
+double lu_determinant(const struct lu_factorization *lu) {
+  if (!lu || !lu->factors) {
+    fprintf(stderr, "%s: factorization.\n", strerror(EINVAL));
+    return NAN;
+  }
+  return factored_determinant(lu->factors, lu->dim, lu->dim, lu->sign);
+}
+
+/*
+ * A single permuted right-hand side, as dot products of the rows of the
+ * factors with the elements of b, which are ldb apart.
+ */
+static void solve_vector(const double *factors, const size_t dim, double *b,
+                         const size_t ldb) {
+  for (size_t i = 1; i < dim; i++) {
+    const double *row = factors + (i * dim);
+    double sum = b[i * ldb];
+    for (size_t k = 0; k < i; k++) {
+      sum -= row[k] * b[k * ldb];
+    }
+    b[i * ldb] = sum;
+  }
+  for (size_t i = dim; i-- > 0;) {
+    const double *row = factors + (i * dim);
+    double sum = b[i * ldb];
+    for (size_t k = i + 1; k < dim; k++) {
+      sum -= row[k] * b[k * ldb];
+    }
+    b[i * ldb] = sum / row[i];
+  }
+}
+
+/*
+ * Row i of the right-hand sides -= the sum over k in [first, last) of
+ * factor_row[k] times row k, four rows per pass as in update_trailing_rows().
+ * Groups of zero factors, as in the L of a diagonal or banded matrix, are
+ * skipped.
+ */
+static void update_solution_row(double *rhs, const size_t ldb,
+                                const size_t nrhs, const size_t i,
+                                const double *factor_row, const size_t first,
+                                const size_t last,
+                                const struct simd_kernels *kernels) {
+  double *row = rhs + (i * ldb);
+  size_t k = first;
+  for (; k + 4 <= last; k += 4) {
+    if ((0.0 == factor_row[k]) && (0.0 == factor_row[k + 1]) &&
+        (0.0 == factor_row[k + 2]) && (0.0 == factor_row[k + 3])) {
+      continue;
+    }
+    const double *rows[4] = {rhs + (k * ldb), rhs + ((k + 1) * ldb),
+                             rhs + ((k + 2) * ldb), rhs + ((k + 3) * ldb)};
+    kernels->row_update4(row, rows, factor_row + k, nrhs);
+  }
+  for (; k < last; k++) {
+    if (0.0 != factor_row[k]) {
+      kernels->row_update(row, rhs + (k * ldb), factor_row[k], nrhs);
+    }
+  }
+}
+
+/*
+ * Overwrite the dim x nrhs right-hand sides B, whose rows start ldb apart,
+ * with the solutions X of A X = B.  The substitutions work on whole rows of
+ * B, so that with many right-hand sides the elimination kernel does the work.
+ * Returns -EDOM if A is singular.
+ */
+int lu_solve(const struct lu_factorization *lu, double *rhs,
+             const size_t nrhs, const size_t ldb) {
+  if (!lu || !lu->factors || !rhs || (ldb < nrhs)) {
+    fprintf(stderr, "%s: factorization, right-hand sides or stride.\n",
+            strerror(EINVAL));
+    return -EINVAL;
+  }
+  const struct simd_kernels *kernels = select_kernels();
+  const size_t dim = lu->dim;
+  const double *factors = lu->factors;
+  for (size_t k = 0; k < dim; k++) {
+    if (0.0 == factors[(k * dim) + k]) {
+      return -EDOM;
+    }
+  }
+  /* P B, with the swaps applied in the order they were made. */
+  for (size_t k = 0; k < dim; k++) {
+    if (lu->pivots[k] != k) {
+      double *row = rhs + (k * ldb);
+      double *other_row = rhs + (lu->pivots[k] * ldb);
+      for (size_t j = 0; j < nrhs; j++) {
+        const double saved = row[j];
+        row[j] = other_row[j];
+        other_row[j] = saved;
+      }
+    }
+  }
+  if (1 == nrhs) {
+    solve_vector(factors, dim, rhs, ldb);
+    return 0;
+  }
+  /* L Y = P B */
+  for (size_t i = 1; i < dim; i++) {
+    update_solution_row(rhs, ldb, nrhs, i, factors + (i * dim), 0, i,
+                        kernels);
+  }
+  /* U X = Y */
+  for (size_t i = dim; i-- > 0;) {
+    double *row = rhs + (i * ldb);
+    update_solution_row(rhs, ldb, nrhs, i, factors + (i * dim), i + 1, dim,
+                        kernels);
+    const double reciprocal = 1.0 / factors[(i * dim) + i];
+    for (size_t j = 0; j < nrhs; j++) {
+      row[j] *= reciprocal;
+    }
+  }
+  return 0;
+}
+
+/* The inverse is the solution of A X = I, and is dim x dim with stride dim. */
+int lu_inverse(const struct lu_factorization *lu, double *inverse) {
+  if (!lu || !inverse) {
+    fprintf(stderr, "%s: factorization or inverse.\n", strerror(EINVAL));
+    return -EINVAL;
+  }
+  const size_t dim = lu->dim;
+  memset(inverse, 0, dim * dim * sizeof(double));
+  for (size_t i = 0; i < dim; i++) {
+    inverse[(i * dim) + i] = 1.0;
+  }
+  return lu_solve(lu, inverse, dim, dim);
+}
+
+/*
+ * A diagonal matrix is its own U factor, with L the identity and no row
+ * swaps, so it needs no elimination.
+ */
+int lu_factorize_diagonal(struct lu_factorization *lu,
+                          const double *diagonal) {
+  if (!lu || !lu->factors || !diagonal) {
+    fprintf(stderr, "%s: factorization or diagonal.\n", strerror(EINVAL));
+    return -EINVAL;
+  }
+  const size_t dim = lu->dim;
+  memset(lu->factors, 0, dim * dim * sizeof(double));
+  for (size_t k = 0; k < dim; k++) {
+    lu->factors[(k * dim) + k] = diagonal[k];
+    lu->pivots[k] = k;
+  }
+  lu->sign = 1;
+  return 0;
+}
+
+/*
+ * S = D - C A^-1 B, m x m and packed, where A is the leading k x k block of
+ * the matrix and m = dim - k.  A^-1 B is k x m, solved for all of the
+ * columns of B at once, and then each row of S is one row of D updated by
+ * the rows of A^-1 B, four at a time as in update_trailing_rows().
+ */
+static int schur_complement(const struct lu_factorization *a,
+                            const double *matrix, const size_t dim,
+                            const size_t stride, double *s) {
+  const struct simd_kernels *kernels = select_kernels();
+  const size_t k = a->dim, m = dim - k;
+  double *x = (double *)malloc(((k && m) ? k * m : 1) * sizeof(double));
+  int ret;
+  if (!x) {
+    return -ENOMEM;
+  }
+  for (size_t i = 0; i < k; i++) {
+    memcpy(x + (i * m), matrix + (i * stride) + k, m * sizeof(double));
+  }
+  ret = lu_solve(a, x, m, m);
+  if (ret) {
+    free(x);
+    return ret;
+  }
+  for (size_t i = 0; i < m; i++) {
+    memcpy(s + (i * m), matrix + ((k + i) * stride) + k, m * sizeof(double));
+  }
+  /* A block of rows of A^-1 B at a time stays in cache for all of S. */
+  for (size_t l0 = 0; l0 < k; l0 += LU_BLOCK_SIZE) {
+    const size_t l_end = (l0 + LU_BLOCK_SIZE < k) ? l0 + LU_BLOCK_SIZE : k;
+    for (size_t i = 0; i < m; i++) {
+      const double *c = matrix + ((k + i) * stride);
+      double *row = s + (i * m);
+      size_t l = l0;
+      for (; l + 4 <= l_end; l += 4) {
+        const double *rows[4] = {x + (l * m), x + ((l + 1) * m),
+                                 x + ((l + 2) * m), x + ((l + 3) * m)};
+        kernels->row_update4(row, rows, c + l, m);
+      }
+      for (; l < l_end; l++) {
+        kernels->row_update(row, x + (l * m), c[l], m);
+      }
+    }
+  }
+  free(x);
+  return 0;
+}
+
+static int check_schur(const struct lu_factorization *a, const double *matrix,
+                       const size_t dim, const size_t stride) {
+  if (!a || !a->factors || !matrix || (stride < dim) || (a->dim > dim)) {
+    fprintf(stderr, "%s: factorization, matrix, dimension or stride.\n",
+            strerror(EINVAL));
+    return -EINVAL;
+  }
+  return 0;
+}
+
+/*
+ * det(M) = det(A) det(D - C A^-1 B), where the dim x dim matrix M is
+ * [A B; C D] and the leading block A has already been factored into a.  Only
+ * B, C and D are read from the matrix, so that when they change between
+ * calls, the cost is O(k^2 m + k m^2 + m^3) rather than O((k + m)^3).
+ * Returns -EDOM if A is singular, in which case M must be factored whole.
+ */
+int schur_slogdet(const struct lu_factorization *a, const double *matrix,
+                  const size_t dim, const size_t stride, int *sign,
+                  double *logabsdet) {
+  int ret = check_schur(a, matrix, dim, stride);
+  int s_sign;
+  double s_logabsdet;
+  if (ret) {
+    return ret;
+  }
+  if (!sign || !logabsdet) {
+    fprintf(stderr, "%s: output.\n", strerror(EINVAL));
+    return -EINVAL;
+  }
+  const size_t m = dim - a->dim;
+  double *s = (double *)malloc((m ? m * m : 1) * sizeof(double));
+  if (!s) {
+    return -ENOMEM;
+  }
+  ret = schur_complement(a, matrix, dim, stride, s);
+  if (!ret) {
+    ret = slogdet_n(s, m, m, 1, &s_sign, &s_logabsdet);
+  }
+  free(s);
+  if (ret) {
+    return ret;
+  }
+  /* lu_solve() has checked that the pivots of A are nonzero. */
+  factored_slogdet(a->factors, a->dim, a->dim, logabsdet);
+  *sign = a->sign * s_sign;
+  for (size_t k = 0; k < a->dim; k++) {
+    if (a->factors[(k * a->dim) + k] < 0.0) {
+      *sign = -*sign;
+    }
+  }
+  *logabsdet = s_sign ? *logabsdet + s_logabsdet : -INFINITY;
+  return 0;
+}
+
+/* As schur_slogdet(), returning NAN on error. */
+double schur_determinant(const struct lu_factorization *a,
+                         const double *matrix, const size_t dim,
+                         const size_t stride) {
+  double det = NAN;
+  if (check_schur(a, matrix, dim, stride)) {
+    return NAN;
+  }
+  const size_t m = dim - a->dim;
+  double *s = (double *)malloc((m ? m * m : 1) * sizeof(double));
+  if (!s) {
+    return NAN;
+  }
+  if (!schur_complement(a, matrix, dim, stride, s)) {
+    det = lu_determinant(a) * determinant_n(s, m, m);
+  }
+  free(s);
+  return det;
+}
+
+/*
+ * Factor the tracked matrix from scratch and, unless it is singular, invert
+ * it.
+ */
+static int refactor_tracker(struct determinant_tracker *tracker) {
+  int ret = lu_factorize(&tracker->lu, tracker->matrix, tracker->dim);
+  if (ret) {
+    return ret;
+  }
+  tracker->det = lu_determinant(&tracker->lu);
+  tracker->singular = (0.0 == tracker->det);
+  if (!tracker->singular) {
+    ret = lu_inverse(&tracker->lu, tracker->inverse);
+  }
+  tracker->updates = 0;
+  return ret;
+}
+
+void release_tracker_resources(struct determinant_tracker *tracker) {
+  if (!tracker) {
+    return;
+  }
+  free(tracker->matrix);
+  free(tracker->inverse);
+  release_lu_resources(&tracker->lu);
+  free(tracker->scratch);
+  memset(tracker, 0, sizeof(*tracker));
+}
+
+/*
+ * Track the determinant of a copy of the matrix through rank-1 updates.
+ * After refactor_interval updates, or any update which makes the matrix
+ * singular or nearly so, the determinant and inverse are recomputed from the
+ * matrix itself rather than updated, so that rounding errors do not
+ * accumulate.
+ */
+int initialize_tracker(struct determinant_tracker *tracker,
+                       const double *matrix, const size_t dim,
+                       const size_t stride, const size_t refactor_interval) {
+  if (!tracker || !matrix || !dim || (stride < dim) || !refactor_interval) {
+    fprintf(stderr, "%s: matrix, stride or refactoring interval.\n",
+            strerror(EINVAL));
+    return -EINVAL;
+  }
+  memset(tracker, 0, sizeof(*tracker));
+  tracker->dim = dim;
+  tracker->refactor_interval = refactor_interval;
+  tracker->matrix = copy_matrix(matrix, dim, stride);
+  tracker->inverse = (double *)malloc(dim * dim * sizeof(double));
+  /* A^-1 u and v^T A^-1, and u and v for row and column replacement */
+  tracker->scratch = (double *)malloc(4 * dim * sizeof(double));
+  if (!tracker->matrix || !tracker->inverse || !tracker->scratch ||
+      initialize_lu(&tracker->lu, dim)) {
+    release_tracker_resources(tracker);
+    return -ENOMEM;
+  }
+  return refactor_tracker(tracker);
+}
+
+/* Relative size of 1 + v^T A^-1 u below which an update counts as singular. */
+#define TRACKER_SINGULAR_RATIO 1e-12
+
+/*
+ * The matrix has already had u v^T added.  By the matrix determinant lemma,
+ *   det(A + u v^T) = (1 + v^T A^-1 u) det(A),
+ * and by the Sherman-Morrison formula,
+ *   (A + u v^T)^-1 = A^-1 - (A^-1 u)(v^T A^-1) / (1 + v^T A^-1 u),
+ * both in O(n^2).
+ */
+static int update_tracker(struct determinant_tracker *tracker,
+                          const double *u, const double *v) {
+  const struct simd_kernels *kernels = select_kernels();
+  const size_t dim = tracker->dim;
+  /* inverse_u = A^-1 u and v_inverse = v^T A^-1 */
+  double *inverse_u = tracker->scratch;
+  double *v_inverse = tracker->scratch + dim;
+  double ratio = 1.0, scale = 1.0;
+  if (tracker->singular ||
+      (++tracker->updates >= tracker->refactor_interval)) {
+    return refactor_tracker(tracker);
+  }
+  memset(v_inverse, 0, dim * sizeof(double));
+  for (size_t i = 0; i < dim; i++) {
+    const double *row = tracker->inverse + (i * dim);
+    double sum = 0.0;
+    for (size_t j = 0; j < dim; j++) {
+      sum += row[j] * u[j];
+    }
+    inverse_u[i] = sum;
+    ratio += v[i] * sum;
+    scale += fabs(v[i] * sum);
+    kernels->row_update(v_inverse, row, -v[i], dim);
+  }
+  /* Cancellation in 1 + v^T A^-1 u leaves nothing accurate to divide by. */
+  if (fabs(ratio) < TRACKER_SINGULAR_RATIO * scale) {
+    return refactor_tracker(tracker);
+  }
+  tracker->det *= ratio;
+  for (size_t i = 0; i < dim; i++) {
+    kernels->row_update(tracker->inverse + (i * dim), v_inverse,
+                        inverse_u[i] / ratio, dim);
+  }
+  return 0;
+}
+
+/* A += u v^T */
+int rank1_update(struct determinant_tracker *tracker, const double *u,
+                 const double *v) {
+  if (!tracker || !tracker->matrix || !u || !v) {
+    fprintf(stderr, "%s: tracker or update vectors.\n", strerror(EINVAL));
+    return -EINVAL;
+  }
+  const size_t dim = tracker->dim;
+  for (size_t i = 0; i < dim; i++) {
+    select_kernels()->row_update(tracker->matrix + (i * dim), v, -u[i], dim);
+  }
+  return update_tracker(tracker, u, v);
+}
+
+/*
+ * Row replacement is the rank-1 update e_row (values - A[row])^T.  The
+ * values are stored exactly, rather than as A[row] + (values - A[row]).
+ */
+int replace_row(struct determinant_tracker *tracker, const size_t row,
+                const double *values) {
+  if (!tracker || !tracker->matrix || !values || (row >= tracker->dim)) {
+    fprintf(stderr, "%s: tracker, row or values.\n", strerror(EINVAL));
+    return -EINVAL;
+  }
+  const size_t dim = tracker->dim;
+  double *u = tracker->scratch + (2 * dim);
+  double *v = tracker->scratch + (3 * dim);
+  memset(u, 0, dim * sizeof(double));
+  u[row] = 1.0;
+  for (size_t j = 0; j < dim; j++) {
+    v[j] = values[j] - tracker->matrix[(row * dim) + j];
+  }
+  memcpy(tracker->matrix + (row * dim), values, dim * sizeof(double));
+  return update_tracker(tracker, u, v);
+}
+
+/*
+ * Column replacement is the rank-1 update (values - A[:, column]) e_column^T.
+ */
+int replace_column(struct determinant_tracker *tracker, const size_t column,
+                   const double *values) {
+  if (!tracker || !tracker->matrix || !values || (column >= tracker->dim)) {
+    fprintf(stderr, "%s: tracker, column or values.\n", strerror(EINVAL));
+    return -EINVAL;
+  }
+  const size_t dim = tracker->dim;
+  double *u = tracker->scratch + (2 * dim);
+  double *v = tracker->scratch + (3 * dim);
+  memset(v, 0, dim * sizeof(double));
+  v[column] = 1.0;
+  for (size_t i = 0; i < dim; i++) {
+    u[i] = values[i] - tracker->matrix[(i * dim) + column];
+    tracker->matrix[(i * dim) + column] = values[i];
+  }
+  return update_tracker(tracker, u, v);
+}
+
+/*
+ * Sparse LU, after Gilbert and Peierls: column k of P A Q = L U is found by a
+ * sparse triangular solve with the first k columns of L, whose nonzero
+ * pattern is the set of rows reachable from those of the column in the graph
+ * of L, so the work is proportional to the arithmetic rather than to n.
+ * Only L is kept, since the determinant needs just the diagonal of U.
+ */
+
+/* Row has not yet been chosen as a pivot. */
+#define UNPIVOTED SIZE_MAX
+/*
+ * A pivot on the diagonal, which the fill-reducing ordering assumes, is kept
+ * unless another candidate is this many times larger.
+ */
+#define SPARSE_PIVOT_TOLERANCE 0.1
+
+static int check_sparse(const struct sparse_matrix *matrix) {
+  if (!matrix || !matrix->starts || matrix->starts[0]) {
+    return -EINVAL;
+  }
+  const size_t nnz = matrix->starts[matrix->dim];
+  if (nnz && (!matrix->indices || !matrix->values)) {
+    return -EINVAL;
+  }
+  for (size_t j = 0; j < matrix->dim; j++) {
+    if (matrix->starts[j + 1] < matrix->starts[j]) {
+      return -EINVAL;
+    }
+  }
+  for (size_t p = 0; p < nnz; p++) {
+    if (matrix->indices[p] >= matrix->dim) {
+      return -EINVAL;
+    }
+  }
+  return 0;
+}
+
+struct adjacency {
+  size_t *nodes;
+  size_t len;
+  size_t cap;
+};
+
+static bool add_neighbor(struct adjacency *list, const size_t node) {
+  if (list->len == list->cap) {
+    const size_t cap = list->cap ? (2 * list->cap) : 4;
+    size_t *nodes = (size_t *)realloc(list->nodes, cap * sizeof(size_t));
+    if (!nodes) {
+      return false;
+    }
+    list->nodes = nodes;
+    list->cap = cap;
+  }
+  list->nodes[list->len++] = node;
+  return true;
+}
+
+/* Doubly-linked lists of the uneliminated nodes of each degree. */
+struct degree_lists {
+  size_t *head;
+  size_t *next;
+  size_t *prev;
+  size_t *degree;
+};
+
+static void insert_degree(struct degree_lists *lists, const size_t node,
+                          const size_t degree) {
+  lists->degree[node] = degree;
+  lists->prev[node] = UNPIVOTED;
+  lists->next[node] = lists->head[degree];
+  if (UNPIVOTED != lists->head[degree]) {
+    lists->prev[lists->head[degree]] = node;
+  }
+  lists->head[degree] = node;
+}
+
+static void remove_degree(struct degree_lists *lists, const size_t node) {
+  if (UNPIVOTED != lists->prev[node]) {
+    lists->next[lists->prev[node]] = lists->next[node];
+  } else {
+    lists->head[lists->degree[node]] = lists->next[node];
+  }
+  if (UNPIVOTED != lists->next[node]) {
+    lists->prev[lists->next[node]] = lists->prev[node];
+  }
+}
+
+/* Remove the entries of list for which drop[entry] is true. */
+static void filter_adjacency(struct adjacency *list, const bool *drop) {
+  size_t kept = 0;
+  for (size_t e = 0; e < list->len; e++) {
+    if (!drop[list->nodes[e]]) {
+      list->nodes[kept++] = list->nodes[e];
+    }
+  }
+  list->len = kept;
+}
+
+/*
+ * Approximate minimum-degree ordering of the graph of A + A^T, in the manner
+ * of AMD but without its supervariables.  Eliminating a variable does not add
+ * the clique of its neighbors to the graph, which would cost as much as the
+ * fill; instead the variable becomes an element, whose list of variables
+ * stands for the clique, and absorbs the elements it was adjacent to.  The
+ * degree of a variable is then bounded by its remaining variable neighbors
+ * plus, for each adjacent element e, the variables of e outside the element
+ * just formed.
+ */
+static int minimum_degree_order(const struct sparse_matrix *matrix,
+                                size_t *order) {
+  const size_t dim = matrix->dim;
+  /* A variable's variable neighbors, or an element's variables. */
+  struct adjacency *variables =
+      (struct adjacency *)calloc(dim, sizeof(struct adjacency));
+  /* A variable's adjacent elements. */
+  struct adjacency *elements =
+      (struct adjacency *)calloc(dim, sizeof(struct adjacency));
+  size_t *mark = (size_t *)calloc(dim, sizeof(size_t));
+  size_t *external = (size_t *)malloc(dim * sizeof(size_t));
+  /* Absorbed elements and eliminated variables, for filter_adjacency(). */
+  bool *absorbed = (bool *)calloc(dim, sizeof(bool));
+  bool *in_pivot_element = (bool *)calloc(dim, sizeof(bool));
+  struct degree_lists lists;
+  /* More neighbors than this make a variable dense. */
+  size_t dense_degree = 10 * (size_t)sqrt((double)dim);
+  size_t dense_count = 0;
+  size_t stamp = 0;
+  int ret = -ENOMEM;
+  lists.head = (size_t *)malloc(dim * sizeof(size_t));
+  lists.next = (size_t *)malloc(dim * sizeof(size_t));
+  lists.prev = (size_t *)malloc(dim * sizeof(size_t));
+  lists.degree = (size_t *)malloc(dim * sizeof(size_t));
+  if (dense_degree < 16) {
+    dense_degree = 16;
+  }
+  if (!variables || !elements || !mark || !external || !absorbed ||
+      !in_pivot_element || !lists.head || !lists.next || !lists.prev ||
+      !lists.degree) {
+    goto out;
+  }
+  for (size_t j = 0; j < dim; j++) {
+    for (size_t p = matrix->starts[j]; p < matrix->starts[j + 1]; p++) {
+      const size_t i = matrix->indices[p];
+      if ((i != j) && (!add_neighbor(&variables[i], j) ||
+                       !add_neighbor(&variables[j], i))) {
+        goto out;
+      }
+    }
+  }
+  for (size_t d = 0; d < dim; d++) {
+    lists.head[d] = UNPIVOTED;
+  }
+  /* Drop duplicate edges, which the two triangles of A mostly produce. */
+  for (size_t u = 0; u < dim; u++) {
+    size_t kept = 0;
+    stamp++;
+    mark[u] = stamp;
+    for (size_t e = 0; e < variables[u].len; e++) {
+      const size_t w = variables[u].nodes[e];
+      if (mark[w] != stamp) {
+        mark[w] = stamp;
+        variables[u].nodes[kept++] = w;
+      }
+    }
+    variables[u].len = kept;
+  }
+  /*
+   * Dense rows and columns would be touched by nearly every elimination, so
+   * as in AMD they are left out of the graph and ordered last.  absorbed
+   * doubles as the set of dense variables until the first elimination.
+   */
+  for (size_t u = 0; u < dim; u++) {
+    if (variables[u].len > dense_degree) {
+      absorbed[u] = true;
+      order[dim - ++dense_count] = u;
+    }
+  }
+  for (size_t u = 0; u < dim; u++) {
+    if (absorbed[u]) {
+      variables[u].len = 0;
+    } else {
+      filter_adjacency(&variables[u], absorbed);
+      insert_degree(&lists, u, variables[u].len);
+    }
+  }
+  memset(absorbed, 0, dim * sizeof(bool));
+  for (size_t k = 0, least = 0; k < dim - dense_count; k++) {
+    while (UNPIVOTED == lists.head[least]) {
+      least++;
+    }
+    const size_t pivot = lists.head[least];
+    remove_degree(&lists, pivot);
+    order[k] = pivot;
+
+    /*
+     * The new element's variables are the pivot's variable neighbors and
+     * those of its elements, which it absorbs.
+     */
+    struct adjacency element = {NULL, 0, 0};
+    stamp++;
+    mark[pivot] = stamp;
+    for (size_t e = 0; e < variables[pivot].len; e++) {
+      const size_t v = variables[pivot].nodes[e];
+      if (mark[v] != stamp) {
+        mark[v] = stamp;
+        if (!add_neighbor(&element, v)) {
+          free(element.nodes);
+          goto out;
+        }
+      }
+    }
+    for (size_t f = 0; f < elements[pivot].len; f++) {
+      const size_t old = elements[pivot].nodes[f];
+      for (size_t e = 0; e < variables[old].len; e++) {
+        const size_t v = variables[old].nodes[e];
+        if (mark[v] != stamp) {
+          mark[v] = stamp;
+          if (!add_neighbor(&element, v)) {
+            free(element.nodes);
+            goto out;
+          }
+        }
+      }
+      absorbed[old] = true;
+      free(variables[old].nodes);
+      memset(&variables[old], 0, sizeof(variables[old]));
+    }
+    free(variables[pivot].nodes);
+    free(elements[pivot].nodes);
+    memset(&elements[pivot], 0, sizeof(elements[pivot]));
+    variables[pivot] = element;
+
+    /*
+     * The element's variables are now adjacent through it, so drop them and
+     * the pivot from each other's variable lists, and the absorbed elements
+     * from their element lists.  Then count |L_e \ L_pivot| for each of
+     * their remaining elements e.
+     */
+    in_pivot_element[pivot] = true;
+    for (size_t e = 0; e < element.len; e++) {
+      in_pivot_element[element.nodes[e]] = true;
+    }
+    stamp++;
+    for (size_t e = 0; e < element.len; e++) {
+      const size_t i = element.nodes[e];
+      remove_degree(&lists, i);
+      filter_adjacency(&variables[i], in_pivot_element);
+      filter_adjacency(&elements[i], absorbed);
+      for (size_t f = 0; f < elements[i].len; f++) {
+        const size_t other = elements[i].nodes[f];
+        if (mark[other] != stamp) {
+          mark[other] = stamp;
+          external[other] = variables[other].len;
+        }
+        external[other]--;
+      }
+    }
+    in_pivot_element[pivot] = false;
+    for (size_t e = 0; e < element.len; e++) {
+      in_pivot_element[element.nodes[e]] = false;
+    }
+
+    /* Elements entirely inside the new one are redundant, and absorbed too. */
+    for (size_t e = 0; e < element.len; e++) {
+      const size_t i = element.nodes[e];
+      for (size_t f = 0; f < elements[i].len; f++) {
+        const size_t other = elements[i].nodes[f];
+        if (!external[other] && !absorbed[other]) {
+          absorbed[other] = true;
+          free(variables[other].nodes);
+          memset(&variables[other], 0, sizeof(variables[other]));
+        }
+      }
+    }
+    const size_t remaining = dim - dense_count - k - 1;
+    for (size_t e = 0; e < element.len; e++) {
+      const size_t i = element.nodes[e];
+      size_t degree = variables[i].len + element.len - 1;
+      filter_adjacency(&elements[i], absorbed);
+      for (size_t f = 0; f < elements[i].len; f++) {
+        degree += external[elements[i].nodes[f]];
+      }
+      if (!add_neighbor(&elements[i], pivot)) {
+        goto out;
+      }
+      if (degree > remaining - 1) {
+        degree = remaining - 1;
+      }
+      insert_degree(&lists, i, degree);
+      if (degree < least) {
+        least = degree;
+      }
+    }
+  }
+  ret = 0;
+out:
+  for (size_t u = 0; variables && elements && (u < dim); u++) {
+    free(variables[u].nodes);
+    free(elements[u].nodes);
+  }
+  free(variables);
+  free(elements);
+  free(mark);
+  free(external);
+  free(absorbed);
+  free(in_pivot_element);
+  free(lists.head);
+  free(lists.next);
+  free(lists.prev);
+  free(lists.degree);
+  return ret;
+}
+
+/* The columns of L so far, with row indices in the original numbering. */
+struct sparse_factor {
+  size_t *starts;
+  size_t *rows;
+  double *values;
+  size_t nnz;
+  size_t cap;
+};
+
+static bool append_factor(struct sparse_factor *factor, const size_t row,
+                          const double value) {
+  if (factor->nnz == factor->cap) {
+    const size_t cap = 2 * factor->cap;
+    size_t *rows = (size_t *)realloc(factor->rows, cap * sizeof(size_t));
+    if (!rows) {
+      return false;
+    }
+    factor->rows = rows;
+    double *values = (double *)realloc(factor->values, cap * sizeof(double));
+    if (!values) {
+      return false;
+    }
+    factor->values = values;
+    factor->cap = cap;
+  }
+  factor->rows[factor->nnz] = row;
+  factor->values[factor->nnz] = value;
+  factor->nnz++;
+  return true;
+}
+
+/*
+ * Depth-first search from row start through the graph of L, in which a
+ * pivoted row i has edges to the rows of column pinv[i].  Finished rows are
+ * pushed onto reach[top - 1], reach[top - 2], ..., which leaves reach[top:]
+ * in topological order.  Iterative, since the paths may be n long.
+ */
+static size_t reach_from(const size_t start, size_t top,
+                         const struct sparse_factor *factor,
+                         const size_t *pinv, size_t *reach, size_t *stack,
+                         size_t *position, size_t *visited,
+                         const size_t stamp) {
+  size_t depth = 1;
+  stack[0] = start;
+  visited[start] = stamp;
+  position[start] =
+      (UNPIVOTED == pinv[start]) ? 0 : factor->starts[pinv[start]];
+  while (depth) {
+    const size_t i = stack[depth - 1];
+    bool done = true;
+    if (UNPIVOTED != pinv[i]) {
+      const size_t end = factor->starts[pinv[i] + 1];
+      for (size_t p = position[i]; p < end; p++) {
+        const size_t r = factor->rows[p];
+        if (visited[r] != stamp) {
+          visited[r] = stamp;
+          position[i] = p + 1;
+          position[r] = (UNPIVOTED == pinv[r]) ? 0 : factor->starts[pinv[r]];
+          stack[depth++] = r;
+          done = false;
+          break;
+        }
+      }
+    }
+    if (done) {
+      depth--;
+      reach[--top] = i;
+    }
+  }
+  return top;
+}
+
+/* +1 or -1 according to the parity of the permutation's cycles. */
+static int permutation_sign(const size_t *perm, const size_t dim,
+                            bool *seen) {
+  int sign = 1;
+  memset(seen, 0, dim * sizeof(bool));
+  for (size_t i = 0; i < dim; i++) {
+    size_t length = 0;
+    for (size_t j = i; !seen[j]; j = perm[j]) {
+      seen[j] = true;
+      length++;
+    }
+    /* A cycle of length m is m - 1 transpositions. */
+    if (length && !(length % 2)) {
+      sign = -sign;
+    }
+  }
+  return sign;
+}
+
+/*
+ * sign and logabsdet as from slogdet_n().  If factor_nnz is not NULL, it is
+ * set to the number of nonzeros in L and U, the diagonal included once.
+ */
+int sparse_slogdet(const struct sparse_matrix *matrix,
+                   const enum sparse_ordering ordering, int *sign,
+                   double *logabsdet, size_t *factor_nnz) {
+  if (check_sparse(matrix) || !sign || !logabsdet) {
+    fprintf(stderr, "%s: sparse matrix or output.\n", strerror(EINVAL));
+    return -EINVAL;
+  }
+  const size_t dim = matrix->dim;
+  const size_t nnz = matrix->starts[dim];
+  if (!dim) {
+    *sign = 1;
+    *logabsdet = 0.0;
+    if (factor_nnz) {
+      *factor_nnz = 0;
+    }
+    return 0;
+  }
+  struct sparse_factor factor = {NULL, NULL, NULL, 0, nnz + dim};
+  struct magnitude product = {1.0, 0};
+  size_t *order = (size_t *)malloc(dim * sizeof(size_t));
+  size_t *pinv = (size_t *)malloc(dim * sizeof(size_t));
+  size_t *reach = (size_t *)malloc(dim * sizeof(size_t));
+  size_t *stack = (size_t *)malloc(dim * sizeof(size_t));
+  size_t *position = (size_t *)malloc(dim * sizeof(size_t));
+  size_t *visited = (size_t *)calloc(dim, sizeof(size_t));
+  double *x = (double *)calloc(dim, sizeof(double));
+  bool *seen = (bool *)malloc(dim * sizeof(bool));
+  size_t u_nnz = 0;
+  int ret = -ENOMEM;
+  factor.starts = (size_t *)malloc((dim + 1) * sizeof(size_t));
+  factor.rows = (size_t *)malloc(factor.cap * sizeof(size_t));
+  factor.values = (double *)malloc(factor.cap * sizeof(double));
+  if (!order || !pinv || !reach || !stack || !position || !visited || !x ||
+      !seen || !factor.starts || !factor.rows || !factor.values) {
+    goto out;
+  }
+  if (SPARSE_MINIMUM_DEGREE == ordering) {
+    ret = minimum_degree_order(matrix, order);
+    if (ret) {
+      goto out;
+    }
+  } else {
+    for (size_t j = 0; j < dim; j++) {
+      order[j] = j;
+    }
+  }
+  for (size_t i = 0; i < dim; i++) {
+    pinv[i] = UNPIVOTED;
+  }
+  *sign = 1;
+  *logabsdet = 0.0;
+  factor.starts[0] = 0;
+  for (size_t k = 0; k < dim; k++) {
+    const size_t column = order[k];
+    const size_t first = matrix->starts[column];
+    const size_t last = matrix->starts[column + 1];
+    size_t top = dim;
+    for (size_t p = first; p < last; p++) {
+      if (visited[matrix->indices[p]] != k + 1) {
+        top = reach_from(matrix->indices[p], top, &factor, pinv, reach, stack,
+                         position, visited, k + 1);
+      }
+    }
+    /* Duplicate entries are summed. */
+    for (size_t p = first; p < last; p++) {
+      x[matrix->indices[p]] += matrix->values[p];
+    }
+    /* Solve L x = A[:, column] over the reach, and find the largest entry. */
+    size_t pivot = UNPIVOTED;
+    double largest = 0.0;
+    for (size_t t = top; t < dim; t++) {
+      const size_t i = reach[t];
+      if (UNPIVOTED == pinv[i]) {
+        if (fabs(x[i]) > largest) {
+          largest = fabs(x[i]);
+          pivot = i;
+        }
+        continue;
+      }
+      u_nnz++;
+      for (size_t p = factor.starts[pinv[i]]; p < factor.starts[pinv[i] + 1];
+           p++) {
+        x[factor.rows[p]] -= factor.values[p] * x[i];
+      }
+    }
+    if (UNPIVOTED == pivot) {
+      *sign = 0;
+      *logabsdet = -INFINITY;
+      ret = 0;
+      goto out;
+    }
+    if ((visited[column] == k + 1) && (UNPIVOTED == pinv[column]) &&
+        (fabs(x[column]) >= SPARSE_PIVOT_TOLERANCE * largest)) {
+      pivot = column;
+    }
+    const double pivot_value = x[pivot];
+    pinv[pivot] = k;
+    u_nnz++;
+    scale_magnitude(&product, pivot_value);
+    if (pivot_value < 0.0) {
+      *sign = -*sign;
+    }
+    for (size_t t = top; t < dim; t++) {
+      const size_t i = reach[t];
+      if ((UNPIVOTED == pinv[i]) && (0.0 != x[i]) &&
+          !append_factor(&factor, i, x[i] / pivot_value)) {
+        goto out;
+      }
+      x[i] = 0.0;
+    }
+    factor.starts[k + 1] = factor.nnz;
+  }
+  *logabsdet = log_magnitude(&product);
+  /*
+   * P A Q = L U, so det(A) = det(P) det(Q) det(U), where row pinv[i] of P A
+   * is row i of A and column k of A Q is column order[k] of A.
+   */
+  *sign *= permutation_sign(pinv, dim, seen) *
+           permutation_sign(order, dim, seen);
+  ret = 0;
+out:
+  if (factor_nnz) {
+    *factor_nnz = factor.nnz + u_nnz;
+  }
+  free(order);
+  free(pinv);
+  free(reach);
+  free(stack);
+  free(position);
+  free(visited);
+  free(x);
+  free(seen);
+  free(factor.starts);
+  free(factor.rows);
+  free(factor.values);
+  return ret;
+}
+
+double sparse_determinant(const struct sparse_matrix *matrix) {
+  int sign;
+  double logabsdet;
+  if (sparse_slogdet(matrix, SPARSE_MINIMUM_DEGREE, &sign, &logabsdet, NULL)) {
+    return NAN;
+  }
+  return sign * exp(logabsdet);
+}
+
+/*
+ * Compute the determinants of count dim x dim matrices, where dim is 2, 3 or
+ * 4, given in structure-of-arrays form: element k, in row-major order, of
+ * matrix m is soa[(k * count) + m].  Consecutive matrices thereby occupy
+ * adjacent SIMD lanes.
+ */
+int determinant_batch(const double *soa, const size_t dim, const size_t count,
+                      double *dets) {
+  const struct simd_kernels *kernels = select_kernels();
+  if (!soa || !dets) {
+    fprintf(stderr, "%s: batch or output.\n", strerror(EINVAL));
+    return -EINVAL;
+  }
+  switch (dim) {
+  case 2:
+    kernels->batch_det2(soa, count, 0, dets);
+    break;
+  case 3:
+    kernels->batch_det3(soa, count, 0, dets);
+    break;
+  case 4:
+    kernels->batch_det4(soa, count, 0, dets);
+    break;
+  default:
+    fprintf(stderr, "%s: batches have dimension 2, 3 or 4.\n",
+            strerror(EINVAL));
+    return -EINVAL;
+  }
+  return 0;
+}
+
+static_assert(sizeof(struct matrix_file_header) == MATRIX_FILE_ALIGNMENT,
+              "The data of a matrix file starts on a cache line.");
+
+static size_t dtype_size(const uint32_t dtype) {
+  switch (dtype) {
+  case MATRIX_FLOAT64:
+    return sizeof(double);
+  case MATRIX_INT64:
+    return sizeof(int64_t);
+  default:
+    return 0;
+  }
+}
+
+/*
+ * Write rows x cols elements, whose rows start stride elements apart, after
+ * a header, with the rows packed in the file.
+ */
+int write_matrix_file(const char *path, const void *data,
+                      const enum matrix_dtype dtype, const size_t rows,
+                      const size_t cols, const size_t stride) {
+  const size_t element = dtype_size(dtype);
+  struct matrix_file_header header;
+  int ret = 0;
+  if (!path || !data || !element || (stride < cols)) {
+    fprintf(stderr, "%s: path, data, type or stride.\n", strerror(EINVAL));
+    return -EINVAL;
+  }
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, MATRIX_FILE_MAGIC, sizeof(header.magic));
+  header.byte_order = MATRIX_FILE_BYTE_ORDER;
+  header.dtype = dtype;
+  header.layout = MATRIX_ROW_MAJOR;
+  header.rows = rows;
+  header.cols = cols;
+  header.stride = cols;
+  header.data_offset = sizeof(header);
+  FILE *file = fopen(path, "w");
+  if (!file) {
+    ret = -errno;
+    perror(path);
+    return ret;
+  }
+  if (1 != fwrite(&header, sizeof(header), 1, file)) {
+    ret = -EIO;
+  }
+  for (size_t i = 0; !ret && (i < rows); i++) {
+    const char *row = (const char *)data + (i * stride * element);
+    if (cols != fwrite(row, element, cols, file)) {
+      ret = -EIO;
+    }
+  }
+  if (fclose(file) && !ret) {
+    ret = -EIO;
+  }
+  if (ret) {
+    perror(path);
+  }
+  return ret;
+}
+
+/*
+ * Map the file read-only and copy-on-write, so that the matrix is used where
+ * the page cache holds it, with nothing parsed or copied beforehand.
+ */
+int map_matrix_file(const char *path, struct mapped_matrix *matrix) {
+  struct stat status;
+  int ret = 0;
+  if (!path || !matrix) {
+    fprintf(stderr, "%s: path or matrix.\n", strerror(EINVAL));
+    return -EINVAL;
+  }
+  memset(matrix, 0, sizeof(*matrix));
+  const int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    ret = -errno;
+    perror(path);
+    return ret;
+  }
+  if (fstat(fd, &status)) {
+    ret = -errno;
+    perror(path);
+    close(fd);
+    return ret;
+  }
+  if ((size_t)status.st_size < sizeof(struct matrix_file_header)) {
+    fprintf(stderr, "%s: %s is too short for a matrix file.\n",
+            strerror(EINVAL), path);
+    close(fd);
+    return -EINVAL;
+  }
+  void *map = mmap(NULL, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  /* The mapping holds its own reference to the file. */
+  close(fd);
+  if (MAP_FAILED == map) {
+    ret = -errno;
+    perror(path);
+    return ret;
+  }
+  matrix->map = map;
+  matrix->map_size = status.st_size;
+  const struct matrix_file_header *header =
+      (const struct matrix_file_header *)map;
+  const size_t element = dtype_size(header->dtype);
+  size_t extent, bytes;
+  /* The last row need not be padded out to the stride. */
+  if (memcmp(header->magic, MATRIX_FILE_MAGIC, sizeof(header->magic)) ||
+      (MATRIX_FILE_BYTE_ORDER != header->byte_order) || !element ||
+      (header->layout > MATRIX_COLUMN_MAJOR) ||
+      (header->data_offset < sizeof(*header)) ||
+      (header->data_offset > matrix->map_size) ||
+      (header->data_offset % MATRIX_FILE_ALIGNMENT)) {
+    ret = -EINVAL;
+  } else {
+    const uint64_t outer = (MATRIX_ROW_MAJOR == header->layout)
+                               ? header->rows
+                               : header->cols;
+    const uint64_t inner = (MATRIX_ROW_MAJOR == header->layout)
+                               ? header->cols
+                               : header->rows;
+    if ((header->stride < inner) ||
+        (outer && (__builtin_mul_overflow(outer - 1, header->stride,
+                                          &extent) ||
+                   __builtin_add_overflow(extent, inner, &extent) ||
+                   __builtin_mul_overflow(extent, element, &bytes) ||
+                   (bytes > matrix->map_size - header->data_offset)))) {
+      ret = -EINVAL;
+    }
+  }
+  if (ret) {
+    fprintf(stderr, "%s: %s has a bad header or is truncated.\n",
+            strerror(EINVAL), path);
+    unmap_matrix_file(matrix);
+    return ret;
+  }
+  /*
+   * The factorization sweeps the trailing rows again at every step, so the
+   * whole matrix is wanted, not a readahead window: start reading it now.
+   */
+  madvise(map, matrix->map_size, MADV_WILLNEED);
+  matrix->header = header;
+  matrix->data = (const char *)map + header->data_offset;
+  return 0;
+}
+
+void unmap_matrix_file(struct mapped_matrix *matrix) {
+  if (!matrix) {
+    return;
+  }
+  if (matrix->map) {
+    munmap(matrix->map, matrix->map_size);
+  }
+  memset(matrix, 0, sizeof(*matrix));
+}
+
+/*
+ * Factor a floating-point mapping where it lies.  Being private, the mapping
+ * can be made writable, and the pages the factorization writes are copied by
+ * the kernel one at a time rather than all up front.  Discarding them
+ * afterwards reverts the mapping to the file for the next caller.  Returns
+ * -errno, with the mapping untouched, if it cannot be made writable.
+ */
+static int factor_mapping(struct mapped_matrix *matrix,
+                          const size_t dim, double *det) {
+  if (mprotect(matrix->map, matrix->map_size, PROT_READ | PROT_WRITE)) {
+    return -errno;
+  }
+  *det = determinant_lu((double *)matrix->data, dim, matrix->header->stride);
+  /* The factors are all that is left, so no determinant can be trusted. */
+  if (madvise(matrix->map, matrix->map_size, MADV_DONTNEED)) {
+    perror("madvise");
+    *det = NAN;
+  }
+  mprotect(matrix->map, matrix->map_size, PROT_READ);
+  return 0;
+}
+
+/*
+ * The determinant of a square mapped matrix.  A column-major matrix is read
+ * as its transpose, which has the same determinant.  Integer matrices are
+ * exact, and give NAN if the determinant does not fit in 64 bits.
+ * Floating-point matrices larger than SIZE are factored in the mapping, which
+ * is restored before returning but must not be read meanwhile, from another
+ * thread or otherwise.
+ */
+double mapped_determinant(struct mapped_matrix *matrix) {
+  if (!matrix || !matrix->header ||
+      (matrix->header->rows != matrix->header->cols)) {
+    fprintf(stderr, "%s: unmapped or non-square matrix.\n",
+            strerror(EINVAL));
+    return NAN;
+  }
+  const size_t dim = matrix->header->rows;
+  if (MATRIX_INT64 == matrix->header->dtype) {
+    int64_t det;
+    if (determinant_int64((const int64_t *)matrix->data, dim,
+                          matrix->header->stride, &det)) {
+      return NAN;
+    }
+    return (double)det;
+  }
+  double det = NAN;
+  /* The closed forms read the mapping without copying it. */
+  if ((dim > SIZE) && !factor_mapping(matrix, dim, &det)) {
+    return det;
+  }
+  return determinant_n((const double *)matrix->data, dim,
+                       matrix->header->stride);
+}
+
+// Compare two row or column vectors for equality, returning TRUE if they are
+// empty.
+bool vector_are_equal(const double *mat1, const double *mat2, size_t len) {
+  return select_kernels()->are_equal(mat1, mat2, len);
+}
+
+// The kernels take const pointers, so this is now the same as the above.
+bool const_vector_are_equal(const double *const mat1, const double *const mat2,
+                            size_t len) {
+  return select_kernels()->are_equal(mat1, mat2, len);
+}
+
+bool square_are_equal(const double (*mat1)[SIZE], const double (*mat2)[SIZE]) {
+  /*
+Fails to have intended effect since the function receives a SIZExSIZE object no
+matter what is is passed.
+clang-format off
+  if ((SIZE*SIZE != (sizeof(mat1)/sizeof(double))) || (SIZE*SIZE !=
+(sizeof(mat2)/sizeof(double)))) { return false;
+  }
+clang-format on
+  */
+  /* The rows of a 2D array are contiguous. */
+  return select_kernels()->are_equal(&mat1[0][0], &mat2[0][0], SIZE * SIZE);
+}
+
+bool vector_are_close(const double *mat1, const double *mat2, size_t len,
+                      const double abs_tol, const uint64_t max_ulps) {
+  return select_kernels()->are_close(mat1, mat2, len, abs_tol, max_ulps);
+}
+
+/* The round and final avalanche of xxHash64. */
+#define HASH_PRIME1 0x9e3779b185ebca87ULL
+#define HASH_PRIME2 0xc2b2ae3d27d4eb4fULL
+#define HASH_PRIME3 0x165667b19e3779f9ULL
+
+static uint64_t hash_round(const uint64_t accumulator, const uint64_t input) {
+  const uint64_t mixed = accumulator + (input * HASH_PRIME2);
+  return ((mixed << 31) | (mixed >> 33)) * HASH_PRIME1;
+}
+
+/*
+ * -0.0 is hashed as 0.0, since the two are equal.  Testing the bits rather
+ * than the value avoids a floating-point comparison and branch.
+ */
+static uint64_t hash_input(const double x) {
+  uint64_t bits;
+  memcpy(&bits, &x, sizeof(bits));
+  return (bits & MAGNITUDE_BITS) ? bits : 0;
+}
+
+/*
+ * Four independent accumulators, so that successive multiplications need
+ * not wait for each other.  They are separate variables rather than an
+ * array, which the compiler keeps in memory.
+ */
+uint64_t vector_hash(const double *vec, size_t len) {
+  uint64_t a0 = HASH_PRIME1 + HASH_PRIME2, a1 = HASH_PRIME2, a2 = 0;
+  uint64_t a3 = HASH_PRIME3;
+  uint64_t hash = len * HASH_PRIME1;
+  size_t j = 0;
+  for (; j + 4 <= len; j += 4) {
+    a0 = hash_round(a0, hash_input(vec[j]));
+    a1 = hash_round(a1, hash_input(vec[j + 1]));
+    a2 = hash_round(a2, hash_input(vec[j + 2]));
+    a3 = hash_round(a3, hash_input(vec[j + 3]));
+  }
+  for (; j < len; j++) {
+    a0 = hash_round(a0, hash_input(vec[j]));
+  }
+  hash = (hash ^ hash_round(0, a0)) * HASH_PRIME1;
+  hash = (hash ^ hash_round(0, a1)) * HASH_PRIME1;
+  hash = (hash ^ hash_round(0, a2)) * HASH_PRIME1;
+  hash = (hash ^ hash_round(0, a3)) * HASH_PRIME1;
+  hash ^= hash >> 33;
+  hash *= HASH_PRIME2;
+  hash ^= hash >> 29;
+  hash *= HASH_PRIME3;
+  return hash ^ (hash >> 32);
+}
+
+void make_matrix_key(struct matrix_key *key, const double *data,
+                     const size_t len) {
+  key->data = data;
+  key->len = len;
+  key->hash = vector_hash(data, len);
+}
+
+/* Different hashes mean unequal contents, without reading them. */
+bool matrix_keys_are_equal(const struct matrix_key *key1,
+                           const struct matrix_key *key2) {
+  if ((key1->len != key2->len) || (key1->hash != key2->hash)) {
+    return false;
+  }
+  return vector_are_equal(key1->data, key2->data, key1->len);
+}
+
+#ifndef TESTING
+
+/* det = 0*(4*8 - 4*14)  - 2*(6*8 - 6*10) + 2*(6*14 - 4*6) = 24 + 120 = 144
+ *
+ * Given matrix files, print the determinant of each instead.
+ */
+int main(int argc, char **argv) {
+  const double test_matrix[SIZE][SIZE] = {
+      {0.0, 2.0, 2.0}, {6.0, 4.0, 10.0}, {6.0, 14.0, 8.0}};
+  int ret = EXIT_SUCCESS;
+
+  assert(144.0 == determinant(test_matrix));
+  for (int i = 1; i < argc; i++) {
+    struct mapped_matrix matrix;
+    if (map_matrix_file(argv[i], &matrix)) {
+      ret = EXIT_FAILURE;
+      continue;
+    }
+    printf("%s: %.17g\n", argv[i], mapped_determinant(&matrix));
+    unmap_matrix_file(&matrix);
+  }
+  exit(ret);
 }
 
 #endif
@@ -0,0 +1,349 @@
+/*
+ * Speed and accuracy of each determinant path on random, Hilbert, diagonally
+ * dominant and sparse matrices from 4 to 256 rows.  Errors are relative to
+ * the determinant of the same double matrix computed by LU with partial
+ * pivoting in binary128 (or long double where the compiler has no
+ * __float128), so that a faster path which loses digits shows up beside its
+ * timing.  Hilbert matrices are singular to double precision from about 12
+ * rows, and their errors are expected to be large.  The errors of the paths
+ * which return log|det| are resolved only to about 1e-16 times log|det|.
+ *
+ * Usage: matrix-determinant_accuracy [largest size] [random|hilbert|dominant|
+ *                                    sparse]
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define TESTING
+
+#include "matrix-determinant.c"
+
+#ifdef __SIZEOF_FLOAT128__
+typedef __float128 reference_t;
+#define REFERENCE_NAME "binary128"
+#else
+typedef long double reference_t;
+#define REFERENCE_NAME "long double"
+#endif
+
+/* Timed repetitions stop after about this much LU arithmetic, or 1000. */
+#define FLOPS_PER_PATH 2e7
+#define MAX_REPETITIONS 1000
+/* The largest size, at which each reference takes about a second. */
+#define ACCURACY_LARGEST 256
+/* Off-diagonal entries per row of the sparse matrices, on average */
+#define SPARSE_ROW_ENTRIES 3
+
+enum matrix_kind { RANDOM, HILBERT, DOMINANT, SPARSE };
+static const char *kind_names[] = {"random", "hilbert", "dominant", "sparse"};
+
+enum path {
+  DETERMINANT_N,
+  PARALLEL,
+  SLOGDET,
+  HANDLE,
+  MIXED,
+  SINGLE,
+  SPARSE_LU,
+  PATHS
+};
+static const char *path_names[] = {"determinant_n", "parallel (2)",
+                                   "slogdet_n",     "lu_determinant",
+                                   "slogdet_mixed", "determinant_float",
+                                   "sparse_slogdet"};
+
+/* |det| = mantissa * 2^exponent, with the mantissa in [1, 2^32). */
+struct reference {
+  int sign;
+  reference_t mantissa;
+  long exponent;
+};
+
+/* The same matrix in the forms which the paths take */
+struct path_inputs {
+  const double *matrix;
+  const float *rounded;
+  const struct sparse_matrix *sparse;
+  struct lu_factorization *lu;
+  size_t dim;
+};
+
+static double elapsed_ns(const struct timespec *start,
+                         const struct timespec *end) {
+  return ((end->tv_sec - start->tv_sec) * 1e9) +
+         (double)(end->tv_nsec - start->tv_nsec);
+}
+
+static void fill_matrix(double *matrix, const size_t dim,
+                        const enum matrix_kind kind) {
+  for (size_t i = 0; i < dim; i++) {
+    double *row = matrix + (i * dim);
+    double off_diagonal = 0.0;
+    for (size_t j = 0; j < dim; j++) {
+      switch (kind) {
+      case RANDOM:
+      case DOMINANT:
+        row[j] = (2.0 * drand48()) - 1.0;
+        break;
+      case HILBERT:
+        row[j] = 1.0 / (double)(i + j + 1);
+        break;
+      case SPARSE:
+        row[j] = (drand48() * dim < SPARSE_ROW_ENTRIES)
+                     ? (2.0 * drand48()) - 1.0
+                     : 0.0;
+        break;
+      }
+      if (i != j) {
+        off_diagonal += fabs(row[j]);
+      }
+    }
+    if (DOMINANT == kind) {
+      row[i] = off_diagonal + 1.0;
+    } else if (SPARSE == kind) {
+      row[i] = 4.0;
+    }
+  }
+}
+
+/* The nonzeros of the dense matrix, by row, which sparse_slogdet() accepts. */
+static void compress(const double *matrix, const size_t dim, size_t *starts,
+                     size_t *indices, double *values) {
+  size_t nnz = 0;
+  starts[0] = 0;
+  for (size_t i = 0; i < dim; i++) {
+    for (size_t j = 0; j < dim; j++) {
+      if (0.0 != matrix[(i * dim) + j]) {
+        indices[nnz] = j;
+        values[nnz++] = matrix[(i * dim) + j];
+      }
+    }
+    starts[i + 1] = nnz;
+  }
+}
+
+static reference_t reference_abs(const reference_t x) {
+  return (x < 0) ? -x : x;
+}
+
+/* Gaussian elimination with partial pivoting, in the reference precision. */
+static struct reference reference_determinant(const double *matrix,
+                                              const size_t dim) {
+  const reference_t scale = (reference_t)4294967296.0;
+  struct reference ref = {1, 1, 0};
+  reference_t *work =
+      (reference_t *)malloc(dim * dim * sizeof(reference_t));
+  if (!work) {
+    perror("malloc");
+    exit(EXIT_FAILURE);
+  }
+  for (size_t k = 0; k < dim * dim; k++) {
+    work[k] = matrix[k];
+  }
+  for (size_t k = 0; k < dim; k++) {
+    size_t pivot = k;
+    for (size_t i = k + 1; i < dim; i++) {
+      if (reference_abs(work[(i * dim) + k]) >
+          reference_abs(work[(pivot * dim) + k])) {
+        pivot = i;
+      }
+    }
+    if (0 == work[(pivot * dim) + k]) {
+      ref.sign = 0;
+      break;
+    }
+    if (pivot != k) {
+      for (size_t j = 0; j < dim; j++) {
+        const reference_t saved = work[(k * dim) + j];
+        work[(k * dim) + j] = work[(pivot * dim) + j];
+        work[(pivot * dim) + j] = saved;
+      }
+      ref.sign = -ref.sign;
+    }
+    const reference_t *pivot_row = work + (k * dim);
+    for (size_t i = k + 1; i < dim; i++) {
+      reference_t *row = work + (i * dim);
+      const reference_t multiplier = row[k] / pivot_row[k];
+      for (size_t j = k + 1; j < dim; j++) {
+        row[j] -= multiplier * pivot_row[j];
+      }
+    }
+    if (pivot_row[k] < 0) {
+      ref.sign = -ref.sign;
+    }
+    /* Scaling by powers of 2 is exact. */
+    ref.mantissa *= reference_abs(pivot_row[k]);
+    while (ref.mantissa >= scale) {
+      ref.mantissa /= scale;
+      ref.exponent += 32;
+    }
+    while (ref.mantissa < 1) {
+      ref.mantissa *= scale;
+      ref.exponent -= 32;
+    }
+  }
+  free(work);
+  return ref;
+}
+
+static double reference_log(const struct reference *ref) {
+  return log((double)ref->mantissa) + ((double)ref->exponent * M_LN2);
+}
+
+/*
+ * Where the reference is within the range of double, the error is computed
+ * in the reference precision, and otherwise from the logarithms.
+ */
+static double relative_error(const struct reference *ref, const double det) {
+  if (!ref->sign) {
+    return (0.0 == det) ? 0.0 : INFINITY;
+  }
+  if (labs(ref->exponent) < 960) {
+    const reference_t exact =
+        (reference_t)ref->sign * ref->mantissa *
+        (reference_t)ldexp(1.0, (int)ref->exponent);
+    return fabs((double)((det - exact) / exact));
+  }
+  if ((0.0 == det) || isinf(det) || ((det < 0.0) != (ref->sign < 0))) {
+    return INFINITY;
+  }
+  return fabs(expm1(log(fabs(det)) - reference_log(ref)));
+}
+
+static double log_error(const struct reference *ref, const int sign,
+                        const double logabsdet) {
+  if (sign != ref->sign) {
+    return INFINITY;
+  }
+  if (!sign) {
+    return 0.0;
+  }
+  return fabs(expm1(logabsdet - reference_log(ref)));
+}
+
+/* Paths return either the determinant or its sign and logarithm. */
+struct path_result {
+  bool logarithmic;
+  double det;
+  int sign;
+  double logabsdet;
+};
+
+static struct path_result run_path(const enum path path,
+                                   const struct path_inputs *in) {
+  struct path_result result = {true, NAN, 0, NAN};
+  switch (path) {
+  case DETERMINANT_N:
+    result.det = determinant_n(in->matrix, in->dim, in->dim);
+    break;
+  case PARALLEL:
+    result.det = determinant_n_parallel(in->matrix, in->dim, in->dim, 2);
+    break;
+  case SLOGDET:
+    slogdet_n(in->matrix, in->dim, in->dim, 1, &result.sign,
+              &result.logabsdet);
+    return result;
+  case HANDLE:
+    lu_factorize(in->lu, in->matrix, in->dim);
+    result.det = lu_determinant(in->lu);
+    break;
+  case MIXED:
+    slogdet_mixed(in->matrix, in->dim, in->dim, &result.sign,
+                  &result.logabsdet);
+    return result;
+  case SINGLE:
+    result.det = determinant_float(in->rounded, in->dim, in->dim);
+    break;
+  case SPARSE_LU:
+    sparse_slogdet(in->sparse, SPARSE_MINIMUM_DEGREE, &result.sign,
+                   &result.logabsdet, NULL);
+    return result;
+  case PATHS:
+    break;
+  }
+  result.logarithmic = false;
+  return result;
+}
+
+static void measure(const enum matrix_kind kind, const size_t dim) {
+  const double flops = (2.0 / 3.0) * (double)dim * (double)dim * (double)dim;
+  const size_t reps = (FLOPS_PER_PATH / flops > MAX_REPETITIONS)
+                          ? MAX_REPETITIONS
+                          : (size_t)(FLOPS_PER_PATH / flops) + 1;
+  double *matrix = (double *)malloc(dim * dim * sizeof(double));
+  float *rounded = (float *)malloc(dim * dim * sizeof(float));
+  size_t *starts = (size_t *)malloc((dim + 1) * sizeof(size_t));
+  size_t *indices = (size_t *)malloc(dim * dim * sizeof(size_t));
+  double *values = (double *)malloc(dim * dim * sizeof(double));
+  struct lu_factorization lu;
+  if (!matrix || !rounded || !starts || !indices || !values ||
+      initialize_lu(&lu, dim)) {
+    perror("malloc");
+    exit(EXIT_FAILURE);
+  }
+  fill_matrix(matrix, dim, kind);
+  for (size_t k = 0; k < dim * dim; k++) {
+    rounded[k] = (float)matrix[k];
+  }
+  compress(matrix, dim, starts, indices, values);
+  const struct sparse_matrix sparse = {dim, starts, indices, values};
+  const struct path_inputs in = {matrix, rounded, &sparse, &lu, dim};
+  const struct reference ref = reference_determinant(matrix, dim);
+  const double log10_det = ref.sign ? reference_log(&ref) / M_LN10 : -INFINITY;
+  for (size_t p = 0; p < PATHS; p++) {
+    struct path_result result = {};
+    double best = INFINITY;
+    for (size_t r = 0; r < reps; r++) {
+      struct timespec start, end;
+      clock_gettime(CLOCK_MONOTONIC, &start);
+      result = run_path((enum path)p, &in);
+      clock_gettime(CLOCK_MONOTONIC, &end);
+      best = fmin(best, elapsed_ns(&start, &end));
+    }
+    const double error =
+        result.logarithmic
+            ? log_error(&ref, result.sign, result.logabsdet)
+            : relative_error(&ref, result.det);
+    printf("%9s %5lu %11.1f %18s %10.4f %10.1e\n", kind_names[kind], dim,
+           log10_det, path_names[p], best / 1e6, error);
+  }
+  release_lu_resources(&lu);
+  free(matrix);
+  free(rounded);
+  free(starts);
+  free(indices);
+  free(values);
+}
+
+int main(int argc, char **argv) {
+  const size_t largest =
+      (argc > 1) ? strtoul(argv[1], NULL, 10) : ACCURACY_LARGEST;
+  int only = -1;
+  if (argc > 2) {
+    for (size_t k = RANDOM; k <= SPARSE; k++) {
+      if (!strcmp(argv[2], kind_names[k])) {
+        only = (int)k;
+      }
+    }
+    if (only < 0) {
+      fprintf(stderr, "Unknown matrix kind %s.\n", argv[2]);
+      exit(EXIT_FAILURE);
+    }
+  }
+  srand48(1);
+  printf("Determinants against a %s reference, ms and relative error\n",
+         REFERENCE_NAME);
+  printf("%9s %5s %11s %18s %10s %10s\n", "matrix", "n", "log10|det|",
+         "path", "ms", "error");
+  for (size_t kind = RANDOM; kind <= SPARSE; kind++) {
+    if ((only >= 0) && ((size_t)only != kind)) {
+      continue;
+    }
+    for (size_t dim = 4; dim <= largest; dim *= 2) {
+      measure((enum matrix_kind)kind, dim);
+    }
+  }
+  exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,927 @@
+/*
+ * Benchmarks, in order:
+ *  - determinant_n() and slogdet_n() on random matrices from 3 to 2048 rows;
+ *  - the unblocked and blocked LU factorizations from 256 to 4096 rows, with
+ *    cache-miss counts when perf events are available, and the blocked one
+ *    with scalar kernels;
+ *  - the parallel factorization of the largest size with 1, 2, 4, ...
+ *    threads, up to the number of online CPUs;
+ *  - batched 2x2, 3x3 and 4x4 determinants, and the same sizes one at a time
+ *    with determinant_n() and the compile-time templates;
+ *  - cofactor matrices from copied minors and from cofactor_matrix();
+ *  - exact and tolerant comparisons of matrices which differ in their last
+ *    element, with scalar and SIMD kernels, and by cached hashes;
+ *  - exact integer determinants of adjacency matrices against floating point;
+ *  - determinants tracked through row replacements against recomputation;
+ *  - solutions for many right-hand sides from one cached factorization;
+ *  - block determinants from a cached factorization of the leading three
+ *    quarters, or of a diagonal leading block, against whole determinants;
+ *  - loading a matrix file by mapping it and by reading it;
+ *  - the double, mixed and single-precision LU from 64 to 2048 rows, with
+ *    the error of the latter two;
+ *  - sparse LU of banded, random and arrow matrices with up to 10^6 rows, in
+ *    the natural and in minimum-degree column order.
+ * Each LU size is repeated until roughly the same amount of arithmetic has
+ * been done, and the fastest repetition is reported.
+ *
+ * Usage: matrix-determinant_benchmark [largest size] [LU block size]
+ *                                     [largest sparse size]
+ */
+#include <linux/perf_event.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#define TESTING
+
+#include "matrix-determinant.c"
+#include "matrix-determinant-template.h"
+
+/* About (2/3)n^3 floating-point operations per LU factorization. */
+#define FLOPS_PER_SIZE 2e8
+
+static double elapsed_ns(const struct timespec *start,
+                         const struct timespec *end) {
+  return ((end->tv_sec - start->tv_sec) * 1e9) +
+         (double)(end->tv_nsec - start->tv_nsec);
+}
+
+static void fill_random(double *matrix, const size_t dim) {
+  for (size_t i = 0; i < dim * dim; i++) {
+    matrix[i] = (2.0 * drand48()) - 1.0;
+  }
+}
+
+static double lu_flops(const size_t dim) {
+  return (2.0 / 3.0) * (double)dim * (double)dim * (double)dim;
+}
+
+static size_t repetitions(const size_t dim) {
+  const size_t reps = (size_t)(FLOPS_PER_SIZE / lu_flops(dim));
+  return reps ? reps : 1;
+}
+
+/* Returns -1 if the kernel or the sandbox does not allow perf events. */
+static int open_counter(const uint32_t type, const uint64_t config) {
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.type = type;
+  attr.size = sizeof(attr);
+  attr.config = config;
+  attr.disabled = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  return (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static void start_counter(const int fd) {
+  if (fd >= 0) {
+    ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+    ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+  }
+}
+
+static long long stop_counter(const int fd) {
+  long long count = -1;
+  if (fd >= 0) {
+    ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+    if (sizeof(count) != read(fd, &count, sizeof(count))) {
+      count = -1;
+    }
+  }
+  return count;
+}
+
+struct lu_result {
+  double ns;
+  long long l1_misses;
+  long long llc_misses;
+};
+
+/* Factor copies of source with block columns, or unblocked if block is 0. */
+static struct lu_result time_lu(const double *source, double *work,
+                                const size_t dim, const size_t block,
+                                const int l1_fd, const int llc_fd) {
+  struct lu_result best = {0.0, -1, -1};
+  const size_t reps = repetitions(dim);
+  for (size_t r = 0; r < reps; r++) {
+    struct timespec start, end;
+    int sign;
+    memcpy(work, source, dim * dim * sizeof(double));
+    start_counter(l1_fd);
+    start_counter(llc_fd);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (block) {
+      lu_factor_blocked(work, dim, dim, block, NULL, &sign);
+    } else {
+      lu_factor(work, dim, dim, NULL, &sign);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    const long long l1_misses = stop_counter(l1_fd);
+    const long long llc_misses = stop_counter(llc_fd);
+    const double ns = elapsed_ns(&start, &end);
+    if (!r || (ns < best.ns)) {
+      best.ns = ns;
+      best.l1_misses = l1_misses;
+      best.llc_misses = llc_misses;
+    }
+  }
+  return best;
+}
+
+static void compare_blocking(const size_t largest, const size_t block) {
+  const int l1_fd = open_counter(
+      PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D |
+                              (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                              (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+  const int llc_fd =
+      open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+  printf("\nUnblocked vs. blocked LU, block size %lu%s\n", block,
+         ((l1_fd < 0) || (llc_fd < 0)) ? " (perf events unavailable)" : "");
+  printf("%6s %10s %14s %14s %10s %14s %14s %10s\n", "n", "GFLOP/s",
+         "L1D misses", "LLC misses", "GFLOP/s", "L1D misses", "LLC misses",
+         "scalar");
+  for (size_t dim = 256; dim <= largest; dim *= 2) {
+    double *source = (double *)malloc(dim * dim * sizeof(double));
+    double *work = (double *)malloc(dim * dim * sizeof(double));
+    if (!source || !work) {
+      perror("malloc");
+      exit(EXIT_FAILURE);
+    }
+    fill_random(source, dim);
+    const struct lu_result plain =
+        time_lu(source, work, dim, 0, l1_fd, llc_fd);
+    const struct lu_result tiled =
+        time_lu(source, work, dim, block, l1_fd, llc_fd);
+    force_scalar_kernels = true;
+    const struct lu_result scalar = time_lu(source, work, dim, block, -1, -1);
+    force_scalar_kernels = false;
+    printf("%6lu %10.2f %14lld %14lld %10.2f %14lld %14lld %10.2f\n", dim,
+           lu_flops(dim) / plain.ns, plain.l1_misses, plain.llc_misses,
+           lu_flops(dim) / tiled.ns, tiled.l1_misses, tiled.llc_misses,
+           lu_flops(dim) / scalar.ns);
+    free(source);
+    free(work);
+  }
+  if (l1_fd >= 0) {
+    close(l1_fd);
+  }
+  if (llc_fd >= 0) {
+    close(llc_fd);
+  }
+}
+
+static void compare_threads(const size_t dim, const size_t block) {
+  const long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  const size_t max_threads = (cpus > 0) ? (size_t)cpus : 1;
+  double *source = (double *)malloc(dim * dim * sizeof(double));
+  double *work = (double *)malloc(dim * dim * sizeof(double));
+  double single = 0.0;
+  if (!source || !work) {
+    perror("malloc");
+    exit(EXIT_FAILURE);
+  }
+  fill_random(source, dim);
+  printf("\nParallel blocked LU, n = %lu, %lu CPUs\n", dim, max_threads);
+  printf("%8s %10s %10s\n", "threads", "GFLOP/s", "speedup");
+  for (size_t threads = 1;; threads *= 2) {
+    struct timespec start, end;
+    if (threads > max_threads) {
+      threads = max_threads;
+    }
+    int sign;
+    memcpy(work, source, dim * dim * sizeof(double));
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    lu_factor_parallel(work, dim, dim, block, threads, NULL, &sign);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    const double ns = elapsed_ns(&start, &end);
+    if (1 == threads) {
+      single = ns;
+    }
+    printf("%8lu %10.2f %10.2f\n", threads, lu_flops(dim) / ns, single / ns);
+    if (threads == max_threads) {
+      break;
+    }
+  }
+  free(source);
+  free(work);
+}
+
+/* About a million small matrices, so that the batch does not fit in cache. */
+#define BATCH_COUNT (1UL << 20)
+
+static void compare_batches(void) {
+  printf("\nSmall-matrix determinants per second (millions)\n");
+  printf("%4s %12s %12s %12s\n", "n", "one by one", "batch scalar",
+         "batch");
+  for (size_t dim = 2; dim <= 4; dim++) {
+    const size_t elements = BATCH_COUNT * dim * dim;
+    double *matrices = (double *)malloc(elements * sizeof(double));
+    double *soa = (double *)malloc(elements * sizeof(double));
+    double *dets = (double *)malloc(BATCH_COUNT * sizeof(double));
+    struct timespec start, end;
+    double rates[3];
+    if (!matrices || !soa || !dets) {
+      perror("malloc");
+      exit(EXIT_FAILURE);
+    }
+    for (size_t i = 0; i < elements; i++) {
+      matrices[i] = (2.0 * drand48()) - 1.0;
+    }
+    for (size_t m = 0; m < BATCH_COUNT; m++) {
+      for (size_t k = 0; k < dim * dim; k++) {
+        soa[(k * BATCH_COUNT) + m] = matrices[(m * dim * dim) + k];
+      }
+    }
+    /* The 3x3 case calls the original cofactor determinant(). */
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (size_t m = 0; m < BATCH_COUNT; m++) {
+      const double *matrix = matrices + (m * dim * dim);
+      dets[m] = (SIZE == dim)
+                    ? determinant((const double(*)[SIZE])matrix)
+                    : determinant_n(matrix, dim, dim);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    rates[0] = BATCH_COUNT / elapsed_ns(&start, &end);
+    for (size_t simd = 0; simd < 2; simd++) {
+      force_scalar_kernels = !simd;
+      clock_gettime(CLOCK_MONOTONIC, &start);
+      determinant_batch(soa, dim, BATCH_COUNT, dets);
+      clock_gettime(CLOCK_MONOTONIC, &end);
+      rates[1 + simd] = BATCH_COUNT / elapsed_ns(&start, &end);
+    }
+    force_scalar_kernels = false;
+    /* Per nanosecond times 1000 is millions per second. */
+    printf("%4lu %12.1f %12.1f %12.1f\n", dim, 1000.0 * rates[0],
+           1000.0 * rates[1], 1000.0 * rates[2]);
+    free(matrices);
+    free(soa);
+    free(dets);
+  }
+}
+
+/*
+ * Compare the runtime-sized path with the template on matrices of N rows,
+ * stored contiguously so that the loop adds no indexing of its own.
+ */
+template <size_t N> static void compare_fixed_size(void) {
+  double(*matrices)[N][N] =
+      (double(*)[N][N])malloc(BATCH_COUNT * sizeof(double[N][N]));
+  double *dets = (double *)malloc(BATCH_COUNT * sizeof(double));
+  struct timespec start, end;
+  double rates[2];
+  if (!matrices || !dets) {
+    perror("malloc");
+    exit(EXIT_FAILURE);
+  }
+  for (size_t i = 0; i < BATCH_COUNT * N * N; i++) {
+    (&matrices[0][0][0])[i] = (2.0 * drand48()) - 1.0;
+  }
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (size_t m = 0; m < BATCH_COUNT; m++) {
+    dets[m] = determinant_n(&matrices[m][0][0], N, N);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  rates[0] = BATCH_COUNT / elapsed_ns(&start, &end);
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (size_t m = 0; m < BATCH_COUNT; m++) {
+    dets[m] = matrix::determinant(matrices[m]);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  rates[1] = BATCH_COUNT / elapsed_ns(&start, &end);
+  printf("%4lu %14.1f %14.1f\n", N, 1000.0 * rates[0], 1000.0 * rates[1]);
+  free(matrices);
+  free(dets);
+}
+
+static void compare_templates(void) {
+  printf("\nRuntime vs. compile-time sizes, determinants per second "
+         "(millions)\n");
+  printf("%4s %14s %14s\n", "n", "determinant_n", "template");
+  compare_fixed_size<2>();
+  compare_fixed_size<3>();
+  compare_fixed_size<4>();
+}
+
+/* The cofactor matrix as it would be computed with per-minor copies. */
+static void copied_cofactors(const double *matrix, const size_t dim,
+                             double *minor, double *cofactors) {
+  for (size_t r = 0; r < dim; r++) {
+    for (size_t c = 0; c < dim; c++) {
+      size_t k = 0;
+      for (size_t i = 0; i < dim; i++) {
+        for (size_t j = 0; j < dim; j++) {
+          if ((r != i) && (c != j)) {
+            minor[k++] = matrix[(i * dim) + j];
+          }
+        }
+      }
+      const double sign = ((r + c) % 2) ? -1.0 : 1.0;
+      cofactors[(r * dim) + c] = sign * determinant_n(minor, dim - 1, dim - 1);
+    }
+  }
+}
+
+static void compare_cofactors(void) {
+  const size_t dims[] = {3, 4, 8, 16, 32, 64};
+  printf("\nCofactor matrices, ns each\n");
+  printf("%4s %14s %16s\n", "n", "copied minors", "cofactor_matrix");
+  for (size_t d = 0; d < sizeof(dims) / sizeof(dims[0]); d++) {
+    const size_t dim = dims[d];
+    double *matrix = (double *)malloc(dim * dim * sizeof(double));
+    double *minor = (double *)malloc(dim * dim * sizeof(double));
+    double *cofactors = (double *)malloc(dim * dim * sizeof(double));
+    /* Each cofactor matrix is dim^2 determinants of size dim - 1. */
+    const size_t reps = 1 + (size_t)(FLOPS_PER_SIZE / 10.0 /
+                                     (dim * dim * lu_flops(dim)));
+    struct timespec start, end;
+    double ns[2];
+    if (!matrix || !minor || !cofactors) {
+      perror("malloc");
+      exit(EXIT_FAILURE);
+    }
+    fill_random(matrix, dim);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (size_t r = 0; r < reps; r++) {
+      copied_cofactors(matrix, dim, minor, cofactors);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    ns[0] = elapsed_ns(&start, &end) / reps;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (size_t r = 0; r < reps; r++) {
+      cofactor_matrix(matrix, dim, dim, cofactors);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    ns[1] = elapsed_ns(&start, &end) / reps;
+    printf("%4lu %14.0f %16.0f\n", dim, ns[0], ns[1]);
+    free(matrix);
+    free(minor);
+    free(cofactors);
+  }
+}
+
+#define COMPARISONS 64
+
+/* Cache-resident and memory-resident vectors, respectively. */
+static void compare_comparisons(void) {
+  const size_t lengths[] = {1024, 1UL << 22};
+  printf("\nComparisons, ns per element\n");
+  printf("%8s %10s %10s %10s %10s %10s %10s\n", "len", "exact", "SIMD",
+         "close", "SIMD", "hash", "keys");
+  for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++) {
+    const size_t len = lengths[l];
+    double *a = (double *)malloc(len * sizeof(double));
+    double *b = (double *)malloc(len * sizeof(double));
+    struct matrix_key key_a, key_b;
+    struct timespec start, end;
+    double ns[6];
+    bool same = false;
+    if (!a || !b) {
+      perror("malloc");
+      exit(EXIT_FAILURE);
+    }
+    for (size_t j = 0; j < len; j++) {
+      a[j] = b[j] = (2.0 * drand48()) - 1.0;
+    }
+    b[len - 1] += 1.0;
+    for (int simd = 0; simd <= 1; simd++) {
+      force_scalar_kernels = !simd;
+      clock_gettime(CLOCK_MONOTONIC, &start);
+      for (size_t r = 0; r < COMPARISONS; r++) {
+        same |= vector_are_equal(a, b, len);
+      }
+      clock_gettime(CLOCK_MONOTONIC, &end);
+      ns[simd] = elapsed_ns(&start, &end) / COMPARISONS / len;
+      clock_gettime(CLOCK_MONOTONIC, &start);
+      for (size_t r = 0; r < COMPARISONS; r++) {
+        same |= vector_are_close(a, b, len, 1e-12, 4);
+      }
+      clock_gettime(CLOCK_MONOTONIC, &end);
+      ns[2 + simd] = elapsed_ns(&start, &end) / COMPARISONS / len;
+    }
+    force_scalar_kernels = false;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    make_matrix_key(&key_a, a, len);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    ns[4] = elapsed_ns(&start, &end) / len;
+    make_matrix_key(&key_b, b, len);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (size_t r = 0; r < COMPARISONS; r++) {
+      same |= matrix_keys_are_equal(&key_a, &key_b);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    ns[5] = elapsed_ns(&start, &end) / COMPARISONS / len;
+    if (same) {
+      fprintf(stderr, "Unequal vectors compared equal.\n");
+    }
+    printf("%8lu %10.3f %10.3f %10.3f %10.3f %10.3f %10.5f\n", len, ns[0],
+           ns[1], ns[2], ns[3], ns[4], ns[5]);
+    free(a);
+    free(b);
+  }
+}
+
+/*
+ * Sparse 0/1 adjacency matrices plus the identity, so that they are rarely
+ * singular and their determinants stay within 64 bits for longer.
+ */
+static void compare_integer(void) {
+  printf("\nInteger (Bareiss) vs. floating-point determinants, ns each\n");
+  printf("%4s %14s %14s %14s %40s\n", "n", "int64", "int128", "double",
+         "determinant");
+  for (size_t dim = 8; dim <= 256; dim *= 2) {
+    int64_t *matrix = (int64_t *)malloc(dim * dim * sizeof(int64_t));
+    double *real = (double *)malloc(dim * dim * sizeof(double));
+    const size_t reps = repetitions(dim) / 4 + 1;
+    struct timespec start, end;
+    int64_t det = 0;
+    __int128 wide = 0;
+    int ret = 0;
+    double ns[3];
+    if (!matrix || !real) {
+      perror("malloc");
+      exit(EXIT_FAILURE);
+    }
+    for (size_t i = 0; i < dim; i++) {
+      for (size_t j = 0; j < dim; j++) {
+        matrix[(i * dim) + j] = (i == j) || (drand48() < 0.1);
+        real[(i * dim) + j] = (double)matrix[(i * dim) + j];
+      }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (size_t r = 0; r < reps; r++) {
+      ret = determinant_int64(matrix, dim, dim, &det);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    ns[0] = elapsed_ns(&start, &end) / reps;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (size_t r = 0; r < reps; r++) {
+      ret = determinant_int128(matrix, dim, dim, &wide);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    ns[1] = elapsed_ns(&start, &end) / reps;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    double real_det = 0.0;
+    for (size_t r = 0; r < reps; r++) {
+      real_det = determinant_n(real, dim, dim);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    ns[2] = elapsed_ns(&start, &end) / reps;
+    if (ret) {
+      printf("%4lu %14.0f %14.0f %14.0f %40s\n", dim, ns[0], ns[1], ns[2],
+             "overflow");
+    } else {
+      /* Print the 128-bit result in decimal, least significant digit first. */
+      char digits[41];
+      char *p = digits + sizeof(digits) - 1;
+      unsigned __int128 magnitude =
+          (wide < 0) ? -(unsigned __int128)wide : (unsigned __int128)wide;
+      *p = '\0';
+      do {
+        *--p = (char)('0' + (int)(magnitude % 10));
+        magnitude /= 10;
+      } while (magnitude);
+      if (wide < 0) {
+        *--p = '-';
+      }
+      printf("%4lu %14.0f %14.0f %14.0f %40s (%g)\n", dim, ns[0], ns[1],
+             ns[2], p, real_det);
+    }
+    free(matrix);
+    free(real);
+  }
+}
+
+/*
+ * Replace 256 rows at each size, refactoring every 50, so that the last 6
+ * updates show the drift.  Above 256 rows the determinants overflow.
+ */
+#define TRACKED_UPDATES 256
+
+static void random_row(double *row, const size_t dim) {
+  for (size_t j = 0; j < dim; j++) {
+    row[j] = (2.0 * drand48()) - 1.0;
+  }
+}
+
+static void compare_tracker(void) {
+  printf("\nRow replacement, ns per determinant\n");
+  printf("%6s %14s %14s %14s\n", "n", "recomputed", "tracked",
+         "relative error");
+  for (size_t dim = 32; dim <= 256; dim *= 2) {
+    double *matrix = (double *)malloc(dim * dim * sizeof(double));
+    double *row = (double *)malloc(dim * sizeof(double));
+    struct determinant_tracker tracker;
+    struct timespec start, end;
+    double det = 0.0;
+    double ns[2];
+    if (!matrix || !row) {
+      perror("malloc");
+      exit(EXIT_FAILURE);
+    }
+    fill_random(matrix, dim);
+    if (initialize_tracker(&tracker, matrix, dim, dim, 50)) {
+      exit(EXIT_FAILURE);
+    }
+    /* Both loops replace the same rows with the same values. */
+    srand48(dim);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (size_t r = 0; r < TRACKED_UPDATES; r++) {
+      random_row(row, dim);
+      memcpy(matrix + ((r % dim) * dim), row, dim * sizeof(double));
+      det = determinant_n(matrix, dim, dim);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    ns[0] = elapsed_ns(&start, &end) / TRACKED_UPDATES;
+    srand48(dim);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (size_t r = 0; r < TRACKED_UPDATES; r++) {
+      random_row(row, dim);
+      replace_row(&tracker, r % dim, row);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    ns[1] = elapsed_ns(&start, &end) / TRACKED_UPDATES;
+    printf("%6lu %14.0f %14.0f %14.2e\n", dim, ns[0], ns[1],
+           fabs((tracker.det - det) / det));
+    release_tracker_resources(&tracker);
+    free(matrix);
+    free(row);
+  }
+}
+
+/* Right-hand sides solved for at each size */
+#define RIGHT_HAND_SIDES 64
+
+static void compare_solves(void) {
+  printf("\nSolutions of A x = b, us per right-hand side\n");
+  printf("%6s %14s %14s %14s\n", "n", "refactored", "cached", "all at once");
+  for (size_t dim = 64; dim <= 1024; dim *= 4) {
+    double *matrix = (double *)malloc(dim * dim * sizeof(double));
+    double *rhs = (double *)malloc(dim * RIGHT_HAND_SIDES * sizeof(double));
+    struct lu_factorization lu;
+    struct timespec start, end;
+    double us[3];
+    if (!matrix || !rhs || initialize_lu(&lu, dim)) {
+      perror("malloc");
+      exit(EXIT_FAILURE);
+    }
+    fill_random(matrix, dim);
+    for (size_t k = 0; k < dim * RIGHT_HAND_SIDES; k++) {
+      rhs[k] = (2.0 * drand48()) - 1.0;
+    }
+    /* One right-hand side at a time is a column of rhs, with stride. */
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (size_t r = 0; r < RIGHT_HAND_SIDES; r++) {
+      lu_factorize(&lu, matrix, dim);
+      lu_solve(&lu, rhs + r, 1, RIGHT_HAND_SIDES);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    us[0] = elapsed_ns(&start, &end) / 1e3 / RIGHT_HAND_SIDES;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    lu_factorize(&lu, matrix, dim);
+    for (size_t r = 0; r < RIGHT_HAND_SIDES; r++) {
+      lu_solve(&lu, rhs + r, 1, RIGHT_HAND_SIDES);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    us[1] = elapsed_ns(&start, &end) / 1e3 / RIGHT_HAND_SIDES;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    lu_factorize(&lu, matrix, dim);
+    lu_solve(&lu, rhs, RIGHT_HAND_SIDES, RIGHT_HAND_SIDES);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    us[2] = elapsed_ns(&start, &end) / 1e3 / RIGHT_HAND_SIDES;
+    printf("%6lu %14.1f %14.1f %14.1f\n", dim, us[0], us[1], us[2]);
+    release_lu_resources(&lu);
+    free(matrix);
+    free(rhs);
+  }
+}
+
+static void compare_schur(const size_t largest) {
+  printf("\nBlock determinants, ms each, with the leading 3/4 factored\n");
+  printf("%6s %10s %10s %10s %10s\n", "n", "whole", "factor A", "Schur",
+         "diagonal A");
+  for (size_t dim = 256; (dim <= largest) && (dim <= 2048); dim *= 2) {
+    const size_t split = 3 * dim / 4;
+    double *matrix = (double *)malloc(dim * dim * sizeof(double));
+    double *diagonal = (double *)malloc(split * sizeof(double));
+    struct lu_factorization lu;
+    struct timespec start, end;
+    double ms[4];
+    if (!matrix || !diagonal || initialize_lu(&lu, split)) {
+      perror("malloc");
+      exit(EXIT_FAILURE);
+    }
+    fill_random(matrix, dim);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    const double whole = determinant_n(matrix, dim, dim);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    ms[0] = elapsed_ns(&start, &end) / 1e6;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    lu_factorize(&lu, matrix, dim);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    ms[1] = elapsed_ns(&start, &end) / 1e6;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    const double schur = schur_determinant(&lu, matrix, dim, dim);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    ms[2] = elapsed_ns(&start, &end) / 1e6;
+    if (fabs(schur - whole) > 1e-8 * fabs(whole)) {
+      fprintf(stderr, "The block determinant differs at %lu.\n", dim);
+    }
+    for (size_t i = 0; i < split; i++) {
+      diagonal[i] = 1.0 + drand48();
+    }
+    lu_factorize_diagonal(&lu, diagonal);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    schur_determinant(&lu, matrix, dim, dim);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    ms[3] = elapsed_ns(&start, &end) / 1e6;
+    printf("%6lu %10.1f %10.1f %10.1f %10.1f\n", dim, ms[0], ms[1], ms[2],
+           ms[3]);
+    release_lu_resources(&lu);
+    free(matrix);
+    free(diagonal);
+  }
+}
+
+/* The largest matrix written to a file in /tmp is 2048 x 2048, or 32 MiB. */
+static void compare_mapped(const size_t largest) {
+  char path[] = "/tmp/matrix-determinant_benchmarkXXXXXX";
+  const int fd = mkstemp(path);
+  if (fd < 0) {
+    perror(path);
+    return;
+  }
+  close(fd);
+  printf("\nMatrix files, ms to load and ms for the determinant\n");
+  printf("%6s %10s %10s %12s\n", "n", "mmap", "read", "determinant");
+  for (size_t dim = 256; (dim <= largest) && (dim <= 2048); dim *= 2) {
+    double *matrix = (double *)malloc(dim * dim * sizeof(double));
+    struct mapped_matrix mapped;
+    struct timespec start, end;
+    double ms[3];
+    if (!matrix) {
+      perror("malloc");
+      exit(EXIT_FAILURE);
+    }
+    fill_random(matrix, dim);
+    if (write_matrix_file(path, matrix, MATRIX_FLOAT64, dim, dim, dim)) {
+      exit(EXIT_FAILURE);
+    }
+    /* The file is in the page cache either way, as just written. */
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    FILE *file = fopen(path, "r");
+    if (!file || fseek(file, sizeof(struct matrix_file_header), SEEK_SET) ||
+        (dim * dim != fread(matrix, sizeof(double), dim * dim, file))) {
+      perror(path);
+      exit(EXIT_FAILURE);
+    }
+    fclose(file);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    ms[1] = elapsed_ns(&start, &end) / 1e6;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (map_matrix_file(path, &mapped)) {
+      exit(EXIT_FAILURE);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    ms[0] = elapsed_ns(&start, &end) / 1e6;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    const double det = mapped_determinant(&mapped);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    ms[2] = elapsed_ns(&start, &end) / 1e6;
+    if (det != determinant_n(matrix, dim, dim)) {
+      fprintf(stderr, "The mapped determinant differs.\n");
+    }
+    printf("%6lu %10.3f %10.3f %12.1f\n", dim, ms[0], ms[1], ms[2]);
+    unmap_matrix_file(&mapped);
+    free(matrix);
+  }
+  unlink(path);
+}
+
+/*
+ * The error of the mixed path is that of log|det|, which is the relative
+ * error of the determinant.  The float determinant overflows from about 100
+ * rows of these matrices.
+ */
+static void compare_precision(const size_t largest) {
+  printf("\nPrecision, ms per determinant and relative error\n");
+  printf("%6s %10s %10s %10s %10s %10s\n", "n", "double", "mixed", "error",
+         "float", "error");
+  for (size_t dim = 64; (dim <= largest) && (dim <= 2048); dim *= 2) {
+    double *matrix = (double *)malloc(dim * dim * sizeof(double));
+    float *rounded = (float *)malloc(dim * dim * sizeof(float));
+    const size_t reps = repetitions(dim);
+    double best[3] = {INFINITY, INFINITY, INFINITY};
+    double logabsdet[2];
+    float det = NAN;
+    int sign[2];
+    if (!matrix || !rounded) {
+      perror("malloc");
+      exit(EXIT_FAILURE);
+    }
+    fill_random(matrix, dim);
+    for (size_t k = 0; k < dim * dim; k++) {
+      rounded[k] = (float)matrix[k];
+    }
+    for (size_t r = 0; r < reps; r++) {
+      struct timespec start, end;
+      clock_gettime(CLOCK_MONOTONIC, &start);
+      slogdet_n(matrix, dim, dim, 1, &sign[0], &logabsdet[0]);
+      clock_gettime(CLOCK_MONOTONIC, &end);
+      best[0] = fmin(best[0], elapsed_ns(&start, &end));
+      clock_gettime(CLOCK_MONOTONIC, &start);
+      slogdet_mixed(matrix, dim, dim, &sign[1], &logabsdet[1]);
+      clock_gettime(CLOCK_MONOTONIC, &end);
+      best[1] = fmin(best[1], elapsed_ns(&start, &end));
+      clock_gettime(CLOCK_MONOTONIC, &start);
+      det = determinant_float(rounded, dim, dim);
+      clock_gettime(CLOCK_MONOTONIC, &end);
+      best[2] = fmin(best[2], elapsed_ns(&start, &end));
+    }
+    if (sign[0] != sign[1]) {
+      fprintf(stderr, "The mixed-precision sign differs at %lu.\n", dim);
+    }
+    const double exact = sign[0] * exp(logabsdet[0]);
+    printf("%6lu %10.3f %10.3f %10.1e %10.3f %10.1e\n", dim, best[0] / 1e6,
+           best[1] / 1e6, fabs(logabsdet[1] - logabsdet[0]), best[2] / 1e6,
+           isinf(det) ? INFINITY : fabs((det - exact) / exact));
+    free(matrix);
+    free(rounded);
+  }
+}
+
+/*
+ * Off-diagonal entries per column of the random sparse matrices.  With 2,
+ * the factors of a 10^4-row matrix already have 100 times as many nonzeros
+ * as the matrix in either order, as random graphs lack small separators.
+ */
+#define RANDOM_SPARSE_ENTRIES 1
+/*
+ * Natural-order LU of an arrow matrix fills in completely, so it is only
+ * timed at the smallest size, which is 10^3 rather than 10^4 rows.
+ */
+#define ARROW_NATURAL_LIMIT 1000
+
+enum sparse_kind { BANDED, RANDOM, ARROW };
+
+/*
+ * A band of width 5, a diagonal plus random entries, or a diagonal with a
+ * full first row and column, in each case with the diagonal large enough
+ * that the determinant is far from 0.  Returns the number of nonzeros.
+ */
+static size_t build_sparse(const size_t dim, const enum sparse_kind kind,
+                           size_t *starts, size_t *indices, double *values) {
+  size_t nnz = 0;
+  starts[0] = 0;
+  for (size_t j = 0; j < dim; j++) {
+    switch (kind) {
+    case BANDED:
+      for (size_t i = (j > 2) ? j - 2 : 0; (i <= j + 2) && (i < dim); i++) {
+        indices[nnz] = i;
+        values[nnz++] = (i == j) ? 4.0 : (2.0 * drand48()) - 1.0;
+      }
+      break;
+    case RANDOM:
+      indices[nnz] = j;
+      values[nnz++] = 4.0;
+      for (size_t e = 0; e < RANDOM_SPARSE_ENTRIES; e++) {
+        indices[nnz] = (size_t)(drand48() * dim);
+        values[nnz++] = (2.0 * drand48()) - 1.0;
+      }
+      break;
+    case ARROW:
+      for (size_t i = 0; i < (j ? 1 : dim); i++) {
+        indices[nnz] = i;
+        values[nnz++] = (2.0 * drand48()) - 1.0;
+      }
+      if (j) {
+        indices[nnz] = j;
+        values[nnz++] = 4.0;
+      }
+      break;
+    }
+    starts[j + 1] = nnz;
+  }
+  return nnz;
+}
+
+static void compare_sparse(const size_t largest) {
+  const char *kinds[] = {"banded", "random", "arrow"};
+  printf("\nSparse LU, ms and factor nonzeros per matrix nonzero\n");
+  printf("%8s %8s %10s %12s %8s %12s %8s %14s\n", "matrix", "n", "nnz",
+         "natural", "fill", "min degree", "fill", "log|det|");
+  for (size_t kind = BANDED; kind <= ARROW; kind++) {
+    for (size_t dim = (ARROW == kind) ? ARROW_NATURAL_LIMIT : 10000;
+         dim <= largest; dim *= 10) {
+      /* At most 5 entries per column on average */
+      const size_t cap = 5 * dim;
+      size_t *starts = (size_t *)malloc((dim + 1) * sizeof(size_t));
+      size_t *indices = (size_t *)malloc(cap * sizeof(size_t));
+      double *values = (double *)malloc(cap * sizeof(double));
+      double ms[2], logabsdet = 0.0;
+      size_t fill[2];
+      if (!starts || !indices || !values) {
+        perror("malloc");
+        exit(EXIT_FAILURE);
+      }
+      const size_t nnz = build_sparse(dim, (enum sparse_kind)kind, starts,
+                                      indices, values);
+      const struct sparse_matrix matrix = {dim, starts, indices, values};
+      for (size_t o = 0; o < 2; o++) {
+        struct timespec start, end;
+        int sign;
+        if ((ARROW == kind) && !o && (dim > ARROW_NATURAL_LIMIT)) {
+          ms[o] = NAN;
+          fill[o] = 0;
+          continue;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        if (sparse_slogdet(&matrix,
+                           o ? SPARSE_MINIMUM_DEGREE : SPARSE_NATURAL, &sign,
+                           &logabsdet, &fill[o])) {
+          exit(EXIT_FAILURE);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        ms[o] = elapsed_ns(&start, &end) / 1e6;
+      }
+      printf("%8s %8lu %10lu %12.1f %8.1f %12.1f %8.1f %14.6g\n",
+             kinds[kind], dim, nnz, ms[0], (double)fill[0] / nnz, ms[1],
+             (double)fill[1] / nnz, logabsdet);
+      free(starts);
+      free(indices);
+      free(values);
+    }
+  }
+}
+
+int main(int argc, char **argv) {
+  const size_t sizes[] = {3, 4, 8, 16, 32, 64, 128, 256, 512, 1024, 2048};
+  const size_t largest = (argc > 1) ? strtoul(argv[1], NULL, 10) : 4096;
+  const size_t block =
+      (argc > 2) ? strtoul(argv[2], NULL, 10) : LU_BLOCK_SIZE;
+  const size_t sparse_largest =
+      (argc > 3) ? strtoul(argv[3], NULL, 10) : 1000000;
+  /* Keep the compiler from discarding the determinants. */
+  volatile double sink = 0.0;
+  if (!block) {
+    fprintf(stderr, "The block size must be positive.\n");
+    exit(EXIT_FAILURE);
+  }
+  srand48(1);
+  printf("%6s %14s %10s %14s\n", "n", "ns/det", "GFLOP/s", "ns/slogdet");
+  for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+    const size_t dim = sizes[s];
+    if (dim > largest) {
+      break;
+    }
+    double *matrix = (double *)malloc(dim * dim * sizeof(double));
+    if (!matrix) {
+      perror("malloc");
+      exit(EXIT_FAILURE);
+    }
+    fill_random(matrix, dim);
+    const size_t reps = repetitions(dim);
+    double best = 0.0, best_log = 0.0;
+    for (size_t r = 0; r < reps; r++) {
+      struct timespec start, end;
+      int sign;
+      double logabsdet;
+      clock_gettime(CLOCK_MONOTONIC, &start);
+      sink = sink + determinant_n(matrix, dim, dim);
+      clock_gettime(CLOCK_MONOTONIC, &end);
+      const double ns = elapsed_ns(&start, &end);
+      if (!r || (ns < best)) {
+        best = ns;
+      }
+      clock_gettime(CLOCK_MONOTONIC, &start);
+      slogdet_n(matrix, dim, dim, 1, &sign, &logabsdet);
+      clock_gettime(CLOCK_MONOTONIC, &end);
+      sink = sink + logabsdet;
+      const double log_ns = elapsed_ns(&start, &end);
+      if (!r || (log_ns < best_log)) {
+        best_log = log_ns;
+      }
+    }
+    printf("%6lu %14.0f %10.2f %14.0f\n", dim, best, lu_flops(dim) / best,
+           best_log);
+    free(matrix);
+  }
+  compare_blocking(largest, block);
+  compare_threads(largest, block);
+  compare_batches();
+  compare_templates();
+  compare_cofactors();
+  compare_comparisons();
+  compare_integer();
+  compare_tracker();
+  compare_solves();
+  compare_schur(largest);
+  compare_mapped(largest);
+  compare_precision(largest);
+  compare_sparse(sparse_largest);
+  exit(EXIT_SUCCESS);
+}
@@ -1,8 +1,13 @@
+#include <algorithm>
+#include <cfloat>
+#include <vector>
+
 #include "gtest/gtest.h"
 
 #define TESTING
 
 #include "matrix-determinant.c"
+#include "matrix-determinant-template.h"
 
 const double test_matrix[SIZE][SIZE] = {
     {0.0, 2.0, 2.0}, {6.0, 4.0, 10.0}, {6.0, 14.0, 8.0}};
@@ -42,6 +47,40 @@ TEST(SimpleMatrixTest, VectorAreEqual) {
   EXPECT_TRUE(const_vector_are_equal(upperleft, ans, 0U));
 }
 
+TEST(SimpleMatrixTest, VectorAreClose) {
+  const double one_ulp = std::nextafter(1.0, 2.0);
+  const double a[] = {1.0, -2.0, 0.0, 1e-20, 5.0};
+  const double b[] = {one_ulp, -2.0, -0.0, -1e-20, 5.0};
+  EXPECT_FALSE(vector_are_close(a, b, 5, 0.0, 1));
+  EXPECT_TRUE(vector_are_close(a, b, 5, 1e-19, 1));
+  /* Opposite signs are only close by the absolute tolerance. */
+  EXPECT_FALSE(vector_are_close(a, b, 5, 0.0, UINT64_MAX));
+  EXPECT_FALSE(vector_are_close(a, b, 2, 0.0, 0));
+  EXPECT_TRUE(vector_are_close(a, b, 2, 1e-15, 0));
+  const double nan[] = {std::nan("")};
+  EXPECT_FALSE(vector_are_close(nan, nan, 1, INFINITY, UINT64_MAX));
+  EXPECT_TRUE(vector_are_close(nan, nan, 0, 0.0, 0));
+}
+
+TEST(SimpleMatrixTest, Hash) {
+  const double zeros[] = {0.0, -0.0, 1.0};
+  const double negative_zeros[] = {-0.0, 0.0, 1.0};
+  const double swapped[] = {0.0, 1.0, 0.0};
+  EXPECT_EQ(vector_hash(zeros, 3), vector_hash(negative_zeros, 3));
+  EXPECT_NE(vector_hash(zeros, 3), vector_hash(swapped, 3));
+  EXPECT_NE(vector_hash(zeros, 3), vector_hash(zeros, 2));
+  struct matrix_key key1, key2, key3;
+  make_matrix_key(&key1, &test_matrix[0][0], SIZE * SIZE);
+  std::vector<double> copy(&test_matrix[0][0],
+                           &test_matrix[0][0] + (SIZE * SIZE));
+  make_matrix_key(&key2, copy.data(), SIZE * SIZE);
+  EXPECT_TRUE(matrix_keys_are_equal(&key1, &key2));
+  copy[SIZE * SIZE - 1] += 1.0;
+  make_matrix_key(&key3, copy.data(), SIZE * SIZE);
+  EXPECT_NE(key1.hash, key3.hash);
+  EXPECT_FALSE(matrix_keys_are_equal(&key1, &key3));
+}
+
 TEST(SimpleMatrixTest, Submatrix) {
   double upperleft[] = {0, 0, 0, 0};
   ASSERT_EQ(0, get_submatrix(upperleft, SIZE - 1, SIZE - 1, test_matrix));
@@ -58,3 +97,1366 @@ TEST(SimpleMatrixTest, SubmatrixBadInput) {
   double submatrix[] = {0, 0, 0, 0};
   EXPECT_EQ(-EINVAL, get_submatrix(submatrix, -1, SIZE - 1, test_matrix));
 }
+
+TEST(LUDeterminantTest, MatchesCofactorExpansion) {
+  EXPECT_DOUBLE_EQ(144.0, determinant(test_matrix));
+  EXPECT_DOUBLE_EQ(144.0, determinant_n(&test_matrix[0][0], SIZE, SIZE));
+  double copy[SIZE][SIZE];
+  memcpy(copy, test_matrix, sizeof(copy));
+  EXPECT_DOUBLE_EQ(144.0, determinant_lu(&copy[0][0], SIZE, SIZE));
+}
+
+TEST(LUDeterminantTest, SmallSizes) {
+  const double one[] = {-7.0};
+  const double two[] = {1.0, 2.0, 3.0, 4.0};
+  EXPECT_DOUBLE_EQ(1.0, determinant_n(one, 0, 0));
+  EXPECT_DOUBLE_EQ(-7.0, determinant_n(one, 1, 1));
+  EXPECT_DOUBLE_EQ(-2.0, determinant_n(two, 2, 2));
+}
+
+TEST(LUDeterminantTest, FourByFour) {
+  /* Upper triangular, so the determinant is the product of the diagonal. */
+  const double matrix[] = {1.0, 9.0, 8.0, 7.0, 0.0, 2.0, 6.0, 5.0,
+                           0.0, 0.0, 3.0, 4.0, 0.0, 0.0, 0.0, 4.0};
+  EXPECT_DOUBLE_EQ(24.0, determinant_n(matrix, 4, 4));
+}
+
+TEST(LUDeterminantTest, RowSwapFlipsSign) {
+  const double matrix[] = {0.0, 0.0, 0.0, 2.0, 0.0, 0.0, 3.0, 0.0,
+                           0.0, 5.0, 0.0, 0.0, 7.0, 0.0, 0.0, 0.0};
+  /* The anti-diagonal permutation of four rows is even. */
+  EXPECT_DOUBLE_EQ(210.0, determinant_n(matrix, 4, 4));
+  const double swapped[] = {0.0, 0.0, 3.0, 0.0, 0.0, 0.0, 0.0, 2.0,
+                            0.0, 5.0, 0.0, 0.0, 7.0, 0.0, 0.0, 0.0};
+  EXPECT_DOUBLE_EQ(-210.0, determinant_n(swapped, 4, 4));
+}
+
+TEST(LUDeterminantTest, Singular) {
+  const double matrix[] = {1.0,  2.0,  3.0,  4.0,  2.0,  4.0,  6.0,  8.0,
+                           5.0,  6.0,  7.0,  8.0,  9.0,  10.0, 11.0, 12.0};
+  EXPECT_DOUBLE_EQ(0.0, determinant_n(matrix, 4, 4));
+}
+
+TEST(LUDeterminantTest, Strided) {
+  /* The upper-left 4x4 block of a 4x6 array is the identity times 2. */
+  const double matrix[] = {2.0, 0.0, 0.0, 0.0, 99.0, 99.0,
+                           0.0, 2.0, 0.0, 0.0, 99.0, 99.0,
+                           0.0, 0.0, 2.0, 0.0, 99.0, 99.0,
+                           0.0, 0.0, 0.0, 2.0, 99.0, 99.0};
+  EXPECT_DOUBLE_EQ(16.0, determinant_n(matrix, 4, 6));
+  EXPECT_DOUBLE_EQ(8.0, determinant_n(matrix, 3, 6));
+}
+
+TEST(LUDeterminantTest, RecordsPivots) {
+  double matrix[] = {1.0, 2.0, 4.0, 3.0};
+  size_t pivots[2];
+  int sign = 0;
+  ASSERT_EQ(0, lu_factor(matrix, 2, 2, pivots, &sign));
+  EXPECT_EQ(1U, pivots[0]);
+  EXPECT_EQ(1U, pivots[1]);
+  EXPECT_EQ(-1, sign);
+  /* L = [1 0; 0.25 1], U = [4 3; 0 1.25] */
+  EXPECT_DOUBLE_EQ(4.0, matrix[0]);
+  EXPECT_DOUBLE_EQ(0.25, matrix[2]);
+  EXPECT_DOUBLE_EQ(1.25, matrix[3]);
+}
+
+TEST(LUDeterminantTest, BadInput) {
+  const double matrix[] = {1.0, 2.0, 3.0, 4.0};
+  EXPECT_TRUE(std::isnan(determinant_n(NULL, 2, 2)));
+  EXPECT_TRUE(std::isnan(determinant_n(matrix, 2, 1)));
+  int sign;
+  EXPECT_EQ(-EINVAL, lu_factor(NULL, 2, 2, NULL, &sign));
+}
+
+/* Fill with a fixed pseudo-random sequence, so failures are reproducible. */
+static void fill_test_matrix(double *matrix, const size_t dim) {
+  uint64_t state = 0x9e3779b97f4a7c15ULL;
+  for (size_t i = 0; i < dim * dim; i++) {
+    state = (state * 6364136223846793005ULL) + 1442695040888963407ULL;
+    matrix[i] = ((double)(state >> 11) / (double)(1ULL << 53)) - 0.5;
+  }
+}
+
+TEST(BlockedLUTest, MatchesUnblocked) {
+  const size_t dim = 150;
+  std::vector<double> plain(dim * dim), tiled(dim * dim);
+  std::vector<size_t> plain_pivots(dim), tiled_pivots(dim);
+  fill_test_matrix(plain.data(), dim);
+  tiled = plain;
+  int plain_sign = 0, tiled_sign = 0;
+  ASSERT_EQ(0, lu_factor(plain.data(), dim, dim, plain_pivots.data(),
+                         &plain_sign));
+  /* 7 does not divide 150, so the last panel and tiles are narrower. */
+  for (const size_t block : {7UL, 16UL, 64UL, 200UL}) {
+    std::vector<double> work = tiled;
+    ASSERT_EQ(0, lu_factor_blocked(work.data(), dim, dim, block,
+                                   tiled_pivots.data(), &tiled_sign));
+    EXPECT_EQ(plain_pivots, tiled_pivots);
+    EXPECT_EQ(plain_sign, tiled_sign);
+    for (size_t i = 0; i < dim * dim; i++) {
+      ASSERT_NEAR(plain[i], work[i], 1e-9 * (1.0 + fabs(plain[i])));
+    }
+  }
+}
+
+TEST(BlockedLUTest, DeterminantAboveBlockSize) {
+  /* Upper bidiagonal with 1.01 on the diagonal, below a row permutation. */
+  const size_t dim = 3 * LU_BLOCK_SIZE + 5;
+  std::vector<double> matrix(dim * dim, 0.0);
+  for (size_t i = 0; i < dim; i++) {
+    matrix[(i * dim) + i] = 1.01;
+    if (i + 1 < dim) {
+      matrix[(i * dim) + i + 1] = 1.0;
+    }
+  }
+  EXPECT_NEAR(pow(1.01, dim), determinant_n(matrix.data(), dim, dim),
+              1e-9 * pow(1.01, dim));
+  /* Swap the first and last rows. */
+  std::swap_ranges(matrix.begin(), matrix.begin() + dim,
+                   matrix.begin() + ((dim - 1) * dim));
+  EXPECT_NEAR(-pow(1.01, dim), determinant_n(matrix.data(), dim, dim),
+              1e-9 * pow(1.01, dim));
+}
+
+TEST(BlockedLUTest, Singular) {
+  const size_t dim = 2 * LU_BLOCK_SIZE + 1;
+  std::vector<double> matrix(dim * dim);
+  fill_test_matrix(matrix.data(), dim);
+  /*
+   * Identical rows receive identical updates, so one of them is eliminated
+   * exactly.
+   */
+  std::copy(matrix.begin(), matrix.begin() + dim,
+            matrix.begin() + ((dim - 1) * dim));
+  EXPECT_EQ(0.0, determinant_n(matrix.data(), dim, dim));
+}
+
+TEST(BlockedLUTest, BadInput) {
+  double matrix[] = {1.0, 2.0, 3.0, 4.0};
+  int sign;
+  EXPECT_EQ(-EINVAL, lu_factor_blocked(matrix, 2, 2, 0, NULL, &sign));
+  EXPECT_EQ(-EINVAL, lu_factor_blocked(matrix, 2, 1, 4, NULL, &sign));
+}
+
+/* The SIMD kernels must agree with the scalar ones to within FMA rounding. */
+class KernelTest : public ::testing::Test {
+protected:
+  KernelTest() { force_scalar_kernels = false; }
+  ~KernelTest() override { force_scalar_kernels = false; }
+  const struct simd_kernels *scalar = &scalar_kernels;
+  const struct simd_kernels *selected = select_kernels();
+};
+
+TEST_F(KernelTest, RowUpdate) {
+  /* Odd lengths exercise the scalar tail of the vector loops. */
+  for (size_t len = 0; len < 19; len++) {
+    std::vector<double> pivot_row(len), expected(len), actual(len);
+    for (size_t j = 0; j < len; j++) {
+      pivot_row[j] = 1.0 + (0.1 * j);
+      expected[j] = actual[j] = 3.0 - (0.07 * j);
+    }
+    scalar->row_update(expected.data(), pivot_row.data(), 0.3, len);
+    selected->row_update(actual.data(), pivot_row.data(), 0.3, len);
+    for (size_t j = 0; j < len; j++) {
+      EXPECT_NEAR(expected[j], actual[j], 1e-15);
+    }
+  }
+}
+
+TEST_F(KernelTest, RowUpdate4) {
+  const size_t len = 23;
+  /* fill_test_matrix() fills dim * dim elements. */
+  std::vector<double> rows(10 * 10), expected(len), actual(len);
+  fill_test_matrix(rows.data(), 10);
+  const double *pivot_rows[4] = {&rows[0], &rows[len], &rows[2 * len],
+                                 &rows[3 * len]};
+  const double multipliers[4] = {0.5, -0.25, 2.0, 1.0 / 3.0};
+  for (size_t j = 0; j < len; j++) {
+    expected[j] = actual[j] = 1.0 + j;
+  }
+  scalar->row_update4(expected.data(), pivot_rows, multipliers, len);
+  selected->row_update4(actual.data(), pivot_rows, multipliers, len);
+  for (size_t j = 0; j < len; j++) {
+    EXPECT_NEAR(expected[j], actual[j], 1e-13);
+  }
+}
+
+TEST_F(KernelTest, FloatRowUpdates) {
+  /* Lengths past two 8-lane vectors, with every tail length. */
+  for (size_t len = 0; len < 27; len++) {
+    std::vector<float> u(4 * len), expected(len), actual(len);
+    for (size_t j = 0; j < 4 * len; j++) {
+      u[j] = 1.0f + (0.1f * (float)j);
+    }
+    for (size_t j = 0; j < len; j++) {
+      expected[j] = actual[j] = 3.0f - (0.07f * (float)j);
+    }
+    scalar->row_update_float(expected.data(), u.data(), 0.3f, len);
+    selected->row_update_float(actual.data(), u.data(), 0.3f, len);
+    const float *pivot_rows[4] = {u.data(), u.data() + len,
+                                  u.data() + (2 * len), u.data() + (3 * len)};
+    const float multipliers[4] = {0.5f, -0.25f, 2.0f, 1.0f / 3.0f};
+    scalar->row_update4_float(expected.data(), pivot_rows, multipliers, len);
+    selected->row_update4_float(actual.data(), pivot_rows, multipliers, len);
+    for (size_t j = 0; j < len; j++) {
+      EXPECT_NEAR(expected[j], actual[j], 1e-5f * (1.0f + fabsf(expected[j])));
+    }
+  }
+}
+
+TEST_F(KernelTest, ScalarAndSelectedFactorsAgree) {
+  const size_t dim = 2 * LU_BLOCK_SIZE + 3;
+  std::vector<double> expected(dim * dim);
+  fill_test_matrix(expected.data(), dim);
+  std::vector<double> actual = expected;
+  std::vector<size_t> expected_pivots(dim), actual_pivots(dim);
+  int expected_sign, actual_sign;
+  force_scalar_kernels = true;
+  ASSERT_EQ(0, lu_factor_blocked(expected.data(), dim, dim, LU_BLOCK_SIZE,
+                                 expected_pivots.data(), &expected_sign));
+  force_scalar_kernels = false;
+  ASSERT_EQ(0, lu_factor_blocked(actual.data(), dim, dim, LU_BLOCK_SIZE,
+                                 actual_pivots.data(), &actual_sign));
+  EXPECT_EQ(expected_pivots, actual_pivots);
+  EXPECT_EQ(expected_sign, actual_sign);
+  for (size_t i = 0; i < dim * dim; i++) {
+    ASSERT_NEAR(expected[i], actual[i], 1e-9 * (1.0 + fabs(expected[i])));
+  }
+}
+
+TEST_F(KernelTest, EqualityMatchesNotEqualOperator) {
+  const double nan = std::nan("");
+  /* Differences at each position, including in the scalar tail. */
+  for (size_t len = 1; len < 11; len++) {
+    for (size_t differs = 0; differs < len; differs++) {
+      std::vector<double> a(len, 1.5), b(len, 1.5);
+      b[differs] = 2.5;
+      EXPECT_FALSE(selected->are_equal(a.data(), b.data(), len));
+      EXPECT_TRUE(selected->are_equal(a.data(), b.data(), differs));
+    }
+  }
+  /* NaN is unequal to itself, and the zeros are equal. */
+  const double with_nan[] = {0.0, 1.0, 2.0, nan, 4.0};
+  const double zeros[] = {0.0, 0.0, -0.0, 0.0, -0.0};
+  const double negative_zeros[] = {-0.0, 0.0, 0.0, -0.0, 0.0};
+  EXPECT_FALSE(selected->are_equal(with_nan, with_nan, 5));
+  EXPECT_FALSE(scalar->are_equal(with_nan, with_nan, 5));
+  EXPECT_TRUE(selected->are_equal(zeros, negative_zeros, 5));
+  EXPECT_TRUE(scalar->are_equal(zeros, negative_zeros, 5));
+}
+
+TEST_F(KernelTest, ClosenessMatchesScalar) {
+  const double values[] = {0.0,     -0.0,     1e-300, -1e-300, 1.0,
+                           -1.0,    1.5,      1e300,  INFINITY, -INFINITY,
+                           std::nan("")};
+  const double tolerances[] = {0.0, 1e-12, 1.0};
+  const uint64_t ulps[] = {0, 4, UINT64_MAX};
+  /* Each pair at each position of a vector with a scalar tail. */
+  for (const double a : values) {
+    for (const double b : values) {
+      for (size_t position = 0; position < 7; position++) {
+        std::vector<double> x(7, 2.0), y(7, 2.0);
+        x[position] = a;
+        y[position] = std::nextafter(b, 0.0);
+        for (const double tolerance : tolerances) {
+          for (const uint64_t max_ulps : ulps) {
+            EXPECT_EQ(scalar->are_close(x.data(), y.data(), 7, tolerance,
+                                        max_ulps),
+                      selected->are_close(x.data(), y.data(), 7, tolerance,
+                                          max_ulps))
+                << a << " " << b << " " << tolerance << " " << max_ulps;
+          }
+        }
+      }
+    }
+  }
+}
+
+TEST(ParallelLUTest, ReproducesSingleThreadedFactors) {
+  const size_t dim = 203;
+  const size_t block = 16;
+  std::vector<double> expected(dim * dim);
+  std::vector<size_t> expected_pivots(dim), actual_pivots(dim);
+  int expected_sign, actual_sign;
+  fill_test_matrix(expected.data(), dim);
+  const std::vector<double> source = expected;
+  ASSERT_EQ(0, lu_factor_blocked(expected.data(), dim, dim, block,
+                                 expected_pivots.data(), &expected_sign));
+  for (const size_t threads : {1UL, 2UL, 3UL, 5UL, 8UL}) {
+    std::vector<double> actual = source;
+    ASSERT_EQ(0, lu_factor_parallel(actual.data(), dim, dim, block, threads,
+                                    actual_pivots.data(), &actual_sign));
+    EXPECT_EQ(expected_pivots, actual_pivots);
+    EXPECT_EQ(expected_sign, actual_sign);
+    /* Bitwise, not merely within a tolerance. */
+    EXPECT_EQ(0, memcmp(expected.data(), actual.data(),
+                        dim * dim * sizeof(double)))
+        << threads << " threads";
+  }
+}
+
+TEST(ParallelLUTest, DeterminantMatchesSingleThreaded) {
+  const size_t dim = 2 * LU_BLOCK_SIZE + 7;
+  /* Embed the matrix in a wider array to exercise the stride. */
+  const size_t stride = dim + 3;
+  std::vector<double> matrix(dim * stride);
+  fill_test_matrix(matrix.data(), dim);
+  const double expected = determinant_n(matrix.data(), dim, stride);
+  for (const size_t threads : {0UL, 2UL, 4UL}) {
+    EXPECT_EQ(expected,
+              determinant_n_parallel(matrix.data(), dim, stride, threads));
+  }
+}
+
+/* Workers outlive each call, and are only added when more are asked for. */
+TEST(ParallelLUTest, WorkersAreKept) {
+  const size_t dim = 203;
+  const size_t block = 16;
+  std::vector<double> expected(dim * dim);
+  int expected_sign, sign;
+  fill_test_matrix(expected.data(), dim);
+  const std::vector<double> source = expected;
+  ASSERT_EQ(0, lu_factor_blocked(expected.data(), dim, dim, block, NULL,
+                                 &expected_sign));
+  release_lu_threads();
+  EXPECT_EQ(0u, lu_pool.created);
+  std::vector<pthread_t> first;
+  for (const size_t threads : {3UL, 2UL, 3UL, 4UL}) {
+    std::vector<double> actual = source;
+    ASSERT_EQ(0, lu_factor_parallel(actual.data(), dim, dim, block, threads,
+                                    NULL, &sign));
+    EXPECT_EQ(expected_sign, sign);
+    EXPECT_EQ(0, memcmp(expected.data(), actual.data(),
+                        dim * dim * sizeof(double)))
+        << threads << " threads";
+    if (first.empty()) {
+      first.assign(lu_pool.workers, lu_pool.workers + lu_pool.created);
+    }
+    EXPECT_EQ((threads > 3) ? 3u : 2u, lu_pool.created);
+    EXPECT_TRUE(pthread_equal(first[0], lu_pool.workers[0]));
+    EXPECT_TRUE(pthread_equal(first[1], lu_pool.workers[1]));
+  }
+  release_lu_threads();
+  EXPECT_EQ(0u, lu_pool.created);
+  /* The pool starts again after a release. */
+  std::vector<double> actual = source;
+  ASSERT_EQ(0, lu_factor_parallel(actual.data(), dim, dim, block, 2, NULL,
+                                  &sign));
+  EXPECT_EQ(0, memcmp(expected.data(), actual.data(),
+                      dim * dim * sizeof(double)));
+  release_lu_threads();
+}
+
+TEST(ParallelLUTest, SmallMatrices) {
+  EXPECT_DOUBLE_EQ(144.0,
+                   determinant_n_parallel(&test_matrix[0][0], SIZE, SIZE, 4));
+  double matrix[] = {1.0, 2.0, 3.0, 4.0};
+  int sign;
+  /* Fewer rows than threads falls back to the single-threaded path. */
+  ASSERT_EQ(0, lu_factor_parallel(matrix, 2, 2, 1, 8, NULL, &sign));
+  EXPECT_DOUBLE_EQ(-2.0, sign * matrix[0] * matrix[3]);
+  EXPECT_EQ(-EINVAL, lu_factor_parallel(NULL, 2, 2, 1, 2, NULL, &sign));
+}
+
+/* Transpose count matrices stored one after another into a batch. */
+static std::vector<double> to_batch(const std::vector<double> &matrices,
+                                    const size_t dim, const size_t count) {
+  std::vector<double> soa(matrices.size());
+  for (size_t m = 0; m < count; m++) {
+    for (size_t k = 0; k < dim * dim; k++) {
+      soa[(k * count) + m] = matrices[(m * dim * dim) + k];
+    }
+  }
+  return soa;
+}
+
+TEST(BatchDeterminantTest, MatchesDeterminantN) {
+  /* 11 is not a multiple of the SIMD width. */
+  const size_t count = 11;
+  for (const size_t dim : {2UL, 3UL, 4UL}) {
+    std::vector<double> matrices(count * dim * dim);
+    /* fill_test_matrix() fills the square of its argument. */
+    std::vector<double> random(count * count * dim * dim);
+    fill_test_matrix(random.data(), count * dim);
+    std::copy(random.begin(), random.begin() + matrices.size(),
+              matrices.begin());
+    const std::vector<double> soa = to_batch(matrices, dim, count);
+    for (const bool scalar : {true, false}) {
+      std::vector<double> dets(count);
+      force_scalar_kernels = scalar;
+      ASSERT_EQ(0, determinant_batch(soa.data(), dim, count, dets.data()));
+      for (size_t m = 0; m < count; m++) {
+        EXPECT_NEAR(determinant_n(&matrices[m * dim * dim], dim, dim), dets[m],
+                    1e-14)
+            << "dim " << dim << " matrix " << m;
+      }
+    }
+    force_scalar_kernels = false;
+  }
+}
+
+TEST(BatchDeterminantTest, KnownValues) {
+  std::vector<double> matrices(&test_matrix[0][0], &test_matrix[0][0] + 9);
+  /* Append the identity and a singular matrix. */
+  const double more[] = {1, 0, 0, 0, 1, 0, 0, 0, 1, 1, 2, 3, 2, 4, 6, 7, 8, 9};
+  matrices.insert(matrices.end(), more, more + 18);
+  const std::vector<double> soa = to_batch(matrices, 3, 3);
+  double dets[3];
+  ASSERT_EQ(0, determinant_batch(soa.data(), 3, 3, dets));
+  EXPECT_DOUBLE_EQ(144.0, dets[0]);
+  EXPECT_DOUBLE_EQ(1.0, dets[1]);
+  EXPECT_DOUBLE_EQ(0.0, dets[2]);
+}
+
+TEST(BatchDeterminantTest, BadInput) {
+  double soa[4] = {1.0, 2.0, 3.0, 4.0};
+  double det;
+  EXPECT_EQ(-EINVAL, determinant_batch(soa, 5, 1, &det));
+  EXPECT_EQ(-EINVAL, determinant_batch(NULL, 2, 1, &det));
+  /* An empty batch is fine. */
+  EXPECT_EQ(0, determinant_batch(soa, 2, 0, &det));
+}
+
+/* The closed forms are evaluated by the compiler. */
+constexpr double constexpr_one[1][1] = {{-3.0}};
+constexpr double constexpr_two[2][2] = {{1.0, 2.0}, {3.0, 4.0}};
+constexpr double constexpr_three[3][3] = {
+    {0.0, 2.0, 2.0}, {6.0, 4.0, 10.0}, {6.0, 14.0, 8.0}};
+constexpr double constexpr_four[4][4] = {{1.0, 9.0, 8.0, 7.0},
+                                         {0.0, 2.0, 6.0, 5.0},
+                                         {0.0, 0.0, 3.0, 4.0},
+                                         {0.0, 0.0, 0.0, 4.0}};
+static_assert(-3.0 == matrix::determinant(constexpr_one));
+static_assert(-2.0 == matrix::determinant(constexpr_two));
+static_assert(144.0 == matrix::determinant(constexpr_three));
+static_assert(24.0 == matrix::determinant(constexpr_four));
+
+TEST(TemplateDeterminantTest, MatchesRuntimeSize) {
+  EXPECT_DOUBLE_EQ(determinant(test_matrix), matrix::determinant(test_matrix));
+  double four[4][4];
+  fill_test_matrix(&four[0][0], 4);
+  EXPECT_NEAR(determinant_n(&four[0][0], 4, 4), matrix::determinant(four),
+              1e-14);
+}
+
+TEST(TemplateDeterminantTest, LargeSizesUseLU) {
+  double five[5][5];
+  fill_test_matrix(&five[0][0], 5);
+  EXPECT_EQ(determinant_n(&five[0][0], 5, 5), matrix::determinant(five));
+  static double large[LU_BLOCK_SIZE + 1][LU_BLOCK_SIZE + 1];
+  fill_test_matrix(&large[0][0], LU_BLOCK_SIZE + 1);
+  EXPECT_EQ(determinant_n(&large[0][0], LU_BLOCK_SIZE + 1, LU_BLOCK_SIZE + 1),
+            matrix::determinant(large));
+}
+
+TEST(MinorViewTest, MatchesSubmatrix) {
+  for (int r = 0; r < SIZE; r++) {
+    for (int c = 0; c < SIZE; c++) {
+      double submatrix[4];
+      struct minor_view view;
+      ASSERT_EQ(0, get_submatrix(submatrix, r, c, test_matrix));
+      ASSERT_EQ(0, make_minor_view(&view, &test_matrix[0][0], SIZE, SIZE, r,
+                                   c));
+      for (size_t k = 0; k < 4; k++) {
+        EXPECT_EQ(submatrix[k], minor_element(&view, k / 2, k % 2));
+      }
+      EXPECT_EQ(submatrix_determinant(submatrix), minor_determinant(&view));
+    }
+  }
+}
+
+TEST(MinorViewTest, LargeMinors) {
+  const size_t dim = 7, stride = 9;
+  double matrix[stride * stride];
+  double minor[(dim - 1) * (dim - 1)];
+  fill_test_matrix(matrix, stride);
+  struct minor_view view;
+  ASSERT_EQ(0, make_minor_view(&view, matrix, dim, stride, 2, 5));
+  for (size_t i = 0, k = 0; i < dim; i++) {
+    for (size_t j = 0; j < dim; j++) {
+      if ((2 != i) && (5 != j)) {
+        minor[k++] = matrix[(i * stride) + j];
+      }
+    }
+  }
+  EXPECT_EQ(determinant_n(minor, dim - 1, dim - 1), minor_determinant(&view));
+}
+
+TEST(MinorViewTest, BadInput) {
+  struct minor_view view;
+  EXPECT_EQ(-EINVAL,
+            make_minor_view(&view, &test_matrix[0][0], SIZE, SIZE, SIZE, 0));
+  EXPECT_EQ(-EINVAL,
+            make_minor_view(&view, &test_matrix[0][0], SIZE, SIZE - 1, 0, 0));
+  EXPECT_EQ(-EINVAL, make_minor_view(&view, NULL, SIZE, SIZE, 0, 0));
+  EXPECT_TRUE(std::isnan(minor_determinant(NULL)));
+  double out[SIZE * SIZE];
+  EXPECT_EQ(-EINVAL, cofactor_matrix(&test_matrix[0][0], SIZE, SIZE, NULL));
+  EXPECT_EQ(-EINVAL, adjugate(NULL, SIZE, SIZE, out));
+}
+
+TEST(MinorViewTest, CofactorsOfTestMatrix) {
+  /* C[i][j] = (-1)^(i+j) M[i][j], worked by hand. */
+  const double expected[SIZE * SIZE] = {-108.0, 12.0, 60.0, 12.0, -12.0,
+                                        12.0,   12.0, 12.0, -12.0};
+  double cofactors[SIZE * SIZE];
+  double adj[SIZE * SIZE];
+  ASSERT_EQ(0, cofactor_matrix(&test_matrix[0][0], SIZE, SIZE, cofactors));
+  EXPECT_TRUE(vector_are_equal(expected, cofactors, SIZE * SIZE));
+  ASSERT_EQ(0, adjugate(&test_matrix[0][0], SIZE, SIZE, adj));
+  for (size_t i = 0; i < SIZE; i++) {
+    for (size_t j = 0; j < SIZE; j++) {
+      EXPECT_EQ(cofactors[(i * SIZE) + j], adj[(j * SIZE) + i]);
+    }
+  }
+}
+
+/* A adj(A) = det(A) I, through the closed-form and the LU minors. */
+TEST(MinorViewTest, AdjugateInvertsScaledByDeterminant) {
+  for (size_t dim = 1; dim <= 7; dim++) {
+    std::vector<double> matrix(dim * dim), adj(dim * dim);
+    fill_test_matrix(matrix.data(), dim);
+    ASSERT_EQ(0, adjugate(matrix.data(), dim, dim, adj.data()));
+    const double det = determinant_n(matrix.data(), dim, dim);
+    for (size_t i = 0; i < dim; i++) {
+      for (size_t j = 0; j < dim; j++) {
+        double sum = 0.0;
+        for (size_t k = 0; k < dim; k++) {
+          sum += matrix[(i * dim) + k] * adj[(k * dim) + j];
+        }
+        EXPECT_NEAR((i == j) ? det : 0.0, sum, 1e-12) << dim;
+      }
+    }
+  }
+}
+
+/* Cofactor (i, j) from a copy of the minor, for comparison */
+static double copied_cofactor(const std::vector<double> &matrix,
+                              const size_t dim, const size_t i,
+                              const size_t j) {
+  std::vector<double> minor;
+  for (size_t r = 0; r < dim; r++) {
+    for (size_t c = 0; c < dim; c++) {
+      if ((r != i) && (c != j)) {
+        minor.push_back(matrix[(r * dim) + c]);
+      }
+    }
+  }
+  const double sign = ((i + j) % 2) ? -1.0 : 1.0;
+  return sign * determinant_n(minor.data(), dim - 1, dim - 1);
+}
+
+/*
+ * Above 4 rows the cofactors come from the inverse, or from the minors if the
+ * matrix is singular, as the one with a repeated row is.
+ */
+TEST(MinorViewTest, LargeCofactorsMatchCopiedMinors) {
+  for (size_t dim = 5; dim <= 12; dim++) {
+    for (const bool singular : {false, true}) {
+      std::vector<double> matrix(dim * dim), cofactors(dim * dim),
+          adj(dim * dim);
+      fill_test_matrix(matrix.data(), dim);
+      if (singular) {
+        std::copy(matrix.begin(), matrix.begin() + dim,
+                  matrix.begin() + dim);
+      }
+      ASSERT_EQ(0, cofactor_matrix(matrix.data(), dim, dim, cofactors.data()));
+      ASSERT_EQ(0, adjugate(matrix.data(), dim, dim, adj.data()));
+      double largest = 0.0;
+      for (const double c : cofactors) {
+        largest = std::max(largest, fabs(c));
+      }
+      ASSERT_GT(largest, 0.0);
+      for (size_t i = 0; i < dim; i++) {
+        for (size_t j = 0; j < dim; j++) {
+          const double expected = copied_cofactor(matrix, dim, i, j);
+          EXPECT_NEAR(expected, cofactors[(i * dim) + j], 1e-12 * largest)
+              << dim << (singular ? " singular" : "");
+          EXPECT_EQ(cofactors[(i * dim) + j], adj[(j * dim) + i]);
+        }
+      }
+    }
+  }
+}
+
+TEST(IntegerDeterminantTest, KnownValues) {
+  const int64_t matrix[SIZE * SIZE] = {0, 2, 2, 6, 4, 10, 6, 14, 8};
+  int64_t det = 0;
+  ASSERT_EQ(0, determinant_int64(matrix, SIZE, SIZE, &det));
+  EXPECT_EQ(144, det);
+  /* Zero leading pivot, and a singular matrix. */
+  const int64_t swapped[SIZE * SIZE] = {0, 1, 0, 1, 0, 0, 0, 0, 1};
+  ASSERT_EQ(0, determinant_int64(swapped, SIZE, SIZE, &det));
+  EXPECT_EQ(-1, det);
+  const int64_t singular[SIZE * SIZE] = {1, 2, 3, 2, 4, 6, 7, 8, 9};
+  ASSERT_EQ(0, determinant_int64(singular, SIZE, SIZE, &det));
+  EXPECT_EQ(0, det);
+  ASSERT_EQ(0, determinant_int64(matrix, 0, 0, &det));
+  EXPECT_EQ(1, det);
+}
+
+/* Small-integer matrices, whose determinants doubles also hold exactly. */
+TEST(IntegerDeterminantTest, MatchesFloatingPoint) {
+  uint64_t state = 7;
+  for (size_t dim = 1; dim <= 10; dim++) {
+    std::vector<int64_t> matrix(dim * dim);
+    std::vector<double> real(dim * dim);
+    for (size_t k = 0; k < dim * dim; k++) {
+      state = (state * 6364136223846793005ULL) + 1442695040888963407ULL;
+      matrix[k] = (int64_t)(state >> 61) - 3;
+      real[k] = (double)matrix[k];
+    }
+    int64_t det;
+    ASSERT_EQ(0, determinant_int64(matrix.data(), dim, dim, &det));
+    EXPECT_EQ(std::round(determinant_n(real.data(), dim, dim)), (double)det)
+        << dim;
+  }
+}
+
+/*
+ * The 2x2 products overflow 64 bits, but the determinant does not, so the
+ * 128-bit path must take over.
+ */
+TEST(IntegerDeterminantTest, WideIntermediates) {
+  const int64_t big = INT64_C(1) << 40;
+  const int64_t matrix[4] = {big + 1, big, big, big - 1};
+  int64_t det = 0;
+  ASSERT_EQ(0, determinant_int64(matrix, 2, 2, &det));
+  EXPECT_EQ(-1, det);
+}
+
+TEST(IntegerDeterminantTest, Overflow) {
+  const int64_t big = INT64_C(1) << 32;
+  const int64_t diagonal[4] = {big, 0, 0, big};
+  int64_t det = 42;
+  EXPECT_EQ(-ERANGE, determinant_int64(diagonal, 2, 2, &det));
+  EXPECT_EQ(42, det);
+  /* -INT64_MIN after a row swap. */
+  const int64_t swapped[4] = {0, INT64_MIN, 1, 0};
+  EXPECT_EQ(-ERANGE, determinant_int64(swapped, 2, 2, &det));
+  const int64_t unswapped[4] = {1, 0, 0, INT64_MIN};
+  ASSERT_EQ(0, determinant_int64(unswapped, 2, 2, &det));
+  EXPECT_EQ(INT64_MIN, det);
+}
+
+TEST(IntegerDeterminantTest, BadInput) {
+  int64_t det;
+  const int64_t matrix[4] = {1, 2, 3, 4};
+  EXPECT_EQ(-EINVAL, determinant_int64(NULL, 2, 2, &det));
+  EXPECT_EQ(-EINVAL, determinant_int64(matrix, 2, 2, NULL));
+  EXPECT_EQ(-EINVAL, determinant_int64(matrix, 2, 1, &det));
+}
+
+#ifdef __SIZEOF_INT128__
+TEST(IntegerDeterminantTest, WideResult) {
+  const int64_t big = INT64_C(1) << 32;
+  const __int128 one = 1;
+  __int128 det = 0;
+  const int64_t diagonal[4] = {big, 0, 0, big};
+  ASSERT_EQ(0, determinant_int128(diagonal, 2, 2, &det));
+  EXPECT_TRUE((one << 64) == det);
+  /* Within 64 bits the narrow result is returned unchanged. */
+  const int64_t matrix[4] = {1, 2, 3, 4};
+  ASSERT_EQ(0, determinant_int128(matrix, 2, 2, &det));
+  EXPECT_TRUE(-2 == det);
+  const int64_t huge = INT64_C(1) << 40;
+  const int64_t triangular[9] = {huge, 1, 1, 0, huge, 1, 0, 0, 3};
+  ASSERT_EQ(0, determinant_int128(triangular, 3, 3, &det));
+  EXPECT_TRUE(3 * (one << 80) == det);
+  /* A row swap negates the wide result too. */
+  const int64_t swapped[9] = {0, huge, 0, huge, 0, 0, 0, 0, 3};
+  ASSERT_EQ(0, determinant_int128(swapped, 3, 3, &det));
+  EXPECT_TRUE(-3 * (one << 80) == det);
+  const int64_t singular[9] = {huge, huge, 1, huge, huge, 1, 0, huge, 1};
+  ASSERT_EQ(0, determinant_int128(singular, 3, 3, &det));
+  EXPECT_TRUE(0 == det);
+}
+
+TEST(IntegerDeterminantTest, WideOverflow) {
+  const int64_t big = INT64_C(1) << 62;
+  const int64_t diagonal[9] = {big, 0, 0, 0, big, 0, 0, 0, big};
+  __int128 det = 42;
+  EXPECT_EQ(-ERANGE, determinant_int128(diagonal, 3, 3, &det));
+  EXPECT_TRUE(42 == det);
+  const int64_t matrix[4] = {1, 2, 3, 4};
+  EXPECT_EQ(-EINVAL, determinant_int128(NULL, 2, 2, &det));
+  EXPECT_EQ(-EINVAL, determinant_int128(matrix, 2, 2, NULL));
+  EXPECT_EQ(-EINVAL, determinant_int128(matrix, 2, 1, &det));
+}
+#endif
+
+TEST(SlogdetTest, MatchesDeterminant) {
+  int sign;
+  double logabsdet;
+  ASSERT_EQ(0, slogdet_n(&test_matrix[0][0], SIZE, SIZE, 1, &sign,
+                         &logabsdet));
+  EXPECT_EQ(1, sign);
+  EXPECT_DOUBLE_EQ(std::log(144.0), logabsdet);
+  for (size_t dim = 1; dim <= 2 * LU_BLOCK_SIZE; dim += 13) {
+    std::vector<double> matrix(dim * dim);
+    fill_test_matrix(matrix.data(), dim);
+    const double det = determinant_n(matrix.data(), dim, dim);
+    ASSERT_EQ(0, slogdet_n(matrix.data(), dim, dim, 1, &sign, &logabsdet));
+    EXPECT_EQ((det > 0.0) ? 1 : -1, sign) << dim;
+    EXPECT_NEAR(std::log(std::fabs(det)), logabsdet, 1e-9) << dim;
+  }
+}
+
+/* Diagonal matrices whose determinants are far outside the range of double. */
+TEST(SlogdetTest, OverflowAndUnderflow) {
+  const size_t dim = 3 * LU_BLOCK_SIZE;
+  const double scales[] = {1e10, 1e-10};
+  for (const double scale : scales) {
+    std::vector<double> matrix(dim * dim, 0.0);
+    for (size_t k = 0; k < dim; k++) {
+      matrix[(k * dim) + k] = (k % 2) ? -scale : scale;
+    }
+    const double det = determinant_n(matrix.data(), dim, dim);
+    EXPECT_TRUE(std::isinf(det) || (0.0 == det));
+    int sign;
+    double logabsdet;
+    ASSERT_EQ(0, slogdet_n(matrix.data(), dim, dim, 2, &sign, &logabsdet));
+    EXPECT_EQ(((dim / 2) % 2) ? -1 : 1, sign);
+    EXPECT_NEAR(dim * std::log(scale), logabsdet,
+                1e-12 * std::fabs(logabsdet));
+  }
+}
+
+TEST(SlogdetTest, Singular) {
+  const double singular[SIZE * SIZE] = {1, 2, 3, 2, 4, 6, 7, 8, 9};
+  int sign = 1;
+  double logabsdet = 0.0;
+  ASSERT_EQ(0, slogdet_n(singular, SIZE, SIZE, 1, &sign, &logabsdet));
+  EXPECT_EQ(0, sign);
+  EXPECT_EQ(-INFINITY, logabsdet);
+}
+
+TEST(SlogdetTest, BadInput) {
+  int sign;
+  double logabsdet;
+  EXPECT_EQ(-EINVAL, slogdet_n(NULL, SIZE, SIZE, 1, &sign, &logabsdet));
+  EXPECT_EQ(-EINVAL, slogdet_n(&test_matrix[0][0], SIZE, SIZE - 1, 1, &sign,
+                               &logabsdet));
+  EXPECT_EQ(-EINVAL,
+            slogdet_n(&test_matrix[0][0], SIZE, SIZE, 0, &sign, &logabsdet));
+  EXPECT_EQ(-EINVAL,
+            slogdet_n(&test_matrix[0][0], SIZE, SIZE, 1, NULL, &logabsdet));
+}
+
+TEST(FloatDeterminantTest, MatchesDouble) {
+  const float square[SIZE * SIZE] = {1, 2, 3, 4, 5, 6, 7, 8, 9};
+  EXPECT_NEAR(0.0f, determinant_float(square, SIZE, SIZE), 1e-5f);
+  for (size_t dim = 1; dim <= 2 * LU_BLOCK_SIZE + 5; dim += 11) {
+    std::vector<double> matrix(dim * dim);
+    fill_test_matrix(matrix.data(), dim);
+    std::vector<float> rounded(matrix.begin(), matrix.end());
+    int sign, float_sign, mixed_sign;
+    double logabsdet, float_logabsdet, mixed_logabsdet;
+    ASSERT_EQ(0, slogdet_n(matrix.data(), dim, dim, 1, &sign, &logabsdet));
+    ASSERT_EQ(0, slogdet_float(rounded.data(), dim, dim, &float_sign,
+                               &float_logabsdet));
+    ASSERT_EQ(0, slogdet_mixed(matrix.data(), dim, dim, &mixed_sign,
+                               &mixed_logabsdet));
+    EXPECT_EQ(sign, float_sign) << dim;
+    EXPECT_EQ(sign, mixed_sign) << dim;
+    /* Both round the same matrix to float, and so agree exactly. */
+    EXPECT_EQ(float_logabsdet, mixed_logabsdet) << dim;
+    /* An error of 1e-7 per pivot, grown by the condition of the matrix. */
+    EXPECT_NEAR(logabsdet, mixed_logabsdet, 1e-4 * dim) << dim;
+    const float det = determinant_float(rounded.data(), dim, dim);
+    if (logabsdet < std::log(FLT_MAX)) {
+      EXPECT_NEAR(sign * std::exp(logabsdet), det,
+                  1e-4 * dim * std::exp(logabsdet))
+          << dim;
+    } else {
+      /* The product of the pivots overflows, unlike their sum of logs. */
+      EXPECT_TRUE(std::isinf(det)) << dim;
+    }
+  }
+}
+
+TEST(FloatDeterminantTest, Singular) {
+  const float singular[SIZE * SIZE] = {1, 2, 3, 2, 4, 6, 7, 8, 9};
+  int sign = 1;
+  double logabsdet = 0.0;
+  EXPECT_EQ(0.0f, determinant_float(singular, SIZE, SIZE));
+  ASSERT_EQ(0, slogdet_float(singular, SIZE, SIZE, &sign, &logabsdet));
+  EXPECT_EQ(0, sign);
+  EXPECT_EQ(-INFINITY, logabsdet);
+}
+
+TEST(FloatDeterminantTest, BadInput) {
+  const float matrix[4] = {1, 2, 3, 4};
+  int sign;
+  double logabsdet;
+  EXPECT_TRUE(std::isnan(determinant_float(NULL, 2, 2)));
+  EXPECT_TRUE(std::isnan(determinant_float(matrix, 2, 1)));
+  EXPECT_EQ(-EINVAL, slogdet_float(matrix, 2, 2, NULL, &logabsdet));
+  EXPECT_EQ(-EINVAL, slogdet_mixed(NULL, 2, 2, &sign, &logabsdet));
+  EXPECT_EQ(-EINVAL, lu_factor_float(NULL, 2, 2, NULL, &sign));
+}
+
+class TrackerTest : public ::testing::Test {
+protected:
+  static const size_t dim = 12;
+  std::vector<double> matrix;
+  struct determinant_tracker tracker;
+
+  void SetUp() override {
+    matrix.resize(dim * dim);
+    fill_test_matrix(matrix.data(), dim);
+    ASSERT_EQ(0, initialize_tracker(&tracker, matrix.data(), dim, dim, 1000));
+  }
+  void TearDown() override { release_tracker_resources(&tracker); }
+
+  void ExpectTracksMatrix(const double tolerance) {
+    ASSERT_TRUE(vector_are_equal(matrix.data(), tracker.matrix, dim * dim));
+    const double det = determinant_n(matrix.data(), dim, dim);
+    EXPECT_NEAR(det, tracker.det, tolerance * std::fabs(det));
+  }
+};
+
+TEST_F(TrackerTest, ReplaceRowsAndColumns) {
+  std::vector<double> values(dim);
+  for (size_t step = 0; step < 40; step++) {
+    for (size_t k = 0; k < dim; k++) {
+      values[k] = matrix[(((step + 1) * 5) % (dim * dim))] + (0.1 * k) -
+                  (0.01 * step);
+    }
+    const size_t index = (step * 7) % dim;
+    if (step % 2) {
+      ASSERT_EQ(0, replace_row(&tracker, index, values.data()));
+      std::copy(values.begin(), values.end(), matrix.begin() + (index * dim));
+    } else {
+      ASSERT_EQ(0, replace_column(&tracker, index, values.data()));
+      for (size_t i = 0; i < dim; i++) {
+        matrix[(i * dim) + index] = values[i];
+      }
+    }
+    ExpectTracksMatrix(1e-8);
+  }
+  EXPECT_EQ(40U, tracker.updates);
+}
+
+TEST_F(TrackerTest, RankOneUpdateKeepsInverse) {
+  std::vector<double> u(dim), v(dim);
+  for (size_t k = 0; k < dim; k++) {
+    u[k] = 0.5 - (0.1 * k);
+    v[k] = 0.05 * k;
+  }
+  ASSERT_EQ(0, rank1_update(&tracker, u.data(), v.data()));
+  for (size_t i = 0; i < dim; i++) {
+    for (size_t j = 0; j < dim; j++) {
+      matrix[(i * dim) + j] += u[i] * v[j];
+    }
+  }
+  for (size_t i = 0; i < dim; i++) {
+    for (size_t j = 0; j < dim; j++) {
+      double sum = 0.0;
+      for (size_t k = 0; k < dim; k++) {
+        sum += matrix[(i * dim) + k] * tracker.inverse[(k * dim) + j];
+      }
+      EXPECT_NEAR((i == j) ? 1.0 : 0.0, sum, 1e-9);
+    }
+  }
+  const double det = determinant_n(matrix.data(), dim, dim);
+  EXPECT_NEAR(det, tracker.det, 1e-9 * std::fabs(det));
+}
+
+TEST_F(TrackerTest, RefactorsPeriodically) {
+  release_tracker_resources(&tracker);
+  ASSERT_EQ(0, initialize_tracker(&tracker, matrix.data(), dim, dim, 3));
+  std::vector<double> row(matrix.begin(), matrix.begin() + dim);
+  for (size_t step = 1; step <= 7; step++) {
+    row[step] += 0.25;
+    ASSERT_EQ(0, replace_row(&tracker, 0, row.data()));
+    EXPECT_EQ(step % 3, tracker.updates);
+  }
+  std::copy(row.begin(), row.end(), matrix.begin());
+  ExpectTracksMatrix(1e-12);
+}
+
+/* A duplicated row, and then the original one restored. */
+TEST_F(TrackerTest, PassesThroughSingular) {
+  const std::vector<double> original(matrix.begin(), matrix.begin() + dim);
+  ASSERT_EQ(0, replace_row(&tracker, 0, matrix.data() + dim));
+  EXPECT_TRUE(tracker.singular);
+  EXPECT_EQ(0.0, tracker.det);
+  ASSERT_EQ(0, replace_row(&tracker, 0, original.data()));
+  EXPECT_FALSE(tracker.singular);
+  ExpectTracksMatrix(1e-12);
+}
+
+TEST_F(TrackerTest, BadInput) {
+  struct determinant_tracker other;
+  const double values[dim] = {};
+  EXPECT_EQ(-EINVAL, initialize_tracker(&other, NULL, dim, dim, 1));
+  EXPECT_EQ(-EINVAL, initialize_tracker(&other, matrix.data(), dim, dim, 0));
+  EXPECT_EQ(-EINVAL,
+            initialize_tracker(&other, matrix.data(), dim, dim - 1, 1));
+  EXPECT_EQ(-EINVAL, replace_row(&tracker, dim, values));
+  EXPECT_EQ(-EINVAL, replace_column(&tracker, 0, NULL));
+  EXPECT_EQ(-EINVAL, rank1_update(&tracker, values, NULL));
+}
+
+/* Compressed sparse column form of a dense row-major matrix. */
+struct csc {
+  std::vector<size_t> starts;
+  std::vector<size_t> indices;
+  std::vector<double> values;
+  struct sparse_matrix matrix;
+
+  csc(const double *dense, const size_t dim) : starts(1, 0) {
+    for (size_t j = 0; j < dim; j++) {
+      for (size_t i = 0; i < dim; i++) {
+        if (0.0 != dense[(i * dim) + j]) {
+          indices.push_back(i);
+          values.push_back(dense[(i * dim) + j]);
+        }
+      }
+      starts.push_back(indices.size());
+    }
+    matrix = {dim, starts.data(), indices.data(), values.data()};
+  }
+};
+
+TEST(SparseDeterminantTest, MatchesDense) {
+  const csc small(&test_matrix[0][0], SIZE);
+  EXPECT_NEAR(144.0, sparse_determinant(&small.matrix), 1e-12);
+  const size_t dim = 40;
+  std::vector<double> dense(dim * dim), transpose(dim * dim);
+  fill_test_matrix(dense.data(), dim);
+  /* Keep the diagonal and about one other entry in five. */
+  for (size_t i = 0; i < dim; i++) {
+    for (size_t j = 0; j < dim; j++) {
+      if ((i != j) && ((i * 3) + (j * 7)) % 5) {
+        dense[(i * dim) + j] = 0.0;
+      }
+    }
+  }
+  for (size_t i = 0; i < dim; i++) {
+    for (size_t j = 0; j < dim; j++) {
+      transpose[(j * dim) + i] = dense[(i * dim) + j];
+    }
+  }
+  const double det = determinant_n(dense.data(), dim, dim);
+  const csc columns(dense.data(), dim), rows(transpose.data(), dim);
+  const enum sparse_ordering orderings[] = {SPARSE_NATURAL,
+                                            SPARSE_MINIMUM_DEGREE};
+  for (const enum sparse_ordering ordering : orderings) {
+    for (const csc *matrix : {&columns, &rows}) {
+      int sign;
+      double logabsdet;
+      ASSERT_EQ(0, sparse_slogdet(&matrix->matrix, ordering, &sign,
+                                  &logabsdet, NULL));
+      EXPECT_EQ((det > 0.0) ? 1 : -1, sign);
+      EXPECT_NEAR(std::log(std::fabs(det)), logabsdet, 1e-10);
+    }
+  }
+}
+
+/* The pivots must come off the diagonal, and the entries are duplicated. */
+TEST(SparseDeterminantTest, PermutationAndDuplicates) {
+  /* Column j has a 1 in row (j + 1) % 4, split into two halves. */
+  const size_t starts[] = {0, 2, 4, 6, 8};
+  const size_t indices[] = {1, 1, 2, 2, 3, 3, 0, 0};
+  const double values[] = {0.5, 0.5, 0.25, 0.75, 1.0, 0.0, 2.0, -1.0};
+  const struct sparse_matrix matrix = {4, starts, indices, values};
+  /* A 4-cycle is an odd permutation. */
+  EXPECT_DOUBLE_EQ(-1.0, sparse_determinant(&matrix));
+}
+
+TEST(SparseDeterminantTest, Singular) {
+  const size_t starts[] = {0, 1, 1, 2};
+  const size_t indices[] = {0, 2};
+  const double values[] = {1.0, 1.0};
+  const struct sparse_matrix matrix = {3, starts, indices, values};
+  int sign = 1;
+  double logabsdet = 0.0;
+  ASSERT_EQ(0, sparse_slogdet(&matrix, SPARSE_MINIMUM_DEGREE, &sign,
+                              &logabsdet, NULL));
+  EXPECT_EQ(0, sign);
+  EXPECT_EQ(-INFINITY, logabsdet);
+}
+
+/* Tridiagonal with 2 on the diagonal and -1 beside it has det n + 1. */
+TEST(SparseDeterminantTest, Tridiagonal) {
+  const size_t dim = 100000;
+  std::vector<size_t> starts(1, 0), indices;
+  std::vector<double> values;
+  for (size_t j = 0; j < dim; j++) {
+    for (size_t i = (j ? j - 1 : 0); i <= std::min(j + 1, dim - 1); i++) {
+      indices.push_back(i);
+      values.push_back((i == j) ? 2.0 : -1.0);
+    }
+    starts.push_back(indices.size());
+  }
+  const struct sparse_matrix matrix = {dim, starts.data(), indices.data(),
+                                       values.data()};
+  int sign;
+  double logabsdet;
+  size_t fill;
+  ASSERT_EQ(0, sparse_slogdet(&matrix, SPARSE_MINIMUM_DEGREE, &sign,
+                              &logabsdet, &fill));
+  EXPECT_EQ(1, sign);
+  EXPECT_NEAR(std::log(dim + 1.0), logabsdet, 1e-9);
+  EXPECT_EQ(indices.size(), fill);
+}
+
+/*
+ * An arrowhead matrix with a full first row and column fills in completely
+ * in the natural order, but not at all if the first column comes last.
+ */
+TEST(SparseDeterminantTest, MinimumDegreeAvoidsFill) {
+  const size_t dim = 200;
+  std::vector<double> dense(dim * dim, 0.0);
+  for (size_t k = 0; k < dim; k++) {
+    dense[k] = 1.0;
+    dense[k * dim] = 1.0;
+    dense[(k * dim) + k] = 4.0;
+  }
+  const csc arrow(dense.data(), dim);
+  int sign[2];
+  double logabsdet[2];
+  size_t fill[2];
+  ASSERT_EQ(0, sparse_slogdet(&arrow.matrix, SPARSE_NATURAL, &sign[0],
+                              &logabsdet[0], &fill[0]));
+  ASSERT_EQ(0, sparse_slogdet(&arrow.matrix, SPARSE_MINIMUM_DEGREE, &sign[1],
+                              &logabsdet[1], &fill[1]));
+  EXPECT_EQ(dim * dim, fill[0]);
+  EXPECT_EQ(arrow.indices.size(), fill[1]);
+  EXPECT_EQ(sign[0], sign[1]);
+  EXPECT_NEAR(logabsdet[0], logabsdet[1], 1e-10);
+}
+
+TEST(SparseDeterminantTest, BadInput) {
+  const size_t starts[] = {0, 1, 2};
+  const size_t unsorted[] = {0, 2, 1};
+  const size_t indices[] = {0, 2};
+  const double values[] = {1.0, 1.0};
+  int sign;
+  double logabsdet;
+  struct sparse_matrix matrix = {2, starts, indices, values};
+  EXPECT_EQ(-EINVAL, sparse_slogdet(&matrix, SPARSE_NATURAL, &sign,
+                                    &logabsdet, NULL));
+  matrix.starts = unsorted;
+  EXPECT_EQ(-EINVAL, sparse_slogdet(&matrix, SPARSE_NATURAL, &sign,
+                                    &logabsdet, NULL));
+  EXPECT_EQ(-EINVAL, sparse_slogdet(NULL, SPARSE_NATURAL, &sign, &logabsdet,
+                                    NULL));
+  EXPECT_TRUE(std::isnan(sparse_determinant(NULL)));
+}
+
+class FactorizationTest : public ::testing::Test {
+protected:
+  /* Above one block, so that the blocked factorization records the pivots. */
+  static const size_t dim = LU_BLOCK_SIZE + 9;
+  std::vector<double> matrix;
+  struct lu_factorization lu;
+
+  void SetUp() override {
+    matrix.resize(dim * dim);
+    fill_test_matrix(matrix.data(), dim);
+    ASSERT_EQ(0, initialize_lu(&lu, dim));
+    ASSERT_EQ(0, lu_factorize(&lu, matrix.data(), dim));
+  }
+  void TearDown() override { release_lu_resources(&lu); }
+};
+
+TEST_F(FactorizationTest, Determinant) {
+  EXPECT_EQ(determinant_n(matrix.data(), dim, dim), lu_determinant(&lu));
+}
+
+TEST_F(FactorizationTest, SolveManyRightHandSides) {
+  /* The last column is padding, to exercise ldb. */
+  const size_t nrhs = 5, ldb = nrhs + 1;
+  std::vector<double> x(dim * ldb), b(dim * ldb, 0.0);
+  for (size_t i = 0; i < dim; i++) {
+    for (size_t j = 0; j < nrhs; j++) {
+      x[(i * ldb) + j] = std::sin((double)((i * nrhs) + j));
+    }
+  }
+  for (size_t i = 0; i < dim; i++) {
+    for (size_t k = 0; k < dim; k++) {
+      for (size_t j = 0; j < nrhs; j++) {
+        b[(i * ldb) + j] += matrix[(i * dim) + k] * x[(k * ldb) + j];
+      }
+    }
+    b[(i * ldb) + nrhs] = 42.0;
+  }
+  ASSERT_EQ(0, lu_solve(&lu, b.data(), nrhs, ldb));
+  for (size_t i = 0; i < dim; i++) {
+    for (size_t j = 0; j < nrhs; j++) {
+      EXPECT_NEAR(x[(i * ldb) + j], b[(i * ldb) + j], 1e-9);
+    }
+    EXPECT_EQ(42.0, b[(i * ldb) + nrhs]);
+  }
+}
+
+/* A single right-hand side takes a separate path. */
+TEST_F(FactorizationTest, SolveOneRightHandSide) {
+  const size_t ldb = 3;
+  std::vector<double> b(dim * ldb, 0.0);
+  for (size_t i = 0; i < dim; i++) {
+    for (size_t k = 0; k < dim; k++) {
+      b[i * ldb] += matrix[(i * dim) + k] * (double)k;
+    }
+  }
+  ASSERT_EQ(0, lu_solve(&lu, b.data(), 1, ldb));
+  for (size_t i = 0; i < dim; i++) {
+    EXPECT_NEAR((double)i, b[i * ldb], 1e-9);
+  }
+}
+
+TEST_F(FactorizationTest, Inverse) {
+  std::vector<double> inverse(dim * dim);
+  ASSERT_EQ(0, lu_inverse(&lu, inverse.data()));
+  for (size_t i = 0; i < dim; i++) {
+    for (size_t j = 0; j < dim; j++) {
+      double sum = 0.0;
+      for (size_t k = 0; k < dim; k++) {
+        sum += matrix[(i * dim) + k] * inverse[(k * dim) + j];
+      }
+      EXPECT_NEAR((i == j) ? 1.0 : 0.0, sum, 1e-9);
+    }
+  }
+}
+
+/* The handle is reused for a second, singular, matrix. */
+TEST_F(FactorizationTest, Singular) {
+  std::copy(matrix.begin(), matrix.begin() + dim, matrix.begin() + dim);
+  ASSERT_EQ(0, lu_factorize(&lu, matrix.data(), dim));
+  EXPECT_EQ(0.0, lu_determinant(&lu));
+  std::vector<double> b(dim, 1.0);
+  EXPECT_EQ(-EDOM, lu_solve(&lu, b.data(), 1, 1));
+  EXPECT_EQ(-EDOM, lu_inverse(&lu, matrix.data()));
+}
+
+TEST_F(FactorizationTest, BadInput) {
+  struct lu_factorization other;
+  double b[dim];
+  EXPECT_EQ(-EINVAL, initialize_lu(&other, 0));
+  EXPECT_EQ(-EINVAL, lu_factorize(&lu, matrix.data(), dim - 1));
+  EXPECT_EQ(-EINVAL, lu_factorize(&lu, NULL, dim));
+  EXPECT_EQ(-EINVAL, lu_solve(&lu, NULL, 1, 1));
+  EXPECT_EQ(-EINVAL, lu_solve(&lu, b, 2, 1));
+  EXPECT_EQ(-EINVAL, lu_inverse(&lu, NULL));
+  EXPECT_TRUE(std::isnan(lu_determinant(NULL)));
+}
+
+/* M = [A B; C D], with A the leading split x split block */
+class SchurTest : public ::testing::Test {
+protected:
+  static const size_t dim = 100, split = 70;
+  std::vector<double> matrix;
+  struct lu_factorization lu;
+
+  void SetUp() override {
+    matrix.resize(dim * dim);
+    fill_test_matrix(matrix.data(), dim);
+    ASSERT_EQ(0, initialize_lu(&lu, split));
+    ASSERT_EQ(0, lu_factorize(&lu, matrix.data(), dim));
+  }
+  void TearDown() override { release_lu_resources(&lu); }
+
+  void ExpectWholeDeterminant() {
+    const double det = determinant_n(matrix.data(), dim, dim);
+    int sign;
+    double logabsdet;
+    EXPECT_NEAR(det, schur_determinant(&lu, matrix.data(), dim, dim),
+                1e-10 * std::fabs(det));
+    ASSERT_EQ(0, schur_slogdet(&lu, matrix.data(), dim, dim, &sign,
+                               &logabsdet));
+    EXPECT_EQ((det > 0.0) ? 1 : -1, sign);
+    EXPECT_NEAR(std::log(std::fabs(det)), logabsdet, 1e-10);
+  }
+};
+
+TEST_F(SchurTest, MatchesWholeMatrix) { ExpectWholeDeterminant(); }
+
+/* B, C and D change without refactoring A. */
+TEST_F(SchurTest, ChangedBlocks) {
+  std::vector<double> other(dim * dim);
+  fill_test_matrix(other.data(), dim);
+  for (size_t i = 0; i < dim; i++) {
+    for (size_t j = (i < split) ? split : 0; j < dim; j++) {
+      matrix[(i * dim) + j] = other[(j * dim) + i];
+    }
+  }
+  ExpectWholeDeterminant();
+}
+
+TEST_F(SchurTest, DiagonalBlock) {
+  std::vector<double> diagonal(split);
+  for (size_t i = 0; i < split; i++) {
+    for (size_t j = 0; j < split; j++) {
+      matrix[(i * dim) + j] = (i == j) ? (i % 3) - 1.5 : 0.0;
+    }
+    diagonal[i] = matrix[(i * dim) + i];
+  }
+  ASSERT_EQ(0, lu_factorize_diagonal(&lu, diagonal.data()));
+  ExpectWholeDeterminant();
+}
+
+/* With no B, C or D, the determinant is that of A. */
+TEST_F(SchurTest, EmptyComplement) {
+  int sign;
+  double logabsdet;
+  EXPECT_EQ(lu_determinant(&lu),
+            schur_determinant(&lu, matrix.data(), split, dim));
+  ASSERT_EQ(0, schur_slogdet(&lu, matrix.data(), split, dim, &sign,
+                             &logabsdet));
+  EXPECT_NEAR(std::log(std::fabs(lu_determinant(&lu))), logabsdet, 1e-12);
+}
+
+TEST_F(SchurTest, SingularBlocks) {
+  int sign;
+  double logabsdet;
+  /* A zero row of [C D] is a zero row of the complement. */
+  std::fill(matrix.begin() + (split * dim),
+            matrix.begin() + ((split + 1) * dim), 0.0);
+  ASSERT_EQ(0, schur_slogdet(&lu, matrix.data(), dim, dim, &sign,
+                             &logabsdet));
+  EXPECT_EQ(0, sign);
+  EXPECT_EQ(-INFINITY, logabsdet);
+  /* A itself singular */
+  std::copy(matrix.begin(), matrix.begin() + dim, matrix.begin() + dim);
+  ASSERT_EQ(0, lu_factorize(&lu, matrix.data(), dim));
+  EXPECT_EQ(-EDOM, schur_slogdet(&lu, matrix.data(), dim, dim, &sign,
+                                 &logabsdet));
+  EXPECT_TRUE(std::isnan(schur_determinant(&lu, matrix.data(), dim, dim)));
+}
+
+TEST_F(SchurTest, BadInput) {
+  int sign;
+  double logabsdet;
+  EXPECT_EQ(-EINVAL, schur_slogdet(&lu, matrix.data(), split - 1, dim, &sign,
+                                   &logabsdet));
+  EXPECT_EQ(-EINVAL, schur_slogdet(&lu, matrix.data(), dim, dim - 1, &sign,
+                                   &logabsdet));
+  EXPECT_EQ(-EINVAL, schur_slogdet(NULL, matrix.data(), dim, dim, &sign,
+                                   &logabsdet));
+  EXPECT_EQ(-EINVAL,
+            schur_slogdet(&lu, matrix.data(), dim, dim, NULL, &logabsdet));
+  EXPECT_TRUE(std::isnan(schur_determinant(&lu, NULL, dim, dim)));
+  EXPECT_EQ(-EINVAL, lu_factorize_diagonal(&lu, NULL));
+}
+
+class MatrixFileTest : public ::testing::Test {
+protected:
+  char path[32];
+
+  void SetUp() override {
+    strcpy(path, "/tmp/matrix-fileXXXXXX");
+    const int fd = mkstemp(path);
+    ASSERT_LE(0, fd);
+    close(fd);
+  }
+  void TearDown() override { unlink(path); }
+
+  /* Overwrite part of the header of the file written by a test. */
+  void Patch(const size_t offset, const void *bytes, const size_t len) {
+    FILE *file = fopen(path, "r+");
+    ASSERT_NE(nullptr, file);
+    fseek(file, offset, SEEK_SET);
+    fwrite(bytes, len, 1, file);
+    fclose(file);
+  }
+};
+
+TEST_F(MatrixFileTest, RoundTrip) {
+  /* test_matrix in the first 3 columns of a wider array */
+  const double wide[SIZE][SIZE + 2] = {{0.0, 2.0, 2.0, 99.0, 99.0},
+                                       {6.0, 4.0, 10.0, 99.0, 99.0},
+                                       {6.0, 14.0, 8.0, 99.0, 99.0}};
+  ASSERT_EQ(0, write_matrix_file(path, wide, MATRIX_FLOAT64, SIZE, SIZE,
+                                 SIZE + 2));
+  struct mapped_matrix matrix;
+  ASSERT_EQ(0, map_matrix_file(path, &matrix));
+  EXPECT_EQ(0U, (uintptr_t)matrix.data % MATRIX_FILE_ALIGNMENT);
+  EXPECT_EQ((uint64_t)SIZE, matrix.header->rows);
+  EXPECT_EQ((uint64_t)SIZE, matrix.header->stride);
+  EXPECT_TRUE(vector_are_equal(&test_matrix[0][0],
+                               (const double *)matrix.data, SIZE * SIZE));
+  EXPECT_DOUBLE_EQ(144.0, mapped_determinant(&matrix));
+  unmap_matrix_file(&matrix);
+  EXPECT_EQ(nullptr, matrix.map);
+}
+
+TEST_F(MatrixFileTest, ColumnMajorAndInteger) {
+  const int64_t integers[SIZE * SIZE] = {0, 2, 2, 6, 4, 10, 6, 14, 8};
+  ASSERT_EQ(0, write_matrix_file(path, integers, MATRIX_INT64, SIZE, SIZE,
+                                 SIZE));
+  struct mapped_matrix matrix;
+  ASSERT_EQ(0, map_matrix_file(path, &matrix));
+  EXPECT_EQ(144.0, mapped_determinant(&matrix));
+  unmap_matrix_file(&matrix);
+  /* The transpose has the same determinant. */
+  const uint32_t layout = MATRIX_COLUMN_MAJOR;
+  Patch(offsetof(struct matrix_file_header, layout), &layout, sizeof(layout));
+  ASSERT_EQ(0, map_matrix_file(path, &matrix));
+  EXPECT_EQ(144.0, mapped_determinant(&matrix));
+  unmap_matrix_file(&matrix);
+}
+
+TEST_F(MatrixFileTest, BadFiles) {
+  struct mapped_matrix matrix;
+  /* empty */
+  EXPECT_EQ(-EINVAL, map_matrix_file(path, &matrix));
+  EXPECT_EQ(-ENOENT, map_matrix_file("/nonexistent/matrix", &matrix));
+  ASSERT_EQ(0, write_matrix_file(path, test_matrix, MATRIX_FLOAT64, SIZE,
+                                 SIZE, SIZE));
+  /* More rows than the file holds */
+  const uint64_t rows = SIZE + 1;
+  Patch(offsetof(struct matrix_file_header, rows), &rows, sizeof(rows));
+  EXPECT_EQ(-EINVAL, map_matrix_file(path, &matrix));
+  EXPECT_EQ(nullptr, matrix.map);
+  const uint64_t square = SIZE;
+  Patch(offsetof(struct matrix_file_header, rows), &square, sizeof(square));
+  ASSERT_EQ(0, map_matrix_file(path, &matrix));
+  unmap_matrix_file(&matrix);
+  /* Misaligned data */
+  const uint64_t offset = MATRIX_FILE_ALIGNMENT + 8;
+  Patch(offsetof(struct matrix_file_header, data_offset), &offset,
+        sizeof(offset));
+  EXPECT_EQ(-EINVAL, map_matrix_file(path, &matrix));
+  Patch(0, "NOTMATRX", 8);
+  EXPECT_EQ(-EINVAL, map_matrix_file(path, &matrix));
+  EXPECT_EQ(-EINVAL, write_matrix_file(path, test_matrix, MATRIX_FLOAT64,
+                                       SIZE, SIZE, SIZE - 1));
+}
+
+/*
+ * Larger matrices are factored in the mapping, which then reverts, so that a
+ * second call sees the original data, with and without blocking.
+ */
+TEST_F(MatrixFileTest, FactoredInPlace) {
+  for (const size_t dim : {(size_t)SIZE + 1, 2 * (size_t)LU_BLOCK_SIZE + 5}) {
+    std::vector<double> source(dim * dim);
+    fill_test_matrix(source.data(), dim);
+    ASSERT_EQ(0, write_matrix_file(path, source.data(), MATRIX_FLOAT64, dim,
+                                   dim, dim));
+    struct mapped_matrix matrix;
+    ASSERT_EQ(0, map_matrix_file(path, &matrix));
+    const double expected = determinant_n(source.data(), dim, dim);
+    const double first = mapped_determinant(&matrix);
+    const double second = mapped_determinant(&matrix);
+    EXPECT_EQ(expected, first) << dim;
+    EXPECT_EQ(first, second) << dim;
+    EXPECT_TRUE(vector_are_equal(source.data(), (const double *)matrix.data,
+                                 dim * dim))
+        << dim;
+    unmap_matrix_file(&matrix);
+  }
+}
+
+/* The loader accepts rectangular matrices, which have no determinant. */
+TEST_F(MatrixFileTest, Rectangular) {
+  ASSERT_EQ(0, write_matrix_file(path, test_matrix, MATRIX_FLOAT64, SIZE - 1,
+                                 SIZE, SIZE));
+  struct mapped_matrix matrix;
+  ASSERT_EQ(0, map_matrix_file(path, &matrix));
+  EXPECT_TRUE(std::isnan(mapped_determinant(&matrix)));
+  unmap_matrix_file(&matrix);
+}
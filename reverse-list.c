@@ -12,39 +12,182 @@
 const char *namelist[LISTLEN] = {"it",  "turns", "out", "that",
                                  "you", "have",  "our", "oil"};
 
+struct node_pool;
+
+/*
+ * The name is stored in the node, with its length, so that comparing names
+ * reads no other memory.  It is also NUL-terminated, for use as a C string.
+ * A node fits in a cache line, but only pooled nodes are aligned to one:
+ * aligning each malloc()ed node as well made building and traversing lists
+ * of them several times slower.
+ */
+#define NODE_SIZE 64u
+
 struct node {
-  char *name;
   struct node *next;
+  /* NULL if the node was allocated by alloc_node() */
+  struct node_pool *pool;
+  unsigned char namelen;
+  char name[MAXNAME];
+};
+static_assert(sizeof(struct node) <= NODE_SIZE, "A node must fit in a line.");
+
+/*
+ * Nodes of a pooled list are carved from large chunks, one cache line apart,
+ * rather than allocated one at a time.  Deleted nodes go on a free list for
+ * reuse, and deleting the whole list frees the chunks at once.
+ */
+#define POOL_CHUNK_NODES 1024u
+
+union node_slot {
+  struct node node;
+  char line[NODE_SIZE];
+};
+
+/* The header occupies the first slot of its chunk. */
+struct pool_chunk {
+  struct pool_chunk *next;
+  size_t capacity;
+  size_t used;
 };
 
+struct node_pool {
+  struct pool_chunk *chunks;
+  struct node *free_nodes;
+};
+
+/* A chain of nodes with its last node and length.  See list_create(). */
+struct list {
+  struct node *head;
+  struct node *tail;
+  size_t count;
+};
+
+/* Returns 0 if the name is missing or empty, and truncates long ones. */
+static size_t name_length(const char *name) {
+  if (!name) {
+    return 0u;
+  }
+  size_t namelen = (strlen(name) < (MAXNAME - 1)) ? strlen(name) : MAXNAME - 1;
+  if (!namelen) {
+    printf("Empty name not allowed.\n");
+    return 0u;
+  }
+  if (namelen < strlen(name)) {
+    fprintf(stderr, "Warning: name %s truncated.\n", name);
+  }
+  return namelen;
+}
+
+static void set_name(struct node *node, const char *name,
+                     const size_t namelen) {
+  memcpy(node->name, name, namelen);
+  node->name[namelen] = '\0';
+  node->namelen = (unsigned char)namelen;
+}
+
 /* Name must not be empty. */
 struct node *alloc_node(const char *name) {
   if (!name) {
     return NULL;
   }
+  size_t namelen = name_length(name);
+  if (!namelen) {
+    return NULL;
+  }
   struct node *newnode = (struct node *)malloc(sizeof(struct node));
   if (!newnode) {
     perror(strerror(-ENOMEM));
     return NULL;
   }
+  set_name(newnode, name, namelen);
+  newnode->next = NULL;
+  newnode->pool = NULL;
+  return newnode;
+}
 
-  size_t namelen = (strlen(name) < (MAXNAME - 1)) ? strlen(name) : MAXNAME - 1;
+static union node_slot *chunk_slots(struct pool_chunk *chunk) {
+  return (union node_slot *)chunk + 1;
+}
+
+static bool add_chunk(struct node_pool *pool, size_t capacity) {
+  struct pool_chunk *chunk = (struct pool_chunk *)aligned_alloc(
+      NODE_SIZE, (capacity + 1) * sizeof(union node_slot));
+  if (!chunk) {
+    perror(strerror(ENOMEM));
+    return false;
+  }
+  chunk->next = pool->chunks;
+  chunk->capacity = capacity;
+  chunk->used = 0u;
+  pool->chunks = chunk;
+  return true;
+}
+
+/* The first chunk holds capacity nodes, or POOL_CHUNK_NODES if that is 0. */
+struct node_pool *create_node_pool(size_t capacity) {
+  struct node_pool *pool = (struct node_pool *)malloc(sizeof(struct node_pool));
+  if (!pool) {
+    perror(strerror(ENOMEM));
+    return NULL;
+  }
+  pool->chunks = NULL;
+  pool->free_nodes = NULL;
+  if (!add_chunk(pool, capacity ? capacity : POOL_CHUNK_NODES)) {
+    free(pool);
+    return NULL;
+  }
+  return pool;
+}
+
+/* Frees every node of the pool, whether or not it is still in a list. */
+void release_node_pool(struct node_pool *pool) {
+  if (!pool) {
+    return;
+  }
+  struct pool_chunk *chunk = pool->chunks;
+  while (chunk) {
+    struct pool_chunk *next = chunk->next;
+    free(chunk);
+    chunk = next;
+  }
+  free(pool);
+}
+
+/* Each new chunk is twice the size of the last, so few are needed. */
+struct node *pool_alloc_node(struct node_pool *pool, const char *name) {
+  if (!pool) {
+    return NULL;
+  }
+  size_t namelen = name_length(name);
   if (!namelen) {
-    free(newnode);
-    printf("Empty name not allowed.\n");
     return NULL;
   }
-  if (namelen < strlen(name)) {
-    fprintf(stderr, "Warning: name %s truncated.\n", name);
+  struct node *newnode = pool->free_nodes;
+  if (newnode) {
+    pool->free_nodes = newnode->next;
+  } else {
+    if ((pool->chunks->used == pool->chunks->capacity) &&
+        !add_chunk(pool, 2 * pool->chunks->capacity)) {
+      return NULL;
+    }
+    newnode = &chunk_slots(pool->chunks)[pool->chunks->used++].node;
+    newnode->pool = pool;
   }
-  newnode->name = strndup(name, namelen);
+  set_name(newnode, name, namelen);
   newnode->next = NULL;
   return newnode;
 }
 
+/* A pooled node returns to its pool's free list. */
 void delete_node(struct node **oldnode) {
-  free((*oldnode)->name);
-  free(*oldnode);
+  struct node_pool *pool = (*oldnode)->pool;
+  if (pool) {
+    (*oldnode)->next = pool->free_nodes;
+    pool->free_nodes = *oldnode;
+  } else {
+    free(*oldnode);
+  }
   *oldnode = NULL;
 }
 
@@ -66,23 +209,13 @@ struct node *prepend_node(struct node *prepended, struct node *headp) {
 }
 
 size_t count_nodes(const struct node *HEAD) {
-  if (!HEAD) {
-    return 0u;
-  }
-  /* Work-around constness of HEAD */
-  struct node *cursor = alloc_node(HEAD->name);
-  /* Initialize. */
-  cursor->next = HEAD->next;
-  struct node *save = cursor;
   size_t listlen = 0u;
-  while (cursor) {
+  for (const struct node *cursor = HEAD; cursor; cursor = cursor->next) {
     listlen++;
 #ifdef DEBUG
     printf("%s\n", cursor->name);
 #endif
-    cursor = cursor->next;
   }
-  delete_node(&save);
   return listlen;
 }
 
@@ -117,12 +250,41 @@ struct node *create_list(const char *charlist[], size_t len) {
   return headp;
 }
 
+/*
+ * The same list as create_list(), with the nodes in one pool which the list
+ * owns.  Nodes from other pools or from alloc_node() must not be prepended
+ * to it, since delete_list() releases only the pool.
+ */
+struct node *create_pooled_list(const char *charlist[], size_t len) {
+  if (!len) {
+    return NULL;
+  }
+  struct node_pool *pool = create_node_pool(len);
+  struct node *headp = NULL;
+  if (!pool) {
+    exit(EXIT_FAILURE);
+  }
+  for (int i = 0; i < (int)len; i++) {
+    struct node *newnode = pool_alloc_node(pool, charlist[i]);
+    if (!newnode) {
+      exit(EXIT_FAILURE);
+    }
+    headp = prepend_node(newnode, headp);
+  }
+  return headp;
+}
+
 /* Delete nodes following HEAD one-by-one, then delete HEAD when end of list is
- * reached. */
+ * reached.  A pooled list is deleted at once by releasing its pool. */
 void delete_list(struct node **headp) {
   if ((!headp) || (!(*headp))) {
     return;
   }
+  if ((*headp)->pool) {
+    release_node_pool((*headp)->pool);
+    *headp = NULL;
+    return;
+  }
   struct node *cursor = (*headp)->next;
   while (cursor) {
     struct node *cursor_next = cursor->next;
@@ -132,55 +294,70 @@ void delete_list(struct node **headp) {
   delete_node(headp);
 }
 
+/* Lists are equal if their names are, in the same order. */
 bool are_equal(const struct node *alist, const struct node *blist) {
-  if ((NULL == alist) && (NULL == blist)) {
-    return true;
+  while (alist && blist) {
+    if ((alist->namelen != blist->namelen) ||
+        memcmp(alist->name, blist->name, alist->namelen)) {
+      return false;
+    }
+    alist = alist->next;
+    blist = blist->next;
   }
-  if ((NULL == alist) || (NULL == blist)) {
-    return false;
+  /* One list is shorter. */
+  return (alist == blist);
+}
+
+/*
+ * The list_ functions do the same as the ones above to a list which keeps
+ * its last node and its length, so that the length costs nothing to read.
+ * The nodes of a struct list must not be relinked by the bare functions.
+ */
+void list_create(struct list *list, const char *charlist[], size_t len) {
+  list->head = create_list(charlist, len);
+  list->count = list->head ? len : 0u;
+  list->tail = list->head;
+  while (list->tail && list->tail->next) {
+    list->tail = list->tail->next;
   }
-  struct node *copya = alloc_node(alist->name);
-  struct node *const savea = copya;
-  if (NULL == copya) {
-    perror(strerror(ENOMEM));
-    exit(EXIT_FAILURE);
+}
+
+void list_prepend(struct list *list, struct node *prepended) {
+  if (!prepended) {
+    return;
   }
-  copya->next = alist->next;
-  struct node *copyb = alloc_node(blist->name);
-  struct node *const saveb = copyb;
-  if (NULL == copyb) {
-    free(copya);
-    perror(strerror(ENOMEM));
-    exit(EXIT_FAILURE);
+  if (!list->head) {
+    list->tail = prepended;
   }
-  copyb->next = blist->next;
-  while (copya != NULL) {
-    if (NULL == copyb) {
-      goto falseout;
-    }
-    if (strcmp(copya->name, copyb->name)) {
-      goto falseout;
-    }
-    copya = copya->next;
-    copyb = copyb->next;
+  list->head = prepend_node(prepended, list->head);
+  list->count++;
+}
+
+void list_relink_and_delete_successor(struct list *list, struct node *parent) {
+  if ((!parent) || (!parent->next)) {
+    return;
   }
-  // copya is shorter.
-  if (copyb != NULL) {
-    goto falseout;
+  if (parent->next == list->tail) {
+    list->tail = parent;
   }
-  free(savea->name);
-  free(savea);
-  free(saveb->name);
-  free(saveb);
-  return true;
-falseout:
-  free(saveb->name);
-  free(saveb);
-  free(savea->name);
-  free(savea);
-  return false;
+  relink_and_delete_successor(parent);
+  list->count--;
 }
 
+void list_reverse(struct list *list) {
+  struct node *const oldhead = list->head;
+  reverse_list(&list->head);
+  list->tail = oldhead;
+}
+
+void list_delete(struct list *list) {
+  delete_list(&list->head);
+  list->tail = NULL;
+  list->count = 0u;
+}
+
+size_t list_length(const struct list *list) { return list->count; }
+
 #ifndef TESTING
 
 int main(void) {
@@ -205,8 +382,25 @@ int main(void) {
   struct node *anode = alloc_node("!");
   HEAD2 = prepend_node(anode, HEAD2);
   assert(!are_equal(HEAD, HEAD2));
+  delete_list(&HEAD2);
+
+  HEAD2 = create_pooled_list(namelist, LISTLEN);
+  assert(are_equal(HEAD, HEAD2));
+  relink_and_delete_successor(HEAD2);
+  assert(LISTLEN - 1 == count_nodes(HEAD2));
   delete_list(&HEAD);
   delete_list(&HEAD2);
+  assert(NULL == HEAD2);
+
+  struct list alist;
+  list_create(&alist, namelist, LISTLEN);
+  assert(LISTLEN == list_length(&alist));
+  list_reverse(&alist);
+  list_relink_and_delete_successor(&alist, alist.head);
+  assert(LISTLEN - 1 == list_length(&alist));
+  assert(count_nodes(alist.head) == list_length(&alist));
+  list_delete(&alist);
+  assert(0U == list_length(&alist));
 
   exit(EXIT_SUCCESS);
 }
@@ -0,0 +1,81 @@
+/*
+ * Time building, traversing, comparing and deleting lists of 10^4 to 10^7
+ * nodes, allocated one at a time and from a node pool.  Names are "node"
+ * followed by the index, so that they are distinct and of realistic length.
+ *
+ * Usage: reverse-list_benchmark [largest length]
+ */
+#include <stdio.h>
+#include <time.h>
+
+#define TESTING
+
+#include "reverse-list.c"
+
+static double elapsed_ns(const struct timespec *start,
+                         const struct timespec *end) {
+  return ((end->tv_sec - start->tv_sec) * 1e9) +
+         (double)(end->tv_nsec - start->tv_nsec);
+}
+
+/* ns per node to build, count, compare with a copy and delete one list */
+static void time_list(const char *names[], const size_t len, const bool pooled,
+                      double *ns) {
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  struct node *head = pooled ? create_pooled_list(names, len)
+                             : create_list(names, len);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  ns[0] = elapsed_ns(&start, &end) / len;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  const size_t counted = count_nodes(head);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  ns[1] = elapsed_ns(&start, &end) / len;
+  if (counted != len) {
+    fprintf(stderr, "Counted %lu nodes of %lu.\n", counted, len);
+    exit(EXIT_FAILURE);
+  }
+  struct node *copy = pooled ? create_pooled_list(names, len)
+                             : create_list(names, len);
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  const bool equal = are_equal(head, copy);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  ns[2] = elapsed_ns(&start, &end) / len;
+  delete_list(&copy);
+  if (!equal) {
+    fprintf(stderr, "A copy of %lu nodes compared unequal.\n", len);
+    exit(EXIT_FAILURE);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  delete_list(&head);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  ns[3] = elapsed_ns(&start, &end) / len;
+}
+
+int main(int argc, char **argv) {
+  const size_t largest = (argc > 1) ? strtoul(argv[1], NULL, 10) : 10000000;
+  char(*storage)[MAXNAME] = (char(*)[MAXNAME])malloc(largest * MAXNAME);
+  const char **names = (const char **)malloc(largest * sizeof(char *));
+  if (!storage || !names) {
+    perror("malloc");
+    exit(EXIT_FAILURE);
+  }
+  for (size_t i = 0; i < largest; i++) {
+    snprintf(storage[i], MAXNAME, "node%lu", i);
+    names[i] = storage[i];
+  }
+  printf("ns per node\n");
+  printf("%10s %8s %10s %10s %10s %10s\n", "nodes", "from", "build",
+         "count", "compare", "delete");
+  for (size_t len = 10000; len <= largest; len *= 10) {
+    for (int pooled = 0; pooled <= 1; pooled++) {
+      double ns[4];
+      time_list(names, len, pooled, ns);
+      printf("%10lu %8s %10.2f %10.2f %10.2f %10.2f\n", len,
+             pooled ? "pool" : "malloc", ns[0], ns[1], ns[2], ns[3]);
+    }
+  }
+  free(storage);
+  free(names);
+  exit(EXIT_SUCCESS);
+}
@@ -74,3 +74,146 @@ TEST_F(ReverseListTest, DeletedNode) {
   relink_and_delete_successor(alist);
   EXPECT_EQ(LISTLEN - 1, count_nodes(alist));
 }
+
+TEST(PooledListTest, MatchesMallocList) {
+  struct node *alist = create_list(namelist, LISTLEN);
+  struct node *pooled = create_pooled_list(namelist, LISTLEN);
+  EXPECT_TRUE(are_equal(alist, pooled));
+  EXPECT_EQ(LISTLEN, count_nodes(pooled));
+  reverse_list(&pooled);
+  reverse_list(&alist);
+  EXPECT_TRUE(are_equal(alist, pooled));
+  delete_list(&alist);
+  delete_list(&pooled);
+  EXPECT_EQ(NULL, pooled);
+  EXPECT_EQ(NULL, create_pooled_list(namelist, 0));
+}
+
+TEST(PooledListTest, DeletedNodeIsReused) {
+  struct node *pooled = create_pooled_list(namelist, LISTLEN);
+  struct node *const deleted = pooled->next;
+  relink_and_delete_successor(pooled);
+  EXPECT_EQ(LISTLEN - 1, count_nodes(pooled));
+  struct node *reused = pool_alloc_node(pooled->pool, "again");
+  EXPECT_EQ(deleted, reused);
+  EXPECT_STREQ("again", reused->name);
+  pooled = prepend_node(reused, pooled);
+  EXPECT_EQ(LISTLEN, count_nodes(pooled));
+  delete_list(&pooled);
+}
+
+/*
+ * More nodes than the first chunk holds, with names of every length, each on
+ * its own cache line
+ */
+TEST(PooledListTest, GrowsByChunks) {
+  struct node_pool *pool = create_node_pool(2);
+  ASSERT_NE(nullptr, pool);
+  struct node *head = NULL;
+  char name[MAXNAME + 8];
+  for (size_t i = 0; i < 100; i++) {
+    const size_t len = 1 + (i % (sizeof(name) - 1));
+    memset(name, 'a' + (i % 26), len);
+    name[len] = '\0';
+    struct node *newnode = pool_alloc_node(pool, name);
+    ASSERT_NE(nullptr, newnode);
+    EXPECT_EQ(0u, (uintptr_t)newnode % NODE_SIZE);
+    EXPECT_EQ(std::min((size_t)MAXNAME - 1, len), strlen(newnode->name));
+    head = prepend_node(newnode, head);
+  }
+  EXPECT_EQ(100u, count_nodes(head));
+  EXPECT_EQ(nullptr, pool_alloc_node(pool, ""));
+  EXPECT_EQ(nullptr, pool_alloc_node(NULL, "name"));
+  delete_list(&head);
+}
+
+/* Names up to the longest which fits are stored whole, and longer ones cut. */
+TEST(NodeLayoutTest, NamesAreInline) {
+  char name[MAXNAME + 8];
+  for (size_t len = 1; len < sizeof(name); len++) {
+    memset(name, 'x', len);
+    name[len] = '\0';
+    struct node *anode = alloc_node(name);
+    ASSERT_NE(nullptr, anode);
+    const size_t stored = std::min((size_t)MAXNAME - 1, len);
+    EXPECT_EQ(stored, anode->namelen);
+    EXPECT_EQ(stored, strlen(anode->name));
+    EXPECT_GE(anode->name, (const char *)anode);
+    EXPECT_LE(anode->name + stored, (const char *)anode + NODE_SIZE - 1);
+    delete_node(&anode);
+  }
+}
+
+/* A name which is a prefix of another is not equal to it. */
+TEST(NodeLayoutTest, AreEqualComparesLengths) {
+  const char *alist[] = {"you", "have"};
+  const char *blist[] = {"you", "haven"};
+  struct node *a = create_list(alist, 2);
+  struct node *b = create_pooled_list(blist, 2);
+  EXPECT_FALSE(are_equal(a, b));
+  EXPECT_FALSE(are_equal(b, a));
+  EXPECT_TRUE(are_equal(a, a));
+  delete_list(&a);
+  delete_list(&b);
+}
+
+/* The cached length and last node agree with the chain after each change. */
+static void expect_consistent(const struct list *list) {
+  EXPECT_EQ(count_nodes(list->head), list_length(list));
+  const struct node *last = list->head;
+  while (last && last->next) {
+    last = last->next;
+  }
+  EXPECT_EQ(last, list->tail);
+}
+
+TEST(ListHandleTest, KeepsLengthAndTail) {
+  struct list alist;
+  list_create(&alist, namelist, LISTLEN);
+  EXPECT_EQ(LISTLEN, list_length(&alist));
+  expect_consistent(&alist);
+  EXPECT_STREQ(namelist[0], alist.tail->name);
+
+  list_reverse(&alist);
+  expect_consistent(&alist);
+  EXPECT_STREQ(namelist[LISTLEN - 1], alist.tail->name);
+
+  list_prepend(&alist, alloc_node("!"));
+  list_prepend(&alist, NULL);
+  EXPECT_EQ(LISTLEN + 1, list_length(&alist));
+  expect_consistent(&alist);
+
+  // Delete the last node, then the head's successor.
+  struct node *parent = alist.head;
+  while (parent->next != alist.tail) {
+    parent = parent->next;
+  }
+  list_relink_and_delete_successor(&alist, parent);
+  EXPECT_EQ(parent, alist.tail);
+  list_relink_and_delete_successor(&alist, alist.head);
+  list_relink_and_delete_successor(&alist, alist.tail);
+  list_relink_and_delete_successor(&alist, NULL);
+  EXPECT_EQ(LISTLEN - 1, list_length(&alist));
+  expect_consistent(&alist);
+
+  list_delete(&alist);
+  EXPECT_EQ(nullptr, alist.head);
+  EXPECT_EQ(0u, list_length(&alist));
+  expect_consistent(&alist);
+}
+
+TEST(ListHandleTest, EmptyAndSingleLists) {
+  struct list alist;
+  list_create(&alist, NULL, 0);
+  EXPECT_EQ(0u, list_length(&alist));
+  expect_consistent(&alist);
+  list_reverse(&alist);
+  expect_consistent(&alist);
+  list_prepend(&alist, alloc_node("one"));
+  EXPECT_EQ(alist.head, alist.tail);
+  list_reverse(&alist);
+  EXPECT_EQ(1u, list_length(&alist));
+  expect_consistent(&alist);
+  list_delete(&alist);
+  expect_consistent(&alist);
+}